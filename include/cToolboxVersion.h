@@ -0,0 +1,11 @@
+#ifndef C_TOOLBOX_VERSION_H_
+#define C_TOOLBOX_VERSION_H_
+
+#define C_TOOL_BOX_VERSION_NAME "Release"
+#define C_TOOL_BOX_VERSION_MAJOR "1"
+#define C_TOOL_BOX_VERSION_MINOR "0"
+#define C_TOOL_BOX_VERSION_FIX "0"
+#define C_TOOL_BOX_VERSION_GIT_SHA1 "8e2cc12d4c5dbf315b8bc3c8422ce36233be6fea-dirty"
+#define C_TOOL_BOX_VERSION_BUILD_TIME "Mon Oct 19 17:50:52 2026"
+
+#endif
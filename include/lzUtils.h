@@ -0,0 +1,87 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __LZUTILS_H_
+#define __LZUTILS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ ********************** Public Type/Constant definitions **********************
+ *****************************************************************************/
+#define LZ_UTILS_MAX_INPUT_SIZE (UINT16_MAX)    /**< Largest input of lzUtils_compress in bytes */
+
+/******************************************************************************
+ ************************ Global functions declaration ************************
+ *****************************************************************************/
+
+/******************************************************************************
+ ************************ Global variables declaration ************************
+ *****************************************************************************/
+
+/******************************************************************************
+ ************************ Public function declaration *************************
+ *****************************************************************************/
+
+/**************************** Function Description ***************************/
+/**
+ * @details lzUtils_compress    Compress a data area with a small LZ77 codec.
+ *      The output is a list of sequences, each made of literals copied as is
+ *      followed by a match copied from the previous output, in the same
+ *      layout as an LZ4 block. A single greedy pass with a 1024 entries hash
+ *      table on the stack keeps the cost linear in the input size.
+ * @param [in] data The pointer to the data to compress.
+ * @param [in] size The size of the data, up to LZ_UTILS_MAX_INPUT_SIZE bytes.
+ * @param [out] output  The pointer to the compressed data.
+ * @param [in] capacity The size of the output area in bytes.
+ * @param [out] outputSize  The size of the compressed data in bytes.
+ * @return true if successful, false otherwise (e.g. the compressed data
+ *      doesn't fit in capacity bytes).
+ */
+/*****************************************************************************/
+bool lzUtils_compress(const uint8_t *data, size_t size, uint8_t *output, size_t capacity, size_t *outputSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details lzUtils_decompress  Decompress a data area produced by
+ *      lzUtils_compress.
+ * @param [in] data The pointer to the compressed data.
+ * @param [in] size The size of the compressed data in bytes.
+ * @param [out] output  The pointer to the decompressed data.
+ * @param [in] capacity The size of the output area in bytes.
+ * @param [out] outputSize  The size of the decompressed data in bytes.
+ * @return true if successful, false otherwise (e.g. malformed data or the
+ *      decompressed data doesn't fit in capacity bytes).
+ */
+/*****************************************************************************/
+bool lzUtils_decompress(const uint8_t *data, size_t size, uint8_t *output, size_t capacity, size_t *outputSize);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
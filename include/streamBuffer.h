@@ -33,9 +33,109 @@ extern "C" {
 /******************************************************************************
  ********************** Public Type/Constant definitions **********************
  *****************************************************************************/
-#define STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT (5)
+#ifndef STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT
+#define STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT (5)     /**< Size of the pool used by streamBuffer_createStatic */
+#endif
+#ifndef STREAM_BUFFER_ENABLE_STATS
+#define STREAM_BUFFER_ENABLE_STATS (0)                  /**< Keep the counters read by streamBuffer_getStats */
+#endif
+#define STREAM_BUFFER_STATIC_STORAGE_SIZE (320)         /**< Size of the metadata of a stream buffer instance in bytes */
+#define STREAM_BUFFER_SHARED_HEADER_SIZE (64)           /**< Size of the header of a shared region in bytes */
+/** Size of a shared region holding a buffer of bufferSize bytes */
+#define STREAM_BUFFER_SHARED_REGION_SIZE(bufferSize) \
+    (STREAM_BUFFER_SHARED_HEADER_SIZE + STREAM_BUFFER_STATIC_STORAGE_SIZE + (size_t) (bufferSize))
+
 typedef struct streamBuffer *streamBufferHandle_t;
 
+/**
+ * The function called by a producer to wake the consumer up.
+ */
+typedef void (*streamBufferWakeup_t)(void *context);
+
+/**
+ * The function giving the current time of a monotonic clock, in any unit.
+ */
+typedef uint32_t (*streamBufferGetTime_t)(void);
+
+/**
+ * The way the records are framed in the buffer.
+ */
+typedef enum streamBufferFormat
+{
+    STREAM_BUFFER_FORMAT_PREFIX16 = 0,  /**< 2 bytes big endian length prefix, records up to 65535 bytes (default) */
+    STREAM_BUFFER_FORMAT_VARINT,        /**< LEB128 length prefix, 1 byte for records under 128 bytes */
+    STREAM_BUFFER_FORMAT_RAW,           /**< No record, a byte stream accessed with streamBuffer_write and streamBuffer_read */
+    STREAM_BUFFER_FORMAT_FIXED,         /**< No prefix, all the records have the fixed record size */
+} streamBufferFormat_t;
+
+/**
+ * The options of a stream buffer instance. A zero-initialized configuration
+ * gives the default behavior.
+ */
+typedef struct streamBufferConfig
+{
+    streamBufferFormat_t format;    // The framing of the records
+    bool isMultiProducer;           // Allow several concurrent producers
+    uint8_t recordAlignment;        // Alignment of the payloads in bytes, 0 or 1 to pack the records
+    uint32_t fixedRecordSize;       // Size of every record with STREAM_BUFFER_FORMAT_FIXED
+    bool isCompressed;              // Compress the records given to streamBuffer_put when it pays off
+    uint32_t timeToLive;            // Age at which a record is dropped instead of read, 0 to keep the records
+    streamBufferGetTime_t getTime;  // Clock of the record ages, required with a time to live
+} streamBufferConfig_t;
+
+/**
+ * A contiguous area of memory inside the buffer of a stream buffer instance.
+ */
+typedef struct streamBufferSpan
+{
+    const uint8_t *data;    // Start of the area
+    size_t size;            // Size of the area in bytes
+} streamBufferSpan_t;
+
+/**
+ * A record stored in a stream buffer instance. As the buffer is circular, the
+ * record may be split in two spans. The second span is empty otherwise.
+ */
+typedef struct streamBufferRecord
+{
+    streamBufferSpan_t spans[2];    // The record data in order
+    size_t size;                    // Size of the record in bytes
+} streamBufferRecord_t;
+
+/**
+ * A cursor over the records of a stream buffer instance, see
+ * streamBuffer_iterBegin. The content shall never be accessed directly.
+ */
+typedef struct streamBufferIterator
+{
+    uint32_t index;     // Position of the next record
+    uint32_t endIndex;  // Position of the end of the last record published at the start
+} streamBufferIterator_t;
+
+/**
+ * The counters of a stream buffer instance, see streamBuffer_getStats.
+ */
+typedef struct streamBufferStats
+{
+    uint64_t putRecordCount;        // Number of records added
+    uint64_t putByteCount;          // Number of payload bytes added, prefixes excluded
+    uint64_t getRecordCount;        // Number of records removed
+    uint64_t getByteCount;          // Number of payload bytes removed, prefixes excluded
+    uint64_t rejectedPutCount;      // Number of puts that failed for lack of space
+    uint32_t maxUsedSize;           // High-water mark of the used bytes in the buffer
+    uint32_t largestRecordSize;     // Size of the largest record added in bytes
+} streamBufferStats_t;
+
+/**
+ * Opaque storage for the metadata of a stream buffer instance. It allows the
+ * application to provide the memory of an instance itself, see
+ * streamBuffer_initStatic. The content shall never be accessed directly.
+ */
+typedef struct streamBufferStatic
+{
+    uint64_t opaque[STREAM_BUFFER_STATIC_STORAGE_SIZE / sizeof(uint64_t)];
+} streamBufferStatic_t;
+
 /******************************************************************************
  ************************ Global functions declaration ************************
  *****************************************************************************/
@@ -51,16 +151,39 @@ typedef struct streamBuffer *streamBufferHandle_t;
 /**************************** Function Description ***************************/
 /**
  * @details streamBuffer_createStatic    Create a stream buffer instance with a
- *      static array.
+ *      static array. An instance is safe to share between one producer
+ *      context (put) and one consumer context (get) without any lock. The
+ *      whole bufferSize bytes can be used to store the records. The metadata
+ *      of the instance is taken from an internal pool of
+ *      STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT elements.
  * @param [in] buffer   A valid pointer to the underlying memory managed by the
  *      stream buffer.
  * @param [in] bufferSize   The size of the buffer. This shall be a power of 2.
+ *      A buffer not larger than the record prefix can't hold any record, it
+ *      can still be used with streamBuffer_write and streamBuffer_read.
  * @return A handle to a new static instance of stream buffer if successful,
  *      NULL otherwise. 
  */
 /*****************************************************************************/
 streamBufferHandle_t streamBuffer_createStatic(uint8_t *const buffer, size_t bufferSize);
 
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_initStatic  Create a stream buffer instance with a
+ *      static array and a metadata storage provided by the caller. The number
+ *      of instances created this way isn't limited.
+ * @param [in] storage  A valid pointer to the memory used to store the
+ *      metadata of the instance. It shall remain valid until the instance is
+ *      freed with streamBuffer_freeStatic.
+ * @param [in] buffer   A valid pointer to the underlying memory managed by the
+ *      stream buffer.
+ * @param [in] bufferSize   The size of the buffer. This shall be a power of 2.
+ * @return A handle to the new instance of stream buffer if successful, NULL
+ *      otherwise.
+ */
+/*****************************************************************************/
+streamBufferHandle_t streamBuffer_initStatic(streamBufferStatic_t *storage, uint8_t *const buffer, size_t bufferSize);
+
 /**************************** Function Description ***************************/
 /**
  * @details streamBuffer_freeStatic Free a stream buffer instance.
@@ -72,18 +195,167 @@ bool streamBuffer_freeStatic(streamBufferHandle_t *self);
 
 /**************************** Function Description ***************************/
 /**
- * @details streamBuffer_put    Add data to the stream buffer.
+ * @details streamBuffer_create Create a stream buffer instance which owns its
+ *      metadata and its buffer, both allocated on the heap. Its buffer can be
+ *      resized with streamBuffer_resize. When maxBufferSize is not 0, the
+ *      producer also doubles the buffer on demand, up to maxBufferSize, when
+ *      a record doesn't fit: streamBuffer_put, streamBuffer_putv,
+ *      streamBuffer_putBatch and streamBuffer_write may then move the buffer,
+ *      so the consumer shall not use the instance at the same time, e.g. both
+ *      sides run in the same context or behind the same lock. A growth ends
+ *      any iteration started before it. A record larger than the current
+ *      buffer allows is still rejected, and there's no growth on demand in
+ *      multi-producer mode nor while a record is peeked or reserved.
+ * @param [in] bufferSize   The initial size of the buffer. This shall be a
+ *      power of 2.
+ * @param [in] maxBufferSize    The largest size reached on demand, a power of
+ *      2 not smaller than bufferSize, or 0 to disable the growth on demand.
+ * @return A handle to the new instance of stream buffer if successful, NULL
+ *      otherwise.
+ */
+/*****************************************************************************/
+streamBufferHandle_t streamBuffer_create(size_t bufferSize, size_t maxBufferSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_free   Free a stream buffer instance created with
+ *      streamBuffer_create, along with its buffer.
+ * @param [in] self A pointer to a stream buffer handle.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_free(streamBufferHandle_t *self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_initShared Create a stream buffer instance in a memory
+ *      region shared between processes, e.g. mapped from shm_open or
+ *      memfd_create. The region holds a header, the metadata and the buffer,
+ *      without any pointer, so each process may map it at another address.
+ *      The instance shall be configured before the other processes attach it.
+ *      A shared instance can't have a wakeup function. When the statistics
+ *      are enabled, sharing requires lock free 64 bits atomics.
+ * @param [in] region   The shared region, aligned on 64 bytes.
+ * @param [in] regionSize   The size of the region in bytes, at least
+ *      STREAM_BUFFER_SHARED_REGION_SIZE(bufferSize).
+ * @param [in] bufferSize   The size of the buffer in bytes. It shall be a
+ *      power of 2.
+ * @return The stream buffer handle if successful, NULL otherwise.
+ */
+/*****************************************************************************/
+streamBufferHandle_t streamBuffer_initShared(void *region, size_t regionSize, size_t bufferSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_attachShared   Get the stream buffer instance created
+ *      in a shared region by another process with streamBuffer_initShared.
+ *      streamBuffer_freeStatic only detaches the handle of a shared instance.
+ * @param [in] region   The shared region, aligned on 64 bytes.
+ * @param [in] regionSize   The size of the region in bytes.
+ * @return The stream buffer handle if the region holds a valid instance, NULL
+ *      otherwise.
+ */
+/*****************************************************************************/
+streamBufferHandle_t streamBuffer_attachShared(void *region, size_t regionSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_configure  Change the options of a stream buffer
+ *      instance. This function shall only be called while the stream buffer is
+ *      empty and not used by the producer nor the consumer. In multi-producer
+ *      mode, streamBuffer_put and streamBuffer_putBatch may be called from
+ *      several contexts at once, the buffer shall be aligned on 4 bytes, the
+ *      format shall be STREAM_BUFFER_FORMAT_PREFIX16 and streamBuffer_reserve
+ *      is not available. With a record alignment of 2 to 64 bytes, the buffer
+ *      shall be aligned as much, the format shall be
+ *      STREAM_BUFFER_FORMAT_PREFIX16 and each payload starts at an aligned
+ *      offset and is never split, so it can be used in place after
+ *      streamBuffer_peek. Multi-producer records are aligned on 4 bytes.
+ *      Since multi-producer and aligned records are never split, they are
+ *      limited to half of the buffer minus their header or alignment, so that
+ *      one always fits in an empty buffer whatever the write position.
+ *      With compression, the format shall be STREAM_BUFFER_FORMAT_PREFIX16
+ *      with packed records and a single producer, the records are limited
+ *      to 32767 bytes and streamBuffer_peek is not available. Each record
+ *      given to streamBuffer_put is stored compressed if it's smaller this
+ *      way, and streamBuffer_get, streamBuffer_getBounded and
+ *      streamBuffer_getBatch decompress it. With a time to live, the format
+ *      shall be STREAM_BUFFER_FORMAT_PREFIX16 or STREAM_BUFFER_FORMAT_VARINT
+ *      with packed records, a single producer, no compression and a buffer
+ *      that isn't shared. Each record is stamped with getTime when it is
+ *      published, which adds 4 bytes to its prefix, and the consumer
+ *      functions drop the records older than the time to live without
+ *      reading their payload, see streamBuffer_getExpiredCount.
+ * @param [in] self The stream buffer handle.
+ * @param [in] config   The new options of the instance.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_configure(streamBufferHandle_t self, const streamBufferConfig_t *config);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_resize Move the content of a stream buffer instance
+ *      created with streamBuffer_create to a new buffer, to grow it or to
+ *      shrink it back once it's idle. The stored records are kept, so the new
+ *      size shall be large enough to hold them. This function shall only be
+ *      called while neither the producer nor the consumer uses the stream
+ *      buffer, and not between streamBuffer_reserve and streamBuffer_commit
+ *      or streamBuffer_peek and streamBuffer_release.
+ * @param [in] self The stream buffer handle.
+ * @param [in] newSize  The new size of the buffer. This shall be a power of 2.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_resize(streamBufferHandle_t self, size_t newSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_put    Add data to the stream buffer. This function
+ *      shall only be called from the producer context.
  * @param [in] self The stream buffer handle.
  * @param [in] data A pointer to the data to add.
  * @param [in] size The size of the data to add in bytes.
  * @return true if successful, false otherwise. 
  */
 /*****************************************************************************/
-bool streamBuffer_put(streamBufferHandle_t self, const uint8_t *data, uint16_t size);
+bool streamBuffer_put(streamBufferHandle_t self, const uint8_t *data, size_t size);
 
 /**************************** Function Description ***************************/
 /**
- * @details streamBuffer_get    Get data from the stream buffer.
+ * @details streamBuffer_putv   Add a single record made of several fragments
+ *      to the stream buffer, without concatenating them first. This function
+ *      shall only be called from the producer context.
+ * @param [in] self The stream buffer handle.
+ * @param [in] fragments    An array describing the fragments of the record in
+ *      order.
+ * @param [in] fragmentCount    The number of fragments in the array.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_putv(streamBufferHandle_t self, const streamBufferSpan_t *fragments, size_t fragmentCount);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_putBatch   Add several records to the stream buffer at
+ *      once. Either all the records are added or none of them. With
+ *      multi-producer or aligned records, the batch is contiguous and
+ *      limited to half of the buffer, headers and alignment included. This
+ *      function shall only be called from the producer context.
+ * @param [in] self The stream buffer handle.
+ * @param [in] records  An array describing the records to add in order.
+ * @param [in] recordCount  The number of records in the array.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_putBatch(streamBufferHandle_t self, const streamBufferSpan_t *records, size_t recordCount);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_get    Get data from the stream buffer. Records larger
+ *      than 65535 bytes can't be retrieved with this function, see
+ *      streamBuffer_getBounded. This function shall only be called from the
+ *      consumer context.
  * @param [in] self The stream buffer handle.
  * @param [out] data    A pointer to the data to get.
  * @param [out] size    The size of the retreived data in bytes.
@@ -94,9 +366,174 @@ bool streamBuffer_get(streamBufferHandle_t self, uint8_t *data, uint16_t *size);
 
 /**************************** Function Description ***************************/
 /**
- * @details streamBuffer_space  Get the remaining space in the stream buffer.
+ * @details streamBuffer_write  Add as many bytes as fit to a stream buffer in
+ *      the STREAM_BUFFER_FORMAT_RAW format. This function shall only be called
+ *      from the producer context.
  * @param [in] self The stream buffer handle.
- * @param [out] byteCount   The number of available bytes in the stream buffer.
+ * @param [in] data A pointer to the bytes to add.
+ * @param [in] size The number of bytes to add.
+ * @param [out] writtenSize The number of bytes actually added.
+ * @return true if at least one byte was added, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_write(streamBufferHandle_t self, const uint8_t *data, size_t size, size_t *writtenSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_read   Get up to capacity bytes from a stream buffer
+ *      in the STREAM_BUFFER_FORMAT_RAW format. This function shall only be
+ *      called from the consumer context.
+ * @param [in] self The stream buffer handle.
+ * @param [out] data    A pointer to the destination of the bytes.
+ * @param [in] capacity The size of the destination in bytes.
+ * @param [out] readSize    The number of bytes actually read.
+ * @return true if at least one byte was read, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_read(streamBufferHandle_t self, uint8_t *data, size_t capacity, size_t *readSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_getBounded Get data from the stream buffer without
+ *      writing more than capacity bytes. If the next record is bigger than
+ *      capacity, it stays in the stream buffer. A compressed record which
+ *      doesn't decompress to its stored size is dropped and reported with a
+ *      null size. This function shall only be called from the consumer
+ *      context.
+ * @param [in] self The stream buffer handle.
+ * @param [out] data    A pointer to the data to get.
+ * @param [in] capacity The size of the data area in bytes.
+ * @param [out] size    The size of the next record in bytes.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_getBounded(streamBufferHandle_t self, uint8_t *data, size_t capacity, size_t *size);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_getBatch   Get several records from the stream buffer
+ *      at once. The records are copied one after the other in data, until
+ *      maxRecordCount records are read, the buffer is empty or the next record
+ *      doesn't fit in data or is corrupted. A corrupted record at the head
+ *      is dropped. This function shall only be called from the consumer
+ *      context.
+ * @param [in] self The stream buffer handle.
+ * @param [out] data    A pointer to the area to copy the records in.
+ * @param [in] capacity The size of the data area in bytes.
+ * @param [out] offsets The offset of each record in data, followed by the
+ *      total size of the records. It shall hold maxRecordCount + 1 elements.
+ * @param [in] maxRecordCount   The maximum number of records to get.
+ * @param [out] recordCount The number of records read.
+ * @return true if at least one record was read, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_getBatch(streamBufferHandle_t self, uint8_t *data, size_t capacity, size_t *offsets, size_t maxRecordCount, size_t *recordCount);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_peek   Get the next record of the stream buffer
+ *      without copying nor removing it. The record stays valid until
+ *      streamBuffer_release or any other consumer function is called. With a
+ *      time to live, no record is dropped while one is peeked. This function
+ *      shall only be called from the consumer context.
+ * @param [in] self The stream buffer handle.
+ * @param [out] record  The location of the record in the stream buffer.
+ * @return true if successful, false otherwise (e.g. the buffer is empty).
+ */
+/*****************************************************************************/
+bool streamBuffer_peek(streamBufferHandle_t self, streamBufferRecord_t *record);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_release    Remove the record returned by the last
+ *      call to streamBuffer_peek from the stream buffer. This function shall
+ *      only be called from the consumer context.
+ * @param [in] self The stream buffer handle.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_release(streamBufferHandle_t self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_iterBegin  Start an iteration over the records stored
+ *      in the stream buffer, without removing them. Only the records already
+ *      published at this point are visited, expired records are skipped but
+ *      left in the stream buffer. The iterator is no longer valid
+ *      once a record is removed. This function shall only be called from the
+ *      consumer context and isn't available in the RAW format nor with
+ *      compressed records.
+ * @param [in] self The stream buffer handle.
+ * @param [out] iterator    The iterator, positioned on the oldest record.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_iterBegin(streamBufferHandle_t self, streamBufferIterator_t *iterator);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_iterNext   Get the record under the iterator without
+ *      copying it, and move the iterator to the next record. The record stays
+ *      in the stream buffer. This function shall only be called from the
+ *      consumer context.
+ * @param [in] self The stream buffer handle.
+ * @param [in, out] iterator    The iterator given to streamBuffer_iterBegin.
+ * @param [out] record  The location of the record in the stream buffer.
+ * @return true if successful, false otherwise (e.g. no more records).
+ */
+/*****************************************************************************/
+bool streamBuffer_iterNext(streamBufferHandle_t self, streamBufferIterator_t *iterator, streamBufferRecord_t *record);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_reserve    Reserve a contiguous area in the stream
+ *      buffer so that a record can be written directly in it. The record is
+ *      only added once streamBuffer_commit is called. No other producer
+ *      function shall be called in between. It isn't available in
+ *      multi-producer mode nor with STREAM_BUFFER_FORMAT_FIXED. This function
+ *      shall only be called from the producer context.
+ * @param [in] self The stream buffer handle.
+ * @param [in] maxSize  The maximum size of the record in bytes.
+ * @param [out] data    A pointer to the reserved area of maxSize bytes.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_reserve(streamBufferHandle_t self, size_t maxSize, uint8_t **data);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_commit Add the record written in the area returned by
+ *      streamBuffer_reserve to the stream buffer. This function shall only be
+ *      called from the producer context.
+ * @param [in] self The stream buffer handle.
+ * @param [in] actualSize   The actual size of the record in bytes. It shall
+ *      not exceed the reserved size. 0 cancels the reservation.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_commit(streamBufferHandle_t self, size_t actualSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_getMaxReserveSize  Get the largest maxSize that
+ *      streamBuffer_reserve accepts in an empty stream buffer whatever the
+ *      write position. Larger reservations may never fit. It may be called
+ *      from both the producer and the consumer contexts.
+ * @param [in] self The stream buffer handle.
+ * @param [out] maxSize The largest size of a reserved area in bytes.
+ * @return true if successful, false otherwise (e.g. streamBuffer_reserve
+ *      isn't available).
+ */
+/*****************************************************************************/
+bool streamBuffer_getMaxReserveSize(streamBufferHandle_t self, size_t *maxSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_space  Get the number of bytes currently used in the
+ *      stream buffer (records and their prefixes). It may be called from both
+ *      the producer and the consumer contexts.
+ * @param [in] self The stream buffer handle.
+ * @param [out] byteCount   The number of bytes waiting to be read.
  * @return true if successful, false otherwise. 
  */
 /*****************************************************************************/
@@ -104,9 +541,102 @@ bool streamBuffer_space(streamBufferHandle_t self, size_t *byteCount);
 
 /**************************** Function Description ***************************/
 /**
- * @details streamBuffer_empty  Queries a stream buffer to see if it's empty.
+ * @details streamBuffer_peekBytes  Get the bytes stored in the stream buffer
+ *      without copying nor removing them, e.g. to hand them to an I/O
+ *      operation. With a record format, the records are given back to back
+ *      with their prefixes. The end of the buffer left unused by
+ *      streamBuffer_reserve holds stale bytes, so the spans stop before it and
+ *      resume at the start of the buffer. This isn't available in
+ *      multi-producer mode, with aligned or compressed records nor with a time
+ *      to live. This function shall only be called from the consumer context.
+ * @param [in] self The stream buffer handle.
+ * @param [in] offset   Number of bytes to skip from the oldest byte, e.g. the
+ *      bytes already handed over and not released yet. With a record format,
+ *      it shall be the sum of sizes given back by the previous calls.
+ * @param [out] bytes   The location of the bytes in the stream buffer. The
+ *      size is the number of bytes to release once the spans are consumed,
+ *      the end of the buffer skipped between the spans included.
+ * @return true if successful, false otherwise (e.g. no byte after offset).
+ */
+/*****************************************************************************/
+bool streamBuffer_peekBytes(streamBufferHandle_t self, size_t offset, streamBufferRecord_t *bytes);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_releaseBytes   Remove the oldest bytes of the stream
+ *      buffer, see streamBuffer_peekBytes. The stream buffer shall then only
+ *      be read with the byte functions until a record boundary is reached.
+ *      Removing 0 bytes tells whether the byte functions are available. This
+ *      function shall only be called from the consumer context.
+ * @param [in] self The stream buffer handle.
+ * @param [in] size The number of bytes to remove.
+ * @return true if successful, false otherwise (e.g. fewer bytes are stored).
+ */
+/*****************************************************************************/
+bool streamBuffer_releaseBytes(streamBufferHandle_t self, size_t size);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_setWakeup  Set the function a producer calls when it
+ *      adds records while the consumer waits for them, see
+ *      streamBuffer_prepareWait. The wakeup function is called from the
+ *      producer context. This function shall only be called while neither the
+ *      producer nor the consumer uses the stream buffer, except to remove the
+ *      wakeup function: a producer adding records at the same time then calls
+ *      the removed function with its context or no function at all.
+ * @param [in] self The stream buffer handle.
+ * @param [in] wakeup   The wakeup function, NULL to remove it.
+ * @param [in] context  The argument given to the wakeup function.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_setWakeup(streamBufferHandle_t self, streamBufferWakeup_t wakeup, void *context);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_prepareWait    Ask the producer to call the wakeup
+ *      function the next time it adds records. The consumer may then sleep
+ *      until the wakeup function is called. This function shall only be called
+ *      from the consumer context.
+ * @param [in] self The stream buffer handle.
+ * @return true if the stream buffer is empty and the consumer may sleep, false
+ *      if records are available or no wakeup function is set.
+ */
+/*****************************************************************************/
+bool streamBuffer_prepareWait(streamBufferHandle_t self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_getStats   Get a snapshot of the counters of the
+ *      stream buffer. The counters are only kept when the library is built
+ *      with STREAM_BUFFER_ENABLE_STATS. This function may be called from any
+ *      context, each counter is read atomically but the snapshot as a whole
+ *      isn't taken at once. In the RAW format, the records counters stay at 0.
  * @param [in] self The stream buffer handle.
- * @return true if the stream buffer is empty, false otherwise. 
+ * @param [out] stats   The counters of the stream buffer.
+ * @return true if successful, false otherwise or if the counters are compiled out.
+ */
+/*****************************************************************************/
+bool streamBuffer_getStats(streamBufferHandle_t self, streamBufferStats_t *stats);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_getExpiredCount    Get the number of records dropped
+ *      by the consumer functions because they outlived the time to live. This
+ *      function may be called from any context.
+ * @param [in] self The stream buffer handle.
+ * @param [out] count   The number of expired records.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBuffer_getExpiredCount(streamBufferHandle_t self, uint64_t *count);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBuffer_empty  Discard all the records stored in the stream
+ *      buffer. This function shall only be called from the consumer context.
+ * @param [in] self The stream buffer handle.
+ * @return true if successful, false otherwise. 
  */
 /*****************************************************************************/
 bool streamBuffer_empty(streamBufferHandle_t self);
@@ -0,0 +1,263 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#ifndef __STREAM_BUFFER_HPP_
+#define __STREAM_BUFFER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "streamBuffer.h"
+
+/******************************************************************************
+ ********************** Public Type/Constant definitions **********************
+ *****************************************************************************/
+namespace cToolbox
+{
+
+/**
+ * A record peeked from a stream buffer, see StreamBuffer::peek. The record is
+ * removed from the stream buffer when the guard is destroyed or released. No
+ * other consumer function shall be called while a guard holds a record.
+ */
+class PeekedRecord
+{
+public:
+    PeekedRecord() noexcept = default;
+    PeekedRecord(const PeekedRecord&) = delete;
+    PeekedRecord& operator=(const PeekedRecord&) = delete;
+
+    PeekedRecord(PeekedRecord &&other) noexcept :
+        handle(std::exchange(other.handle, nullptr)), record(other.record)
+    {
+    }
+
+    PeekedRecord& operator=(PeekedRecord &&other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            handle = std::exchange(other.handle, nullptr);
+            record = other.record;
+        }
+        return *this;
+    }
+
+    ~PeekedRecord()
+    {
+        release();
+    }
+
+    /** True if the guard holds a record */
+    explicit operator bool() const noexcept
+    {
+        return nullptr != handle;
+    }
+
+    /** Size of the record in bytes */
+    std::size_t size() const noexcept
+    {
+        return record.size;
+    }
+
+    /** The record data where it lies in the buffer, the second span is empty unless the record is split */
+    std::array<std::span<const std::byte>, 2> spans() const noexcept
+    {
+        return { toSpan(record.spans[0]), toSpan(record.spans[1]) };
+    }
+
+    /** Remove the record from the stream buffer before the guard is destroyed */
+    void release() noexcept
+    {
+        if(nullptr != handle)
+        {
+            streamBuffer_release(handle);
+            handle = nullptr;
+        }
+    }
+
+private:
+    friend class StreamBuffer;
+
+    PeekedRecord(streamBufferHandle_t handle, const streamBufferRecord_t &record) noexcept :
+        handle(handle), record(record)
+    {
+    }
+
+    static std::span<const std::byte> toSpan(const streamBufferSpan_t &span) noexcept
+    {
+        return { reinterpret_cast<const std::byte*>(span.data), span.size };
+    }
+
+    streamBufferHandle_t handle = nullptr;
+    streamBufferRecord_t record = { };
+};
+
+/**
+ * Owner of a stream buffer instance. The instance is freed when its owner is
+ * destroyed. Every method is an inline call to the matching streamBuffer
+ * function, with the same context rules and the same bool error reporting.
+ */
+class StreamBuffer
+{
+public:
+    StreamBuffer() noexcept = default;
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    StreamBuffer(StreamBuffer &&other) noexcept :
+        handle(std::exchange(other.handle, nullptr)), isDynamic(other.isDynamic)
+    {
+    }
+
+    StreamBuffer& operator=(StreamBuffer &&other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            handle = std::exchange(other.handle, nullptr);
+            isDynamic = other.isDynamic;
+        }
+        return *this;
+    }
+
+    ~StreamBuffer()
+    {
+        reset();
+    }
+
+    /** Take an instance from the static pool, see streamBuffer_createStatic. It's invalid on failure. */
+    static StreamBuffer createStatic(std::span<std::uint8_t> buffer) noexcept
+    {
+        return StreamBuffer(streamBuffer_createStatic(buffer.data(), buffer.size()), false);
+    }
+
+    /** Allocate an instance on the heap, see streamBuffer_create. It's invalid on failure. */
+    static StreamBuffer create(std::size_t bufferSize, std::size_t maxBufferSize = 0) noexcept
+    {
+        return StreamBuffer(streamBuffer_create(bufferSize, maxBufferSize), true);
+    }
+
+    /** True if the owner holds an instance */
+    explicit operator bool() const noexcept
+    {
+        return nullptr != handle;
+    }
+
+    /** The handle to use with the C functions, the ownership is kept */
+    streamBufferHandle_t get() const noexcept
+    {
+        return handle;
+    }
+
+    /** Free the instance, if any */
+    void reset() noexcept
+    {
+        if(nullptr != handle)
+        {
+            isDynamic ? streamBuffer_free(&handle) : streamBuffer_freeStatic(&handle);
+            handle = nullptr;
+        }
+    }
+
+    bool configure(const streamBufferConfig_t &config) noexcept
+    {
+        return streamBuffer_configure(handle, &config);
+    }
+
+    /** Add a record, see streamBuffer_put */
+    bool put(std::span<const std::byte> data) noexcept
+    {
+        return streamBuffer_put(handle, reinterpret_cast<const std::uint8_t*>(data.data()), data.size());
+    }
+
+    /** Add the bytes of a record of trivially copyable values, see streamBuffer_put */
+    template<typename T, std::size_t N>
+        requires std::is_trivially_copyable_v<T>
+    bool put(std::span<const T, N> data) noexcept
+    {
+        return put(std::span<const std::byte>(std::as_bytes(data)));
+    }
+
+    /**
+     * Copy the next record into data and remove it, see streamBuffer_getBounded.
+     * @return The part of data holding the record, nothing if there's no
+     *      record or if it doesn't fit, in which case it stays in the stream buffer.
+     */
+    std::optional<std::span<std::byte>> get(std::span<std::byte> data) noexcept
+    {
+        std::size_t size = 0;
+
+        if(!streamBuffer_getBounded(handle, reinterpret_cast<std::uint8_t*>(data.data()), data.size(), &size))
+        {
+            return std::nullopt;
+        }
+        return data.first(size);
+    }
+
+    /** Get the next record without copying it, see streamBuffer_peek. The guard is empty if there's no record. */
+    PeekedRecord peek() noexcept
+    {
+        streamBufferRecord_t record;
+
+        if(!streamBuffer_peek(handle, &record))
+        {
+            return PeekedRecord();
+        }
+        return PeekedRecord(handle, record);
+    }
+
+    /** Number of bytes used in the buffer, nothing in case of error */
+    std::optional<std::size_t> space() const noexcept
+    {
+        std::size_t byteCount = 0;
+
+        if(!streamBuffer_space(handle, &byteCount))
+        {
+            return std::nullopt;
+        }
+        return byteCount;
+    }
+
+    /** Discard all the records, see streamBuffer_empty */
+    bool clear() noexcept
+    {
+        return streamBuffer_empty(handle);
+    }
+
+private:
+    StreamBuffer(streamBufferHandle_t handle, bool isDynamic) noexcept :
+        handle(handle), isDynamic(isDynamic)
+    {
+    }
+
+    streamBufferHandle_t handle = nullptr;
+    bool isDynamic = false;
+};
+
+}
+
+#endif
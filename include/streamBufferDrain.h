@@ -0,0 +1,146 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __STREAM_BUFFER_DRAIN_H_
+#define __STREAM_BUFFER_DRAIN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "streamBuffer.h"
+
+/******************************************************************************
+ ********************** Public Type/Constant definitions **********************
+ *****************************************************************************/
+#define STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT (16)     /**< Maximum number of writes handed to the kernel at once */
+
+/**
+ * A span of the stream buffer handed to the kernel.
+ */
+typedef struct streamBufferDrainSlot
+{
+    const uint8_t *data;    // Start of the span in the buffer of the stream buffer
+    uint32_t size;          // Size of the span in bytes
+    uint32_t writtenSize;   // Number of bytes of the span written so far
+    uint32_t skippedSize;   // Number of wrap padding bytes before the span, released with it but never written
+    uint64_t offset;        // Position of the span in the file
+    bool isInFlight;        // A write of the span is submitted and not completed yet
+} streamBufferDrainSlot_t;
+
+/**
+ * Drains the bytes of a stream buffer to a file or a socket with io_uring,
+ * without copying them. The content shall never be accessed directly.
+ */
+typedef struct streamBufferDrain
+{
+    streamBufferHandle_t streamBuffer;  // The drained stream buffer
+    int fd;                             // The file or socket written to
+    bool isSocket;                      // Send the bytes in order instead of writing at file offsets
+    uint64_t nextOffset;                // Position in the file of the next span
+    int ringFd;                         // The io_uring instance
+    void *submissionRing;               // Mapping of the submission ring
+    size_t submissionRingSize;
+    void *completionRing;               // Mapping of the completion ring, may be the submission ring mapping
+    size_t completionRingSize;
+    void *entries;                      // Mapping of the submission queue entries
+    size_t entriesSize;
+    uint32_t *submissionHead;           // Fields of the rings shared with the kernel
+    uint32_t *submissionTail;
+    uint32_t *submissionMask;
+    uint32_t *submissionArray;
+    uint32_t *completionHead;
+    uint32_t *completionTail;
+    uint32_t *completionMask;
+    void *completions;
+    streamBufferDrainSlot_t slots[STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT];  // Spans not released yet, oldest first
+    uint32_t firstSlot;                 // Index of the oldest span
+    uint32_t slotCount;                 // Number of spans not released yet
+    uint32_t inFlightCount;             // Number of writes submitted and not completed yet
+    size_t queuedSize;                  // Number of bytes in the spans
+} streamBufferDrain_t;
+
+/******************************************************************************
+ ************************ Public function declarations ************************
+ *****************************************************************************/
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferDrain_init  Create an io_uring instance to drain a
+ *      stream buffer to a file or a socket. The drain becomes the consumer of
+ *      the stream buffer. The modes streamBuffer_peekBytes doesn't serve are
+ *      rejected: multi-producer, aligned or compressed records and a time to
+ *      live. A dynamic stream buffer shall not be resized while it's drained.
+ * @param [out] self    The drain instance to initialize.
+ * @param [in] streamBuffer The stream buffer to drain.
+ * @param [in] fd   The file or the connected stream socket to write to.
+ * @param [in] isSocket True for a socket: the bytes are sent in order with
+ *      MSG_NOSIGNAL and MSG_WAITALL, the socket may be non blocking. False
+ *      for a file: the bytes are written at increasing positions, from
+ *      offset.
+ * @param [in] offset   Position in the file of the first byte, ignored for a
+ *      socket.
+ * @return true if successful, false otherwise (e.g. the mode of the stream
+ *      buffer isn't supported).
+ */
+/*****************************************************************************/
+bool streamBufferDrain_init(streamBufferDrain_t *self, streamBufferHandle_t streamBuffer, int fd, bool isSocket, uint64_t offset);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferDrain_deinit    Close the io_uring instance. The writes
+ *      still in flight are abandoned and their bytes stay in the stream
+ *      buffer, so the caller should first run the drain until it's idle.
+ * @param [in] self The drain instance.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferDrain_deinit(streamBufferDrain_t *self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferDrain_run   Release the bytes of the completed writes
+ *      from the stream buffer, then hand the new bytes of the stream buffer to
+ *      the kernel. The spans of the buffer are written in place, so the bytes
+ *      are never copied, and all the new writes are submitted with a single
+ *      system call, none when there's nothing to submit nor to wait for.
+ *      Short writes are submitted again. This function shall only be called
+ *      from the consumer context.
+ * @param [in] self The drain instance.
+ * @param [in] isWaiting    Wait for at least one write to complete, if any is
+ *      in flight. Waiting for the producer is left to the caller, e.g. with
+ *      streamBuffer_prepareWait.
+ * @param [out] drainedSize The number of bytes released from the stream buffer.
+ * @param [out] isIdle  True if no byte is waiting for its write to complete.
+ * @return true if successful, false in case of error (e.g. a write failed).
+ */
+/*****************************************************************************/
+bool streamBufferDrain_run(streamBufferDrain_t *self, bool isWaiting, size_t *drainedSize, bool *isIdle);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
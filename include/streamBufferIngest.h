@@ -0,0 +1,126 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __STREAM_BUFFER_INGEST_H_
+#define __STREAM_BUFFER_INGEST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "streamBuffer.h"
+
+/******************************************************************************
+ ********************** Public Type/Constant definitions **********************
+ *****************************************************************************/
+
+/**
+ * The way the frames are delimited in the incoming bytes.
+ */
+typedef enum streamBufferIngestFraming
+{
+    STREAM_BUFFER_INGEST_FRAMING_PREFIX = 0,    /**< Each frame starts with its length on 1, 2 or 4 bytes */
+    STREAM_BUFFER_INGEST_FRAMING_DELIMITER,     /**< Each frame ends with a delimiter byte */
+} streamBufferIngestFraming_t;
+
+/**
+ * The framing rule of the incoming bytes.
+ */
+typedef struct streamBufferIngestRule
+{
+    streamBufferIngestFraming_t framing;    // How the frames are delimited
+    uint8_t prefixSize;                     // Size of the length prefix in bytes: 1, 2 or 4
+    bool isLittleEndian;                    // Byte order of the length prefix
+    uint8_t delimiter;                      // The byte ending a frame, not stored in the record
+    size_t maxFrameSize;                    // Longer frames are invalid, see streamBuffer_getMaxReserveSize
+} streamBufferIngestRule_t;
+
+/**
+ * Reassembles frames from chunks of bytes directly into reserved records of a
+ * stream buffer. The content shall never be accessed directly.
+ */
+typedef struct streamBufferIngest
+{
+    streamBufferHandle_t streamBuffer;  // The stream buffer receiving the frames
+    streamBufferIngestRule_t rule;      // The framing rule
+    uint8_t prefix[4];                  // The bytes of the length prefix received so far
+    uint8_t prefixCount;                // Number of bytes in prefix
+    uint8_t *frame;                     // The reserved record, NULL between frames
+    size_t frameSize;                   // Expected size of the frame with a length prefix
+    size_t frameCount;                  // Number of bytes of the frame received so far
+} streamBufferIngest_t;
+
+/******************************************************************************
+ ************************ Public function declarations ************************
+ *****************************************************************************/
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferIngest_init Initialize an ingest stage. It becomes the
+ *      producer of the stream buffer: it keeps a record reserved while a frame
+ *      is incomplete, so nothing else shall add records meanwhile.
+ * @param [out] self    The ingest instance to initialize.
+ * @param [in] streamBuffer The stream buffer receiving the frames. Its format
+ *      shall store records, see streamBuffer_reserve.
+ * @param [in] rule The framing rule of the incoming bytes. Its
+ *      maxFrameSize shall not exceed streamBuffer_getMaxReserveSize.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferIngest_init(streamBufferIngest_t *self, streamBufferHandle_t streamBuffer, const streamBufferIngestRule_t *rule);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferIngest_push Parse a chunk of bytes. The bytes of the
+ *      frames are copied straight into reserved records, each record being
+ *      committed once its frame is complete. Empty frames are dropped. When
+ *      the stream buffer is full, the parsing stops and the rest of the chunk
+ *      shall be pushed again later.
+ * @param [in] self The ingest instance.
+ * @param [in] data A pointer to the bytes.
+ * @param [in] size The number of bytes.
+ * @param [out] consumedSize    The number of bytes parsed.
+ * @return true if successful, false if a frame is longer than the maximum
+ *      frame size or in case of error. The partial frame is then dropped and
+ *      the stream is out of sync until streamBufferIngest_reset is called.
+ */
+/*****************************************************************************/
+bool streamBufferIngest_push(streamBufferIngest_t *self, const uint8_t *data, size_t size, size_t *consumedSize);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferIngest_reset    Drop the partial frame and wait for the
+ *      start of a new frame, e.g. after a reconnection.
+ * @param [in] self The ingest instance.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferIngest_reset(streamBufferIngest_t *self);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
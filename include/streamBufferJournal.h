@@ -0,0 +1,184 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __STREAM_BUFFER_JOURNAL_H_
+#define __STREAM_BUFFER_JOURNAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "streamBuffer.h"
+
+/******************************************************************************
+ ********************** Public Type/Constant definitions **********************
+ *****************************************************************************/
+#define STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH (256)     /**< Maximum length of the path of a segment, terminator included */
+#define STREAM_BUFFER_JOURNAL_HEADER_SIZE (8)           /**< Size of the header at the start of each segment in bytes */
+
+/**
+ * An append-only journal made of memory mapped files called segments. A segment
+ * is named "<directory>/<name>.<index>", with an index of 8 decimal digits, and
+ * holds the records with the framing of STREAM_BUFFER_FORMAT_PREFIX16, each one
+ * optionally followed by the CRC-8 of its prefix and data. A new segment is
+ * started when the current one is full. The content shall never be accessed
+ * directly.
+ * A record is only seen once complete if the process crashes. After a power
+ * loss or an operating system crash, the records appended since the last
+ * streamBufferJournal_sync may be partially written in any order, and only
+ * the checksum detects them: enable it when the journal shall survive those.
+ */
+typedef struct streamBufferJournal
+{
+    char pathPrefix[STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH];     // "<directory>/<name>"
+    uint8_t *segment;           // The mapping of the segment being written
+    size_t mappingSize;         // Size of the segment being written in bytes
+    size_t segmentSize;         // Size of the new segments in bytes
+    size_t writeOffset;         // Offset of the next record in the segment
+    uint32_t segmentIndex;      // Index of the segment being written
+    bool isChecksumEnabled;     // Each record of the segment carries a CRC-8
+} streamBufferJournal_t;
+
+/**
+ * Iterates over the records of a segment without copying them. The content
+ * shall never be accessed directly.
+ */
+typedef struct streamBufferJournalReader
+{
+    const uint8_t *segment;     // The read only mapping of the segment
+    size_t segmentSize;         // Size of the segment in bytes
+    size_t readOffset;          // Offset of the next record in the segment
+    bool isChecksumEnabled;     // Each record of the segment carries a CRC-8
+} streamBufferJournalReader_t;
+
+/******************************************************************************
+ ************************ Public function declarations ************************
+ *****************************************************************************/
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_open    Open a journal for writing. The last
+ *      segment found in the directory is scanned up to its last valid record,
+ *      and what follows is erased. A torn or corrupted record (when the
+ *      checksum is enabled) is therefore dropped, with the records after it.
+ *      A new segment is started if the last one was written with another
+ *      checksum option or if there is none.
+ * @param [out] self    The journal instance to initialize.
+ * @param [in] directory    The directory holding the segments.
+ * @param [in] name The name of the journal.
+ * @param [in] segmentSize  The size of new segments in bytes.
+ * @param [in] isChecksumEnabled    true to store a CRC-8 with each record.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_open(streamBufferJournal_t *self, const char *directory, const char *name, size_t segmentSize, bool isChecksumEnabled);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_append  Copy a record at the end of the journal.
+ *      The record survives a crash of the process. It survives a power loss
+ *      only once streamBufferJournal_sync returned, and a torn record left
+ *      by a power loss before that is only dropped when the checksum is
+ *      enabled.
+ * @param [in] self The journal instance.
+ * @param [in] data A pointer to the record.
+ * @param [in] size The size of the record in bytes, up to 65535 bytes and the
+ *      space available in an empty segment.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_append(streamBufferJournal_t *self, const uint8_t *data, size_t size);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_sync    Write the segment being written to the
+ *      storage and wait for completion.
+ * @param [in] self The journal instance.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_sync(streamBufferJournal_t *self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_close   Unmap the segment being written.
+ * @param [in] self The journal instance.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_close(streamBufferJournal_t *self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_findSegments    Get the range of the segment
+ *      indexes of a journal.
+ * @param [in] directory    The directory holding the segments.
+ * @param [in] name The name of the journal.
+ * @param [out] firstIndex  The index of the oldest segment.
+ * @param [out] lastIndex   The index of the newest segment.
+ * @return true if at least one segment exists, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_findSegments(const char *directory, const char *name, uint32_t *firstIndex, uint32_t *lastIndex);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_openReader  Map a segment for reading.
+ * @param [out] self    The reader instance to initialize.
+ * @param [in] directory    The directory holding the segments.
+ * @param [in] name The name of the journal.
+ * @param [in] segmentIndex The index of the segment to read.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_openReader(streamBufferJournalReader_t *self, const char *directory, const char *name, uint32_t segmentIndex);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_readNext    Get the next record of the segment.
+ *      The record points into the mapping, it stays valid until the reader is
+ *      closed.
+ * @param [in] self The reader instance.
+ * @param [out] record  The record data.
+ * @return true if successful, false at the end of the segment or at the first
+ *      invalid record.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_readNext(streamBufferJournalReader_t *self, streamBufferSpan_t *record);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferJournal_closeReader Unmap the segment of a reader.
+ * @param [in] self The reader instance.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferJournal_closeReader(streamBufferJournalReader_t *self);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,102 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __STREAM_BUFFER_NOTIFY_H_
+#define __STREAM_BUFFER_NOTIFY_H_
+
+#include <stdbool.h>
+
+#include "streamBuffer.h"
+
+/******************************************************************************
+ ********************** Public Type/Constant definitions **********************
+ *****************************************************************************/
+
+/**
+ * Binds a stream buffer to a Linux eventfd, so the consumer can wait for its
+ * records with poll, select or epoll. The producers only write to the eventfd
+ * when the consumer is about to sleep, see streamBuffer_prepareWait.
+ */
+typedef struct streamBufferNotify
+{
+    streamBufferHandle_t streamBuffer;  // The stream buffer bound to the eventfd
+    int fd;                             // The eventfd, readable when records are available
+} streamBufferNotify_t;
+
+/******************************************************************************
+ ************************ Public function declarations ************************
+ *****************************************************************************/
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferNotify_init Create an eventfd and set it as the wakeup
+ *      of a stream buffer. The previous wakeup function of the stream buffer is
+ *      replaced.
+ * @param [out] self    The notification instance to initialize.
+ * @param [in] streamBuffer The stream buffer handle.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferNotify_init(streamBufferNotify_t *self, streamBufferHandle_t streamBuffer);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferNotify_deinit   Remove the wakeup of the stream buffer
+ *      and close the eventfd.
+ * @param [in] self The notification instance.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferNotify_deinit(streamBufferNotify_t *self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferNotify_getFd    Get the file descriptor to register in
+ *      the event loop of the consumer. It becomes readable when a producer adds
+ *      records after streamBufferNotify_arm returned true.
+ * @param [in] self The notification instance.
+ * @return The eventfd, -1 if the instance is invalid.
+ */
+/*****************************************************************************/
+int streamBufferNotify_getFd(const streamBufferNotify_t *self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferNotify_arm  Clear the pending notification and ask the
+ *      producers for the next one. The consumer shall call it once it read all
+ *      the records, and only wait for the eventfd if it returns true. This
+ *      function shall only be called from the consumer context.
+ * @param [in] self The notification instance.
+ * @return true if the stream buffer is empty and the consumer may wait for
+ *      the eventfd, false if records are available or in case of error.
+ */
+/*****************************************************************************/
+bool streamBufferNotify_arm(streamBufferNotify_t *self);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,136 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __STREAM_BUFFER_SCHEDULER_H_
+#define __STREAM_BUFFER_SCHEDULER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "streamBuffer.h"
+
+/******************************************************************************
+ ********************** Public Type/Constant definitions **********************
+ *****************************************************************************/
+#define STREAM_BUFFER_SCHEDULER_MAX_LANE_COUNT (32)     /**< One bit of the ready bitmap per lane */
+/** Size of the metadata of a scheduler instance in bytes */
+#define STREAM_BUFFER_SCHEDULER_STORAGE_SIZE (64 + 32 * STREAM_BUFFER_SCHEDULER_MAX_LANE_COUNT)
+
+typedef struct streamBufferScheduler *streamBufferSchedulerHandle_t;
+
+/**
+ * A stream buffer drained by a scheduler.
+ */
+typedef struct streamBufferLane
+{
+    streamBufferHandle_t streamBuffer;  // The stream buffer of the lane
+    bool isPriority;                    // Drained before the weighted lanes, the lowest index first
+    uint32_t quantum;                   // Bytes a weighted lane may give per round, at least 1
+} streamBufferLane_t;
+
+/**
+ * The memory used to store the metadata of a scheduler instance. The content
+ * shall never be accessed directly.
+ */
+typedef struct streamBufferSchedulerStatic
+{
+    uint64_t opaque[STREAM_BUFFER_SCHEDULER_STORAGE_SIZE / sizeof(uint64_t)];
+} streamBufferSchedulerStatic_t;
+
+/******************************************************************************
+ ************************ Public function declarations ************************
+ *****************************************************************************/
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferScheduler_init  Create a scheduler draining several
+ *      stream buffers, called lanes. The strict priority lanes are drained
+ *      first. The other lanes share the rest with a deficit round robin: each
+ *      round, a lane may give up to its quantum of bytes, plus what it didn't
+ *      use in the previous rounds while it had records. The scheduler becomes
+ *      the consumer of every lane and owns their wakeup function: a lane found
+ *      empty is left aside until a producer adds records to it, so the empty
+ *      lanes cost nothing. The lanes can't be shared instances.
+ * @param [in] storage  A valid pointer to the memory used to store the
+ *      metadata of the instance.
+ * @param [in] lanes    The lanes, in priority order for the strict priority
+ *      lanes and in round robin order for the others.
+ * @param [in] laneCount    The number of lanes, up to
+ *      STREAM_BUFFER_SCHEDULER_MAX_LANE_COUNT.
+ * @param [in] wakeup   The function called from a producer context when an
+ *      idle lane gets records, NULL if unused. See
+ *      streamBufferScheduler_prepareWait.
+ * @param [in] context  The argument given to the wakeup function.
+ * @return The scheduler handle if successful, NULL otherwise.
+ */
+/*****************************************************************************/
+streamBufferSchedulerHandle_t streamBufferScheduler_init(streamBufferSchedulerStatic_t *storage, const streamBufferLane_t *lanes,
+    size_t laneCount, streamBufferWakeup_t wakeup, void *context);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferScheduler_deinit    Remove the wakeup function of each
+ *      lane. The stream buffers can then be used without the scheduler.
+ * @param [in] self A pointer to the scheduler handle.
+ * @return true if successful, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferScheduler_deinit(streamBufferSchedulerHandle_t *self);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferScheduler_get   Get the next record to process
+ *      across all the lanes. This function shall only be called from the
+ *      consumer context.
+ * @param [in] self The scheduler handle.
+ * @param [out] data    A pointer to the area to copy the record in.
+ * @param [in] capacity The size of the data area in bytes.
+ * @param [out] size    The size of the record in bytes. It's 0 if all the
+ *      lanes are empty.
+ * @param [out] laneIndex   The index of the lane of the record.
+ * @return true if successful, false otherwise (e.g. all the lanes are empty or
+ *      the next record doesn't fit in capacity bytes, it then stays in its
+ *      lane).
+ */
+/*****************************************************************************/
+bool streamBufferScheduler_get(streamBufferSchedulerHandle_t self, uint8_t *data, size_t capacity, size_t *size, size_t *laneIndex);
+
+/**************************** Function Description ***************************/
+/**
+ * @details streamBufferScheduler_prepareWait   Check if all the lanes were
+ *      found empty by streamBufferScheduler_get and nothing was added since.
+ *      The consumer may then sleep until the wakeup function is called.
+ * @param [in] self The scheduler handle.
+ * @return true if the consumer may sleep, false otherwise.
+ */
+/*****************************************************************************/
+bool streamBufferScheduler_prepareWait(streamBufferSchedulerHandle_t self);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
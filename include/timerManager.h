@@ -33,7 +33,19 @@ extern "C" {
 /*************************************************************************
  ******************** Public Type/Constant definitions *******************
  ************************************************************************/
-#define MAX_TIMER_COUNT    10
+#ifndef MAX_TIMER_COUNT
+#define MAX_TIMER_COUNT    10   /**< Number of timers available to timerManager_createTimer */
+#endif
+
+/**
+ * Number of bits of the deadline resolved by each level of the timing wheel. The wheel holds
+ * ceil(32 / TIMER_WHEEL_SLOT_BITS) levels of 2^TIMER_WHEEL_SLOT_BITS slot pointers whatever
+ * MAX_TIMER_COUNT is: 8 bits cost 4 x 256 pointers (8 KiB on a 64 bits target), 4 bits cost
+ * 8 x 16 pointers (1 KiB). Fewer bits save memory but move a long timer through more levels.
+ */
+#ifndef TIMER_WHEEL_SLOT_BITS
+#define TIMER_WHEEL_SLOT_BITS    8
+#endif
 
 typedef void* timerHandle_t;
 typedef void (*timerExpired_t)(timerHandle_t timerHandle);
@@ -67,7 +79,8 @@ bool timerManager_init(timerLockCb_t lockCb);
 /************************* Function Description *************************/
 /**
  * @details timerManager_uninit Uninitialize the timeManager layer. This function doesn't delete
- *      any timer and shall be called only at the end of the program execution.
+ *      any timer but stops the started ones, and shall be called only at the end of the program
+ *      execution.
  * @return true if the uninitialization is successful, false otherwise.
  */
 /************************************************************************/
@@ -77,6 +90,9 @@ bool timerManager_uninit();
 /**
  * @details timerManager_run    Main function of the timerManager layer. This function checks if a
         timer expired and call it's callback function if it did. Therefore, it shall be called regularly.
+ *      The timers are kept in a hierarchical timing wheel, so a call only visits the slots of the ticks
+ *      elapsed since the previous call and the started timers expiring in them, whatever the number of
+ *      timers. Idle stretches without any timer due are skipped.
  */
 /************************************************************************/
 void timerManager_run();
@@ -129,6 +145,28 @@ bool timerManager_stopTimer(timerHandle_t timer);
  /************************************************************************/
 bool timerManager_incrementTimeBase();
 
+/************************* Function Description *************************/
+/**
+ * @details timerManager_advanceTimeBase    Advances the internal tick counter by several ticks at once.
+ *      It lets a tickless host sleep until the next expiry returned by timerManager_getNextExpiry and
+ *      catch up in one step, the following call to timerManager_run expiring every timer due meanwhile.
+ * @param [in] tickCount    The number of ticks elapsed.
+ * @return true if the internal tick counter is successfuly advanced, false otherwise.
+ */
+/************************************************************************/
+bool timerManager_advanceTimeBase(uint32_t tickCount);
+
+/************************* Function Description *************************/
+/**
+ * @details timerManager_getNextExpiry  Get the number of ticks until the next timer expires. The earliest
+ *      deadline is cached and only searched again after the timer holding it is stopped or expired.
+ * @param [out] tickCount   The number of ticks until the next expiry, 0 if a timer is already due and
+ *      waits for timerManager_run.
+ * @return true if a timer is started and tickCount is set, false otherwise.
+ */
+/************************************************************************/
+bool timerManager_getNextExpiry(uint32_t *tickCount);
+
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,254 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#include <string.h>
+
+#include "lzUtils.h"
+#include "miscUtils.h"
+
+/******************************************************************************
+ ********************** Local Type/Constant definitions ***********************
+ *****************************************************************************/
+#define LZ_MIN_MATCH_LENGTH (4)
+#define LZ_OFFSET_SIZE (2)
+#define LZ_HASH_BITS (10)
+#define LZ_HASH_MULTIPLIER (2654435761U)    // Knuth's multiplicative hash
+#define LZ_TOKEN_LENGTH_MASK (0x0F)
+#define LZ_TOKEN_LITERAL_SHIFT (4)
+#define LZ_LENGTH_EXTENSION_MAX (255)
+
+// Each sequence starts with a token holding the number of literals in its
+// high nibble and the match length minus LZ_MIN_MATCH_LENGTH in its low
+// nibble. A nibble of 15 is extended by the following bytes, up to the first
+// one below 255. The literals and a 16 bits little endian offset follow. The
+// last sequence ends with its literals, without any match.
+
+/******************************************************************************
+ ************************ Local function declarations *************************
+ *****************************************************************************/
+static uint32_t getHash(const uint8_t *data);
+static bool writeSequence(const uint8_t *literals, size_t literalCount, size_t offset, size_t matchLength, uint8_t *output,
+    size_t capacity, size_t *outputIndex);
+static bool writeLength(size_t length, uint8_t *output, size_t capacity, size_t *outputIndex);
+static bool readLength(size_t nibble, const uint8_t *data, size_t size, size_t *index, size_t *length);
+
+/******************************************************************************
+ ************************ Global variables definitions ************************
+ *****************************************************************************/
+
+/******************************************************************************
+ ************************ Local variables declarations ************************
+ *****************************************************************************/
+
+/******************************************************************************
+ ************************ Public function definitions *************************
+ *****************************************************************************/
+bool lzUtils_compress(const uint8_t *data, size_t size, uint8_t *output, size_t capacity, size_t *outputSize)
+{
+    uint16_t positions[1 << LZ_HASH_BITS] = { 0 };
+    size_t anchor = 0;
+    size_t index = 0;
+
+    // Sanity checks
+    if((NULL == data) || (NULL == output) || (NULL == outputSize) || (LZ_UTILS_MAX_INPUT_SIZE < size))
+    {
+        return false;
+    }
+
+    *outputSize = 0;
+    while((index + LZ_MIN_MATCH_LENGTH) <= size)
+    {
+        uint32_t hash = getHash(&data[index]);
+        size_t candidate = positions[hash];
+        size_t matchLength = LZ_MIN_MATCH_LENGTH;
+
+        // The last position with the same hash is the only match candidate
+        positions[hash] = (uint16_t) index;
+        if((candidate >= index) || (0 != memcmp(&data[candidate], &data[index], LZ_MIN_MATCH_LENGTH)))
+        {
+            index++;
+            continue;
+        }
+
+        while(((index + matchLength) < size) && (data[candidate + matchLength] == data[index + matchLength]))
+        {
+            matchLength++;
+        }
+        if(!writeSequence(&data[anchor], index - anchor, index - candidate, matchLength, output, capacity, outputSize))
+        {
+            return false;
+        }
+        index += matchLength;
+        anchor = index;
+    }
+
+    return writeSequence(&data[anchor], size - anchor, 0, 0, output, capacity, outputSize);
+}
+
+bool lzUtils_decompress(const uint8_t *data, size_t size, uint8_t *output, size_t capacity, size_t *outputSize)
+{
+    size_t index = 0;
+    size_t length = 0;
+    size_t offset = 0;
+    uint8_t token = 0;
+
+    // Sanity checks
+    if((NULL == data) || (NULL == output) || (NULL == outputSize) || (0 == size))
+    {
+        return false;
+    }
+
+    *outputSize = 0;
+    while(index < size)
+    {
+        // Literals
+        token = data[index++];
+        if(!readLength(token >> LZ_TOKEN_LITERAL_SHIFT, data, size, &index, &length) || (length > (size - index)) ||
+            (length > (capacity - *outputSize)))
+        {
+            return false;
+        }
+        memcpy(&output[*outputSize], &data[index], length);
+        index += length;
+        *outputSize += length;
+
+        // The last sequence has no match
+        if(index == size)
+        {
+            return true;
+        }
+
+        // Match, which may overlap the bytes it produces
+        if(LZ_OFFSET_SIZE > (size - index))
+        {
+            return false;
+        }
+        offset = data[index] | ((size_t) data[index + 1] << 8);
+        index += LZ_OFFSET_SIZE;
+        if(!readLength(token & LZ_TOKEN_LENGTH_MASK, data, size, &index, &length) || (0 == offset) ||
+            (offset > *outputSize) || ((length + LZ_MIN_MATCH_LENGTH) > (capacity - *outputSize)))
+        {
+            return false;
+        }
+        length += LZ_MIN_MATCH_LENGTH;
+        for(size_t i = 0; i < length; i++)
+        {
+            output[*outputSize] = output[*outputSize - offset];
+            (*outputSize)++;
+        }
+    }
+
+    // A sequence ending with a match isn't the last one
+    return false;
+}
+
+/******************************************************************************
+ ************************* Local function definitions *************************
+ *****************************************************************************/
+static uint32_t getHash(const uint8_t *data)
+{
+    uint32_t value = 0;
+
+    memcpy(&value, data, sizeof(value));
+    return (value * LZ_HASH_MULTIPLIER) >> (32 - LZ_HASH_BITS);
+}
+
+static bool writeSequence(const uint8_t *literals, size_t literalCount, size_t offset, size_t matchLength, uint8_t *output,
+    size_t capacity, size_t *outputIndex)
+{
+    size_t matchNibble = (0 == matchLength) ? 0 : (matchLength - LZ_MIN_MATCH_LENGTH);
+    uint8_t token = (uint8_t) ((MISC_UTILS_MIN(literalCount, (size_t) LZ_TOKEN_LENGTH_MASK) << LZ_TOKEN_LITERAL_SHIFT) |
+        MISC_UTILS_MIN(matchNibble, (size_t) LZ_TOKEN_LENGTH_MASK));
+
+    if(*outputIndex >= capacity)
+    {
+        return false;
+    }
+    output[(*outputIndex)++] = token;
+
+    if(!writeLength(literalCount, output, capacity, outputIndex) || (literalCount > (capacity - *outputIndex)))
+    {
+        return false;
+    }
+    memcpy(&output[*outputIndex], literals, literalCount);
+    *outputIndex += literalCount;
+
+    if(0 == matchLength)
+    {
+        return true;
+    }
+    if(LZ_OFFSET_SIZE > (capacity - *outputIndex))
+    {
+        return false;
+    }
+    output[(*outputIndex)++] = (uint8_t) offset;
+    output[(*outputIndex)++] = (uint8_t) (offset >> 8);
+    return writeLength(matchNibble, output, capacity, outputIndex);
+}
+
+static bool writeLength(size_t length, uint8_t *output, size_t capacity, size_t *outputIndex)
+{
+    // Short lengths fit in the token
+    if(length < LZ_TOKEN_LENGTH_MASK)
+    {
+        return true;
+    }
+
+    // The extension ends with the first byte below 255, even if it's 0
+    length -= LZ_TOKEN_LENGTH_MASK;
+    while(length >= LZ_LENGTH_EXTENSION_MAX)
+    {
+        if(*outputIndex >= capacity)
+        {
+            return false;
+        }
+        output[(*outputIndex)++] = LZ_LENGTH_EXTENSION_MAX;
+        length -= LZ_LENGTH_EXTENSION_MAX;
+    }
+    if(*outputIndex >= capacity)
+    {
+        return false;
+    }
+    output[(*outputIndex)++] = (uint8_t) length;
+    return true;
+}
+
+static bool readLength(size_t nibble, const uint8_t *data, size_t size, size_t *index, size_t *length)
+{
+    uint8_t byte = 0;
+
+    *length = nibble;
+    if(LZ_TOKEN_LENGTH_MASK != nibble)
+    {
+        return true;
+    }
+
+    do
+    {
+        if(*index >= size)
+        {
+            return false;
+        }
+        byte = data[(*index)++];
+        *length += byte;
+    } while(LZ_LENGTH_EXTENSION_MAX == byte);
+    return true;
+}
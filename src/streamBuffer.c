@@ -19,32 +19,185 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 * SOFTWARE.
 *******************************************************************************/
+#include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 
 #include "streamBuffer.h"
 #include "miscUtils.h"
+#include "lzUtils.h"
 
 /******************************************************************************
  ********************** Local Type/Constant definitions ***********************
  *****************************************************************************/
-#define QUEUE_ELEMENT_PREFIX_LENGTH_SIZE (2)
-#define QUEUE_ELEMENT_PREFIX_SIZE (QUEUE_ELEMENT_PREFIX_LENGTH_SIZE)
+#define QUEUE_ELEMENT_PREFIX16_SIZE (2)
+#define QUEUE_ELEMENT_VARINT_MAX_SIZE (5)   // A 32 bits LEB128 value takes at most 5 bytes
+#define QUEUE_ELEMENT_TIMESTAMP_SIZE (4)    // Follows the length of a record when the records expire
+#define QUEUE_ELEMENT_PREFIX_MAX_SIZE (QUEUE_ELEMENT_VARINT_MAX_SIZE + QUEUE_ELEMENT_TIMESTAMP_SIZE)
+#define QUEUE_ELEMENT_PREFIX16_MAX_LENGTH (UINT16_MAX)
+#define QUEUE_WRAP_PADDING_LENGTH (0)   // A record of length 0 means "skip to the start of the buffer"
+#define VARINT_PAYLOAD_MASK (0x7F)
+#define VARINT_CONTINUATION_FLAG (0x80)
+#define VARINT_PAYLOAD_BIT_COUNT (7)
+#define MP_HEADER_SIZE (4)
+#define MP_HEADER_COMMITTED_FLAG (0x1)
+#define MP_HEADER_PADDING_FLAG (0x2)
+#define MP_HEADER_LENGTH_SHIFT (2)
+#define MP_RECORD_ALIGNMENT (4)
+#define CACHE_LINE_SIZE (64)
+#define MAX_RECORD_ALIGNMENT (64)
+#define SHARED_MAGIC (0x53425348)  // "SBSH"
+#define SHARED_VERSION (1)
+#define COMPRESSED_FLAG (0x8000)                // In the prefix of a compressed record
+#define COMPRESSED_MAX_LENGTH (0x7FFF)
+#define COMPRESSED_HEADER_SIZE (2)              // Big endian size of the record once decompressed
 
+// In multi-producer mode, the write index is the end of the space claimed by
+// the producers and a record is made of a 32 bits header followed by its data,
+// padded to 4 bytes. The header holds the length and a committed flag set once
+// the data is written, so the consumer stops at the first record still being
+// written. The consumer clears the memory it gives back, hence a header is
+// never committed before its producer sets it. A record never crosses the end
+// of the buffer: a padding record fills the end of the buffer instead.
+typedef struct recordLocation
+{
+    uint32_t dataIndex;     // Index of the first byte of the record data
+    uint32_t nextIndex;     // Index of the next record
+    size_t length;          // Size of the record data in bytes
+    bool isCompressed;      // The record data is a header and an LZ77 stream
+} recordLocation_t;
+
+// The read and write indexes are free-running counters: they are only masked
+// when the buffer is accessed. Therefore (w_ptr - r_ptr) is the number of used
+// bytes, even when the buffer is completely full. Each index is written by a
+// single context and is separated from the fields of the other context by a
+// whole cache line, so the producer and the consumer never share a line.
 typedef struct streamBuffer
 {
-    uint32_t r_ptr;
-    uint32_t w_ptr;
+    // Producer line
+    atomic_uint_least32_t w_ptr;
+    uint32_t cachedReadIndex;
+    uint32_t reservedIndex;
+    uint32_t reservedSize;
+    uint8_t reservedPrefixSize;
+    bool isReserved;
+#if STREAM_BUFFER_ENABLE_STATS
+    atomic_uint_least64_t putRecordCount;
+    atomic_uint_least64_t putByteCount;
+    atomic_uint_least64_t rejectedPutCount;
+    atomic_uint_least32_t maxUsedSize;
+    atomic_uint_least32_t largestRecordSize;
+#endif
+    uint8_t producerPadding[CACHE_LINE_SIZE];
+
+    // Consumer line
+    atomic_uint_least32_t r_ptr;
+    uint32_t cachedWriteIndex;
+    uint32_t peekedNextIndex;
+    bool isPeeked;
+    atomic_uint_least64_t expiredRecordCount;
+#if STREAM_BUFFER_ENABLE_STATS
+    uint32_t peekedSize;
+    atomic_uint_least64_t getRecordCount;
+    atomic_uint_least64_t getByteCount;
+#endif
+    uint8_t consumerPadding[CACHE_LINE_SIZE];
+
+    // Read only line
     uint32_t mask;
     uint32_t size;
-    uint8_t *buffer;
+    uint32_t maxRecordSize;
+    streamBufferFormat_t format;
+    uint32_t recordAlignment;   // 1 when the records are packed
+    uint32_t timeToLive;        // Age at which a record expires, 0 when the records never expire
+    bool isMultiProducer;
+    bool isCompressed;
+    uintptr_t bufferOffset;     // From the metadata, so a shared instance works at any address
+    bool isInitialized;
+    bool isShared;
+    bool isPooled;
+    bool isDynamic;             // The metadata and the buffer are allocated on the heap
+    uint32_t maxDynamicSize;    // Limit of the growth on demand, 0 when disabled
+    struct streamBuffer *nextFreeInstance;
+    _Atomic(streamBufferWakeup_t) wakeup;   // Loaded once by the producer, can be removed while it runs
+    void *wakeupContext;
+    streamBufferGetTime_t getTime;
+
+    // Only written by the consumer when it's about to sleep, so the producer
+    // reads it from its cache in the steady state
+    atomic_bool needWakeup;
 } streamBufferMetadata_t;
 
+_Static_assert(sizeof(streamBufferMetadata_t) <= sizeof(streamBufferStatic_t),
+    "STREAM_BUFFER_STATIC_STORAGE_SIZE is too small");
+_Static_assert(_Alignof(streamBufferMetadata_t) <= _Alignof(streamBufferStatic_t),
+    "streamBufferStatic_t isn't aligned enough");
+// A shared region starts with this header, then the metadata and the buffer at
+// fixed offsets. The magic number is written last, so a process attaching the
+// region never sees partially initialized metadata.
+typedef struct sharedRegionHeader
+{
+    atomic_uint_least32_t magic;
+    uint16_t version;
+    uint16_t metadataSize;  // Tells apart builds with another metadata layout
+    uint32_t bufferSize;
+} sharedRegionHeader_t;
+
+_Static_assert(sizeof(sharedRegionHeader_t) <= STREAM_BUFFER_SHARED_HEADER_SIZE,
+    "STREAM_BUFFER_SHARED_HEADER_SIZE is too small");
+_Static_assert(ATOMIC_INT_LOCK_FREE == 2,
+    "The indexes shall be lock free to be shared between processes");
+_Static_assert(sizeof(atomic_uint_least32_t) == MP_HEADER_SIZE,
+    "The multi-producer record header shall be a 32 bits atomic");
+
 /******************************************************************************
  ************************ Local function declarations *************************
  *****************************************************************************/
+static inline uint8_t* getBuffer(streamBufferHandle_t self);
 static streamBufferMetadata_t* getNextFreeStaticInstance(void);
-static void writeDataInBuffer(streamBufferHandle_t self, const uint8_t *data, uint16_t size);
-static void readDataFromBuffer(streamBufferHandle_t self, uint8_t *data, uint16_t size);
+static void releaseStaticInstance(streamBufferMetadata_t *instance);
+static void initInstance(streamBufferMetadata_t *instance, uint8_t *const buffer, size_t bufferSize, bool isPooled);
+static bool isSharingAvailable(void);
+static bool isBufferValid(const uint8_t *buffer, size_t bufferSize);
+static bool isBufferSizeValid(size_t bufferSize);
+static uint8_t* allocateBuffer(size_t bufferSize);
+static bool resizeBuffer(streamBufferHandle_t self, size_t newSize);
+static void growOnDemand(streamBufferHandle_t self, size_t requiredSize, size_t recordCount);
+static size_t getMaxRecordSize(streamBufferHandle_t self, size_t bufferSize);
+static size_t getSizeAfterPrefix(size_t bufferSize, size_t prefixSize);
+static bool isRecordSizeValid(streamBufferHandle_t self, size_t size);
+static size_t getFreeSpace(streamBufferHandle_t self, uint32_t writeIndex, size_t requestedSize);
+static size_t getUsedSpace(streamBufferHandle_t self, uint32_t readIndex, size_t requestedSize);
+static size_t getPrefixSize(streamBufferHandle_t self, size_t length);
+static size_t getTimestampSize(streamBufferHandle_t self, size_t length);
+static void encodePrefix(streamBufferHandle_t self, size_t length, size_t prefixSize, uint8_t *bytes);
+static size_t decodePrefix(streamBufferHandle_t self, uint32_t index, size_t *length);
+static size_t readRecordHeader(streamBufferHandle_t self, uint32_t *readIndex, size_t *length);
+static bool findNextRecord(streamBufferHandle_t self, uint32_t readIndex, recordLocation_t *location);
+static bool readRecord(streamBufferHandle_t self, const recordLocation_t *location, uint8_t *data, size_t capacity, size_t *size);
+static void describeRecord(streamBufferHandle_t self, const recordLocation_t *location, streamBufferRecord_t *record);
+static bool isByteAccessAvailable(streamBufferHandle_t self);
+static void skipWrapPadding(streamBufferHandle_t self, uint32_t index, streamBufferRecord_t *bytes);
+static bool putCompressed(streamBufferHandle_t self, const uint8_t *data, size_t size);
+static void releaseRecords(streamBufferHandle_t self, uint32_t readIndex, uint32_t nextIndex);
+static bool putMultiProducer(streamBufferHandle_t self, const streamBufferSpan_t *records, size_t recordCount);
+static bool putvMultiProducer(streamBufferHandle_t self, const streamBufferSpan_t *fragments, size_t fragmentCount, size_t size);
+static bool claimMultiProducerSpace(streamBufferHandle_t self, size_t totalSize, uint32_t *writeIndex);
+static atomic_uint_least32_t* getMultiProducerHeader(streamBufferHandle_t self, uint32_t index);
+static size_t getMultiProducerRecordSize(size_t length);
+static bool putAligned(streamBufferHandle_t self, const streamBufferSpan_t *fragments, size_t fragmentCount, size_t size);
+static uint32_t getRecordPlacement(streamBufferHandle_t self, uint32_t writeIndex, size_t prefixSize, size_t size, uint32_t *paddingSize);
+static uint32_t alignRecordIndex(streamBufferHandle_t self, uint32_t index);
+static size_t writeRecordInBuffer(streamBufferHandle_t self, uint32_t index, const uint8_t *data, size_t size);
+static void writeDataInBuffer(streamBufferHandle_t self, uint32_t index, const uint8_t *data, size_t size);
+static void readDataFromBuffer(streamBufferHandle_t self, uint32_t index, uint8_t *data, size_t size);
+static void clearDataInBuffer(streamBufferHandle_t self, uint32_t index, size_t size);
+static void wakeConsumer(streamBufferHandle_t self);
+static void countPut(streamBufferHandle_t self, uint32_t writeIndex, size_t recordCount, size_t byteCount, size_t largestSize);
+static void countRejectedPut(streamBufferHandle_t self);
+static void countGet(streamBufferHandle_t self, size_t recordCount, size_t byteCount);
+static void discardExpiredRecords(streamBufferHandle_t self);
+static uint32_t skipExpiredRecords(streamBufferHandle_t self, uint32_t readIndex, uint64_t *count);
 
 /******************************************************************************
  ************************ Global variables definitions ************************
@@ -54,6 +207,8 @@ static void readDataFromBuffer(streamBufferHandle_t self, uint8_t *data, uint16_
  ************************ Local variables declarations ************************
  *****************************************************************************/
 static streamBufferMetadata_t staticInstances[STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT] = { 0 };
+static streamBufferMetadata_t *freeInstanceList = NULL;
+static size_t neverUsedInstanceIndex = 0;
 
 /******************************************************************************
  ************************ Public function definitions *************************
@@ -63,7 +218,7 @@ streamBufferHandle_t streamBuffer_createStatic(uint8_t *const buffer, size_t buf
     streamBufferMetadata_t *newInstance = NULL;
 
     // Sanity checks
-    if((NULL == buffer) || !miscUtils_isPowerOf2(bufferSize))
+    if(!isBufferValid(buffer, bufferSize))
     {
         return NULL;
     }
@@ -72,177 +227,1939 @@ streamBufferHandle_t streamBuffer_createStatic(uint8_t *const buffer, size_t buf
     newInstance = getNextFreeStaticInstance();
     if(NULL != newInstance)
     {
-        newInstance->r_ptr = 0;
-        newInstance->w_ptr = 0;
-        newInstance->mask = bufferSize - 1;
-        newInstance->size = bufferSize;
-        newInstance->buffer = buffer;
+        initInstance(newInstance, buffer, bufferSize, true);
+    }
+    return newInstance;
+}
+
+streamBufferHandle_t streamBuffer_initStatic(streamBufferStatic_t *storage, uint8_t *const buffer, size_t bufferSize)
+{
+    streamBufferMetadata_t *newInstance = (streamBufferMetadata_t*) storage;
+
+    // Sanity checks
+    if((NULL == storage) || !isBufferValid(buffer, bufferSize))
+    {
+        return NULL;
+    }
+
+    initInstance(newInstance, buffer, bufferSize, false);
+    return newInstance;
+}
+
+streamBufferHandle_t streamBuffer_create(size_t bufferSize, size_t maxBufferSize)
+{
+    streamBufferMetadata_t *newInstance = NULL;
+    uint8_t *buffer = NULL;
+
+    // Sanity checks
+    if(!isBufferSizeValid(bufferSize) ||
+        ((0 != maxBufferSize) && (!isBufferSizeValid(maxBufferSize) || (maxBufferSize < bufferSize))))
+    {
+        return NULL;
+    }
+
+    newInstance = aligned_alloc(CACHE_LINE_SIZE, sizeof(streamBufferStatic_t));
+    buffer = allocateBuffer(bufferSize);
+    if((NULL == newInstance) || (NULL == buffer))
+    {
+        free(newInstance);
+        free(buffer);
+        return NULL;
+    }
+
+    initInstance(newInstance, buffer, bufferSize, false);
+    newInstance->isDynamic = true;
+    newInstance->maxDynamicSize = maxBufferSize;
+    return newInstance;
+}
+
+streamBufferHandle_t streamBuffer_initShared(void *region, size_t regionSize, size_t bufferSize)
+{
+    sharedRegionHeader_t *header = region;
+    streamBufferMetadata_t *newInstance = (streamBufferMetadata_t*) ((uint8_t*) region + STREAM_BUFFER_SHARED_HEADER_SIZE);
+    uint8_t *buffer = (uint8_t*) newInstance + STREAM_BUFFER_STATIC_STORAGE_SIZE;
+
+    // Sanity checks
+    if((NULL == region) || (0 != ((uintptr_t) region % CACHE_LINE_SIZE)) || !isBufferValid(buffer, bufferSize) ||
+        (regionSize < STREAM_BUFFER_SHARED_REGION_SIZE(bufferSize)) || !isSharingAvailable())
+    {
+        return NULL;
     }
+
+    atomic_store_explicit(&header->magic, 0, memory_order_relaxed);
+    header->version = SHARED_VERSION;
+    header->metadataSize = sizeof(streamBufferMetadata_t);
+    header->bufferSize = bufferSize;
+    initInstance(newInstance, buffer, bufferSize, false);
+    newInstance->isShared = true;
+    atomic_store_explicit(&header->magic, SHARED_MAGIC, memory_order_release);
     return newInstance;
 }
 
+streamBufferHandle_t streamBuffer_attachShared(void *region, size_t regionSize)
+{
+    sharedRegionHeader_t *header = region;
+    streamBufferMetadata_t *instance = (streamBufferMetadata_t*) ((uint8_t*) region + STREAM_BUFFER_SHARED_HEADER_SIZE);
+
+    // Sanity checks
+    if((NULL == region) || (0 != ((uintptr_t) region % CACHE_LINE_SIZE)) || (regionSize < STREAM_BUFFER_SHARED_REGION_SIZE(0)) ||
+        !isSharingAvailable())
+    {
+        return NULL;
+    }
+
+    // The region shall have been initialized by the same version of the code
+    if((SHARED_MAGIC != atomic_load_explicit(&header->magic, memory_order_acquire)) || (SHARED_VERSION != header->version) ||
+        (sizeof(streamBufferMetadata_t) != header->metadataSize) || (regionSize < STREAM_BUFFER_SHARED_REGION_SIZE(header->bufferSize)) ||
+        (header->bufferSize != instance->size) || !instance->isShared || !instance->isInitialized)
+    {
+        return NULL;
+    }
+    return instance;
+}
+
 bool streamBuffer_freeStatic(streamBufferHandle_t *self)
 {
     streamBufferMetadata_t *instance = NULL;
 
     // Sanity checks
-    if((NULL == self) || (NULL == *self))
+    if((NULL == self) || (NULL == *self) || !(*self)->isInitialized || (*self)->isDynamic)
     {
         return false;
     }
 
+    // A shared instance stays usable by the other processes
     instance = (streamBufferMetadata_t*) *self;
-    instance->buffer = NULL;
+    if(instance->isShared)
+    {
+        *self = NULL;
+        return true;
+    }
+
+    instance->isInitialized = false;
+    if(instance->isPooled)
+    {
+        releaseStaticInstance(instance);
+    }
     *self = NULL;
     return true;
 }
 
-bool streamBuffer_put(streamBufferHandle_t self, const uint8_t *data, uint16_t size)
+bool streamBuffer_free(streamBufferHandle_t *self)
 {
-    size_t usedMemory = 0;
-    uint8_t dataPrefix[QUEUE_ELEMENT_PREFIX_SIZE] = { 0 };
+    streamBufferMetadata_t *instance = NULL;
 
     // Sanity checks
-    if((NULL == self) || (NULL == data) || (0 == size))
+    if((NULL == self) || (NULL == *self) || !(*self)->isInitialized || !(*self)->isDynamic)
     {
         return false;
     }
 
-    // Check if there's enough space in the queue
-    streamBuffer_space(self, &usedMemory);
-    if((QUEUE_ELEMENT_PREFIX_SIZE + size) > (self->size - usedMemory))
+    instance = (streamBufferMetadata_t*) *self;
+    instance->isInitialized = false;
+    free(getBuffer(instance));
+    free(instance);
+    *self = NULL;
+    return true;
+}
+
+bool streamBuffer_configure(streamBufferHandle_t self, const streamBufferConfig_t *config)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == config) || self->isReserved ||
+        (atomic_load_explicit(&self->r_ptr, memory_order_acquire) != atomic_load_explicit(&self->w_ptr, memory_order_acquire)))
     {
         return false;
     }
 
-    // Serialize the prefix
-    miscUtils_uint16ToBigEndianBytes(size, dataPrefix);
+    // The multi-producer records have their own header, aligned on 4 bytes
+    if(config->isMultiProducer)
+    {
+        if((STREAM_BUFFER_FORMAT_PREFIX16 != config->format) || (0 != ((uintptr_t) getBuffer(self) % MP_RECORD_ALIGNMENT)))
+        {
+            return false;
+        }
+
+        if((1 < config->recordAlignment) || config->isCompressed || (0 != config->timeToLive) ||
+            ((self->size / 2) <= MP_HEADER_SIZE))
+        {
+            return false;
+        }
+
+        memset(getBuffer(self), 0, self->size);
+        self->format = config->format;
+        self->recordAlignment = 1;
+        self->isMultiProducer = true;
+        self->isCompressed = false;
+        self->timeToLive = 0;
+        self->maxRecordSize = getMaxRecordSize(self, self->size);
+        return true;
+    }
+
+    switch(config->format)
+    {
+        case STREAM_BUFFER_FORMAT_PREFIX16:
+        case STREAM_BUFFER_FORMAT_VARINT:
+        case STREAM_BUFFER_FORMAT_RAW:
+            break;
 
-    // Write the data
-    writeDataInBuffer(self, dataPrefix, QUEUE_ELEMENT_PREFIX_SIZE);
-    writeDataInBuffer(self, data, size);
+        case STREAM_BUFFER_FORMAT_FIXED:
+            // No prefix, every record has the same size
+            if((0 == config->fixedRecordSize) || (self->size < config->fixedRecordSize))
+            {
+                return false;
+            }
+            break;
+
+        default:
+            return false;
+    }
+
+    // Aligned records have a fixed prefix size so that the position of the
+    // payload doesn't depend on its length
+    if(1 < config->recordAlignment)
+    {
+        if(!miscUtils_isPowerOf2(config->recordAlignment) || (MAX_RECORD_ALIGNMENT < config->recordAlignment) ||
+            (STREAM_BUFFER_FORMAT_PREFIX16 != config->format) || ((self->size / 2) <= config->recordAlignment) ||
+            (0 != ((uintptr_t) getBuffer(self) % config->recordAlignment)))
+        {
+            return false;
+        }
+    }
+
+    // The compression flag takes the most significant bit of the prefix
+    if(config->isCompressed && ((STREAM_BUFFER_FORMAT_PREFIX16 != config->format) || (1 < config->recordAlignment)))
+    {
+        return false;
+    }
+
+    // The timestamp follows the length prefix, and the clock is a function of
+    // this process only
+    if((0 != config->timeToLive) && ((NULL == config->getTime) || self->isShared || config->isCompressed ||
+        (1 < config->recordAlignment) || ((STREAM_BUFFER_FORMAT_PREFIX16 != config->format) &&
+        (STREAM_BUFFER_FORMAT_VARINT != config->format))))
+    {
+        return false;
+    }
+
+    self->format = config->format;
+    self->recordAlignment = MISC_UTILS_MAX(config->recordAlignment, 1);
+    self->isMultiProducer = false;
+    self->isCompressed = config->isCompressed;
+    self->getTime = config->getTime;
+    self->timeToLive = config->timeToLive;
+    self->maxRecordSize = (STREAM_BUFFER_FORMAT_FIXED == config->format) ? config->fixedRecordSize :
+        getMaxRecordSize(self, self->size);
 
+    // Both indexes move to the first aligned record position. The cached
+    // indices aren't maintained in multi-producer mode either.
+    self->cachedReadIndex = alignRecordIndex(self, atomic_load_explicit(&self->r_ptr, memory_order_relaxed));
+    self->cachedWriteIndex = self->cachedReadIndex;
+    atomic_store_explicit(&self->w_ptr, self->cachedReadIndex, memory_order_relaxed);
+    atomic_store_explicit(&self->r_ptr, self->cachedReadIndex, memory_order_release);
     return true;
 }
 
-bool streamBuffer_get(streamBufferHandle_t self, uint8_t *data, uint16_t *size)
+bool streamBuffer_resize(streamBufferHandle_t self, size_t newSize)
+{
+    // Sanity checks
+    if((NULL == self) || !self->isDynamic || !isBufferSizeValid(newSize) || self->isReserved || self->isPeeked ||
+        ((STREAM_BUFFER_FORMAT_FIXED == self->format) && (newSize < self->maxRecordSize)) ||
+        ((newSize / 2) <= self->recordAlignment) || (self->isMultiProducer && ((newSize / 2) <= MP_HEADER_SIZE)))
+    {
+        return false;
+    }
+
+    return resizeBuffer(self, newSize);
+}
+
+bool streamBuffer_put(streamBufferHandle_t self, const uint8_t *data, size_t size)
 {
-    size_t usedMemory = 0;
-    uint8_t prefix[QUEUE_ELEMENT_PREFIX_SIZE] = { 0 };
+    uint32_t writeIndex = 0;
+    size_t recordSize = 0;
 
     // Sanity checks
-    if((NULL == self) || (NULL == data) || (NULL == size))
+    if((NULL == self) || (NULL == data) || !isRecordSizeValid(self, size) || self->isReserved)
     {
         return false;
     }
 
-    // Check if the queue is empty
-    streamBuffer_space(self, &usedMemory);
-    if(0 == usedMemory)
+    growOnDemand(self, getPrefixSize(self, size) + size, 1);
+    if(self->isMultiProducer || (1 != self->recordAlignment))
     {
-        *size = 0;
+        streamBufferSpan_t record = { .data = data, .size = size };
+        return self->isMultiProducer ? putMultiProducer(self, &record, 1) : putAligned(self, &record, 1, size);
+    }
+
+    if(self->isCompressed && putCompressed(self, data, size))
+    {
+        return true;
+    }
+
+    // Check if there's enough space in the queue
+    writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    recordSize = getPrefixSize(self, size) + size;
+    if(getFreeSpace(self, writeIndex, recordSize) < recordSize)
+    {
+        countRejectedPut(self);
         return false;
     }
 
-    // Deserialize the prefix
-    readDataFromBuffer(self, prefix, QUEUE_ELEMENT_PREFIX_SIZE);
-    miscUtils_bigEndianBytesToUint16(prefix, size);
+    // Write the data
+    writeRecordInBuffer(self, writeIndex, data, size);
 
-    // Read the element
-    readDataFromBuffer(self, data, *size);
+    // Publish the element to the consumer
+    atomic_store_explicit(&self->w_ptr, writeIndex + recordSize, memory_order_release);
+    wakeConsumer(self);
+    countPut(self, writeIndex + recordSize, 1, size, size);
     return true;
 }
 
-bool streamBuffer_space(streamBufferHandle_t self, size_t *byteCount)
+bool streamBuffer_putv(streamBufferHandle_t self, const streamBufferSpan_t *fragments, size_t fragmentCount)
 {
+    uint8_t dataPrefix[QUEUE_ELEMENT_PREFIX_MAX_SIZE] = { 0 };
+    uint32_t writeIndex = 0;
+    size_t prefixSize = 0;
+    size_t size = 0;
+
     // Sanity checks
-    if((NULL == self) || (NULL == byteCount))
+    if((NULL == self) || (NULL == fragments) || (0 == fragmentCount) || self->isReserved)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < fragmentCount; i++)
+    {
+        if((NULL == fragments[i].data) || (fragments[i].size > self->maxRecordSize))
+        {
+            return false;
+        }
+        size += fragments[i].size;
+    }
+    if(!isRecordSizeValid(self, size))
+    {
+        return false;
+    }
+
+    growOnDemand(self, getPrefixSize(self, size) + size, 1);
+    if(self->isMultiProducer)
+    {
+        return putvMultiProducer(self, fragments, fragmentCount, size);
+    }
+    if(1 != self->recordAlignment)
+    {
+        return putAligned(self, fragments, fragmentCount, size);
+    }
+
+    // Check once if there's enough space for the whole record
+    writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    prefixSize = getPrefixSize(self, size);
+    if(getFreeSpace(self, writeIndex, prefixSize + size) < (prefixSize + size))
     {
+        countRejectedPut(self);
         return false;
     }
 
-    *byteCount = ((uint32_t) (self->w_ptr - self->r_ptr)) & self->mask;
+    // Write a single prefix, then each fragment straight into the buffer
+    encodePrefix(self, size, prefixSize, dataPrefix);
+    writeDataInBuffer(self, writeIndex, dataPrefix, prefixSize);
+    writeIndex += prefixSize;
+    for(size_t i = 0; i < fragmentCount; i++)
+    {
+        writeDataInBuffer(self, writeIndex, fragments[i].data, fragments[i].size);
+        writeIndex += fragments[i].size;
+    }
+
+    // Publish the element to the consumer
+    atomic_store_explicit(&self->w_ptr, writeIndex, memory_order_release);
+    wakeConsumer(self);
+    countPut(self, writeIndex, 1, size, size);
     return true;
 }
 
-bool streamBuffer_empty(streamBufferHandle_t self)
+bool streamBuffer_putBatch(streamBufferHandle_t self, const streamBufferSpan_t *records, size_t recordCount)
 {
+    uint32_t writeIndex = 0;
+    size_t totalSize = 0;
+    size_t dataSize = 0;
+    size_t largestSize = 0;
+
     // Sanity checks
-    if((NULL == self))
+    if((NULL == self) || (NULL == records) || (0 == recordCount) || self->isReserved)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < recordCount; i++)
+    {
+        if((NULL == records[i].data) || !isRecordSizeValid(self, records[i].size))
+        {
+            return false;
+        }
+        totalSize += getPrefixSize(self, records[i].size) + records[i].size;
+        dataSize += records[i].size;
+        largestSize = MISC_UTILS_MAX(largestSize, records[i].size);
+    }
+
+    growOnDemand(self, totalSize, recordCount);
+    if(self->isMultiProducer)
+    {
+        return putMultiProducer(self, records, recordCount);
+    }
+
+    // Aligned records are added one by one, once they are known to fit. As for
+    // multi-producer batches, the records packed from the start of the buffer
+    // shall fit in its first half to fit at every write position.
+    writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    if(1 != self->recordAlignment)
+    {
+        uint32_t nextIndex = 0;
+        uint32_t paddingSize = 0;
+
+        for(size_t i = 0; (i < recordCount) && (nextIndex <= (self->size / 2)); i++)
+        {
+            nextIndex = getRecordPlacement(self, nextIndex, QUEUE_ELEMENT_PREFIX16_SIZE, records[i].size, &paddingSize);
+        }
+        if(nextIndex > (self->size / 2))
+        {
+            countRejectedPut(self);
+            return false;
+        }
+
+        nextIndex = writeIndex;
+        for(size_t i = 0; (i < recordCount) && ((uint32_t) (nextIndex - writeIndex) <= self->size); i++)
+        {
+            nextIndex = getRecordPlacement(self, nextIndex, QUEUE_ELEMENT_PREFIX16_SIZE, records[i].size, &paddingSize);
+        }
+        totalSize = (uint32_t) (nextIndex - writeIndex);
+        if((totalSize > self->size) || (getFreeSpace(self, writeIndex, totalSize) < totalSize))
+        {
+            countRejectedPut(self);
+            return false;
+        }
+
+        for(size_t i = 0; i < recordCount; i++)
+        {
+            putAligned(self, &records[i], 1, records[i].size);
+        }
+        return true;
+    }
+
+    // Check once if there's enough space for all the records
+    if((totalSize > self->size) || (getFreeSpace(self, writeIndex, totalSize) < totalSize))
     {
+        countRejectedPut(self);
         return false;
     }
 
-    self->r_ptr = 0;
-    self->w_ptr = 0;
+    // Write the data
+    for(size_t i = 0; i < recordCount; i++)
+    {
+        writeIndex += writeRecordInBuffer(self, writeIndex, records[i].data, records[i].size);
+    }
+
+    // Publish all the elements at once to the consumer
+    atomic_store_explicit(&self->w_ptr, writeIndex, memory_order_release);
+    wakeConsumer(self);
+    countPut(self, writeIndex, recordCount, dataSize, largestSize);
     return true;
 }
 
-/******************************************************************************
- ************************* Local function definitions *************************
- *****************************************************************************/
-static streamBufferMetadata_t* getNextFreeStaticInstance(void)
+bool streamBuffer_get(streamBufferHandle_t self, uint8_t *data, uint16_t *size)
 {
-    size_t i = 0;
-    bool isInstanceFound = false;
-    streamBufferMetadata_t *ret = NULL;
+    size_t length = 0;
+    bool isSuccessful = false;
+
+    // Sanity checks
+    if(NULL == size)
+    {
+        return false;
+    }
+
+    // Larger records can only be retrieved with a size_t length
+    isSuccessful = streamBuffer_getBounded(self, data, UINT16_MAX, &length);
+    *size = isSuccessful ? (uint16_t) length : 0;
+    return isSuccessful;
+}
+
+bool streamBuffer_getBounded(streamBufferHandle_t self, uint8_t *data, size_t capacity, size_t *size)
+{
+    uint32_t readIndex = 0;
+    recordLocation_t location;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == data) || (NULL == size))
+    {
+        return false;
+    }
+
+    // Check if the queue is empty
+    discardExpiredRecords(self);
+    readIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+    if(!findNextRecord(self, readIndex, &location))
+    {
+        *size = 0;
+        return false;
+    }
 
-    while((i < STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT) && !isInstanceFound)
+    // The element stays in the queue if it's too big, a corrupted one is
+    // dropped so it doesn't block the following ones
+    if(!readRecord(self, &location, data, capacity, size))
     {
-        if(NULL == staticInstances[i].buffer)
+        if(*size <= capacity)
         {
-            isInstanceFound = true;
-            ret = &staticInstances[i];
+            self->isPeeked = false;
+            releaseRecords(self, readIndex, location.nextIndex);
         }
-        i++;
+        return false;
     }
-    return ret;
+
+    // Give the memory back to the producer
+    self->isPeeked = false;
+    releaseRecords(self, readIndex, location.nextIndex);
+    countGet(self, 1, *size);
+    return true;
 }
 
-static void writeDataInBuffer(streamBufferHandle_t self, const uint8_t *data, uint16_t size)
+bool streamBuffer_getBatch(streamBufferHandle_t self, uint8_t *data, size_t capacity, size_t *offsets, size_t maxRecordCount, size_t *recordCount)
 {
-    uint32_t over = 0;
-    uint32_t remainingBytesCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t readIndex = 0;
+    size_t dataSize = 0;
+    size_t recordSize = 0;
+    size_t count = 0;
+    recordLocation_t location;
 
-    // Check if the end address is reached
-    over = (self->w_ptr + size) & self->mask;
-    if((0 == over) || (over > self->w_ptr))
+    // Sanity checks
+    if((NULL == self) || (NULL == data) || (NULL == offsets) || (0 == maxRecordCount) || (NULL == recordCount))
     {
-        // The element may be written in one go
-        memcpy(&self->buffer[self->w_ptr], data, size);
-        self->w_ptr = over;
+        return false;
     }
-    else
+
+    discardExpiredRecords(self);
+    firstIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+    readIndex = firstIndex;
+
+    // Fixed size records are already an array: copy them at once
+    if(STREAM_BUFFER_FORMAT_FIXED == self->format)
+    {
+        count = MISC_UTILS_MIN(maxRecordCount, capacity / self->maxRecordSize);
+        count = MISC_UTILS_MIN(count, getUsedSpace(self, readIndex, count * self->maxRecordSize) / self->maxRecordSize);
+        dataSize = count * self->maxRecordSize;
+        readDataFromBuffer(self, readIndex, data, dataSize);
+        readIndex += dataSize;
+        for(size_t i = 0; i <= count; i++)
+        {
+            offsets[i] = i * self->maxRecordSize;
+        }
+    }
+
+    while((count < maxRecordCount) && (STREAM_BUFFER_FORMAT_FIXED != self->format) && findNextRecord(self, readIndex, &location))
+    {
+        // Stop at the first element which doesn't fit in the destination or
+        // is corrupted, the latter is dropped when it's at the head
+        if(!readRecord(self, &location, &data[dataSize], capacity - dataSize, &recordSize))
+        {
+            if((0 == count) && (recordSize <= capacity))
+            {
+                readIndex = location.nextIndex;
+            }
+            break;
+        }
+
+        offsets[count] = dataSize;
+        dataSize += recordSize;
+        readIndex = location.nextIndex;
+        count++;
+    }
+    offsets[count] = dataSize;
+    *recordCount = count;
+
+    // Give the memory back to the producer at once
+    if(readIndex != firstIndex)
+    {
+        self->isPeeked = false;
+        releaseRecords(self, firstIndex, readIndex);
+    }
+    if(0 == count)
     {
-        // The element shall be written in two chunk.
-        // The over variable contains the number of bytes in the second chunk
-        remainingBytesCount = size - over;
-        memcpy(&self->buffer[self->w_ptr], data, remainingBytesCount);
-        memcpy(&self->buffer[0], &data[remainingBytesCount], over);
-        self->w_ptr = over;
+        return false;
     }
+    countGet(self, count, dataSize);
+    return true;
 }
 
-static void readDataFromBuffer(streamBufferHandle_t self, uint8_t *data, uint16_t size)
+bool streamBuffer_peek(streamBufferHandle_t self, streamBufferRecord_t *record)
 {
-    uint32_t over = 0;
-    uint32_t remainingBytesCount = 0;
+    recordLocation_t location;
 
-    // Check if the end address is reached
-    over = (self->r_ptr + size) & self->mask;
-    if((0 == over) || (over > self->r_ptr))
+    // Sanity checks
+    if((NULL == self) || (NULL == record) || self->isCompressed)
     {
-        // The element may be read in one go
-        memcpy(data, &self->buffer[self->r_ptr], size);
-        self->r_ptr = over;
+        return false;
     }
-    else
+
+    // Check if the queue is empty
+    discardExpiredRecords(self);
+    if(!findNextRecord(self, atomic_load_explicit(&self->r_ptr, memory_order_relaxed), &location))
+    {
+        return false;
+    }
+
+    // Describe the element where it lies in the buffer
+    describeRecord(self, &location, record);
+
+    self->peekedNextIndex = location.nextIndex;
+    self->isPeeked = true;
+#if STREAM_BUFFER_ENABLE_STATS
+    self->peekedSize = location.length;
+#endif
+    return true;
+}
+
+bool streamBuffer_release(streamBufferHandle_t self)
+{
+    // Sanity checks
+    if((NULL == self) || !self->isPeeked)
+    {
+        return false;
+    }
+
+    // Give the memory back to the producer
+    self->isPeeked = false;
+    releaseRecords(self, atomic_load_explicit(&self->r_ptr, memory_order_relaxed), self->peekedNextIndex);
+#if STREAM_BUFFER_ENABLE_STATS
+    countGet(self, 1, self->peekedSize);
+#endif
+    return true;
+}
+
+bool streamBuffer_iterBegin(streamBufferHandle_t self, streamBufferIterator_t *iterator)
+{
+    uint64_t expiredCount = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == iterator) || self->isCompressed || (STREAM_BUFFER_FORMAT_RAW == self->format))
     {
-        // The element shall be read in two chunk.
-        // The over variable contains the number of bytes in the second chunk
-        remainingBytesCount = size - over;
-        memcpy(data, &self->buffer[self->r_ptr], remainingBytesCount);
-        memcpy(&data[remainingBytesCount], &self->buffer[0], over);
-        self->r_ptr = over;
+        return false;
+    }
+
+    // In multi-producer mode, the write index tells what has been claimed and
+    // the iteration also stops at the first record not committed yet. The
+    // expired records are passed over but left to the consumer functions.
+    iterator->index = skipExpiredRecords(self, atomic_load_explicit(&self->r_ptr, memory_order_relaxed), &expiredCount);
+    iterator->endIndex = atomic_load_explicit(&self->w_ptr, memory_order_acquire);
+    return true;
+}
+
+bool streamBuffer_iterNext(streamBufferHandle_t self, streamBufferIterator_t *iterator, streamBufferRecord_t *record)
+{
+    recordLocation_t location;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == iterator) || (NULL == record))
+    {
+        return false;
+    }
+
+    if((iterator->index == iterator->endIndex) || !findNextRecord(self, iterator->index, &location))
+    {
+        return false;
+    }
+
+    describeRecord(self, &location, record);
+    iterator->index = location.nextIndex;
+    return true;
+}
+
+bool streamBuffer_reserve(streamBufferHandle_t self, size_t maxSize, uint8_t **data)
+{
+    uint32_t writeIndex = 0;
+    uint32_t paddingSize = 0;
+    size_t prefixSize = 0;
+    size_t requiredSize = 0;
+    uint8_t padding[QUEUE_ELEMENT_PREFIX_MAX_SIZE] = { 0 };
+
+    // Sanity checks
+    if((NULL == self) || (NULL == data) || !isRecordSizeValid(self, maxSize) || self->isReserved || self->isMultiProducer ||
+        (STREAM_BUFFER_FORMAT_FIXED == self->format))
+    {
+        return false;
+    }
+
+    // The payload shall be contiguous: if it would cross the end of the buffer,
+    // pad the end of the buffer and start the record at the beginning instead
+    writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    prefixSize = getPrefixSize(self, maxSize);
+    requiredSize = (uint32_t) (getRecordPlacement(self, writeIndex, prefixSize, maxSize, &paddingSize) - writeIndex);
+
+    // Check if there's enough space in the queue
+    if(getFreeSpace(self, writeIndex, requiredSize) < requiredSize)
+    {
+        countRejectedPut(self);
+        return false;
+    }
+
+    // The padding is only visible to the consumer once the record is committed
+    if(0 != paddingSize)
+    {
+        encodePrefix(self, QUEUE_WRAP_PADDING_LENGTH, getPrefixSize(self, QUEUE_WRAP_PADDING_LENGTH), padding);
+        writeDataInBuffer(self, writeIndex, padding, getPrefixSize(self, QUEUE_WRAP_PADDING_LENGTH));
+    }
+
+    self->reservedIndex = writeIndex + paddingSize;
+    self->reservedSize = maxSize;
+    self->reservedPrefixSize = prefixSize;
+    self->isReserved = true;
+    *data = &getBuffer(self)[(self->reservedIndex + prefixSize) & self->mask];
+    return true;
+}
+
+bool streamBuffer_commit(streamBufferHandle_t self, size_t actualSize)
+{
+    uint8_t dataPrefix[QUEUE_ELEMENT_PREFIX_MAX_SIZE] = { 0 };
+    uint32_t writeIndex = 0;
+
+    // Sanity checks
+    if((NULL == self) || !self->isReserved || (actualSize > self->reservedSize))
+    {
+        return false;
+    }
+
+    // Committing 0 byte cancels the reservation
+    self->isReserved = false;
+    if(0 == actualSize)
+    {
+        return true;
+    }
+
+    // Serialize the prefix with the size reserved for maxSize and publish the
+    // record, padding included
+    encodePrefix(self, actualSize, self->reservedPrefixSize, dataPrefix);
+    writeDataInBuffer(self, self->reservedIndex, dataPrefix, self->reservedPrefixSize);
+    writeIndex = alignRecordIndex(self, self->reservedIndex + self->reservedPrefixSize + actualSize);
+    atomic_store_explicit(&self->w_ptr, writeIndex, memory_order_release);
+    wakeConsumer(self);
+    countPut(self, writeIndex, 1, actualSize, actualSize);
+    return true;
+}
+
+bool streamBuffer_getMaxReserveSize(streamBufferHandle_t self, size_t *maxSize)
+{
+    size_t halfSize = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == maxSize) || self->isMultiProducer || (STREAM_BUFFER_FORMAT_FIXED == self->format))
+    {
+        return false;
+    }
+
+    // A reserved area crossing the end of the buffer starts at its beginning
+    // after a padding, so it always fits only within half of the buffer
+    halfSize = self->size / 2;
+    *maxSize = MISC_UTILS_MIN(self->maxRecordSize, getSizeAfterPrefix(halfSize, getPrefixSize(self, halfSize)));
+    return true;
+}
+
+bool streamBuffer_space(streamBufferHandle_t self, size_t *byteCount)
+{
+    uint32_t readIndex = 0;
+    uint32_t writeIndex = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == byteCount))
+    {
+        return false;
+    }
+
+    readIndex = atomic_load_explicit(&self->r_ptr, memory_order_acquire);
+    writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_acquire);
+    *byteCount = (uint32_t) (writeIndex - readIndex);
+    return true;
+}
+
+bool streamBuffer_write(streamBufferHandle_t self, const uint8_t *data, size_t size, size_t *writtenSize)
+{
+    uint32_t writeIndex = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == data) || (NULL == writtenSize) || (STREAM_BUFFER_FORMAT_RAW != self->format))
+    {
+        return false;
+    }
+
+    // Write as many bytes as fit
+    growOnDemand(self, size, 1);
+    writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    *writtenSize = MISC_UTILS_MIN(size, getFreeSpace(self, writeIndex, size));
+    if(0 == *writtenSize)
+    {
+        countRejectedPut(self);
+        return false;
+    }
+
+    writeDataInBuffer(self, writeIndex, data, *writtenSize);
+    atomic_store_explicit(&self->w_ptr, writeIndex + *writtenSize, memory_order_release);
+    wakeConsumer(self);
+    countPut(self, writeIndex + *writtenSize, 0, *writtenSize, 0);
+    return true;
+}
+
+bool streamBuffer_read(streamBufferHandle_t self, uint8_t *data, size_t capacity, size_t *readSize)
+{
+    uint32_t readIndex = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == data) || (NULL == readSize) || (STREAM_BUFFER_FORMAT_RAW != self->format))
+    {
+        return false;
+    }
+
+    // Read as many bytes as available
+    readIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+    *readSize = MISC_UTILS_MIN(capacity, getUsedSpace(self, readIndex, capacity));
+    if(0 == *readSize)
+    {
+        return false;
+    }
+
+    readDataFromBuffer(self, readIndex, data, *readSize);
+    atomic_store_explicit(&self->r_ptr, readIndex + *readSize, memory_order_release);
+    countGet(self, 0, *readSize);
+    return true;
+}
+
+bool streamBuffer_peekBytes(streamBufferHandle_t self, size_t offset, streamBufferRecord_t *bytes)
+{
+    uint32_t readIndex = 0;
+    size_t usedSize = 0;
+    recordLocation_t location;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == bytes) || !isByteAccessAvailable(self))
+    {
+        return false;
+    }
+
+    // Everything published so far, the producer line is only loaded once
+    readIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+    usedSize = getUsedSpace(self, readIndex, self->size);
+    if(usedSize <= offset)
+    {
+        return false;
+    }
+
+    location.dataIndex = readIndex + (uint32_t) offset;
+    location.length = usedSize - offset;
+    describeRecord(self, &location, bytes);
+
+    // The filler of a wrap padding holds stale bytes. It's left out of the
+    // spans but still counted in the size to release.
+    if(0 != bytes->spans[1].size)
+    {
+        skipWrapPadding(self, location.dataIndex, bytes);
+    }
+    return true;
+}
+
+bool streamBuffer_releaseBytes(streamBufferHandle_t self, size_t size)
+{
+    uint32_t readIndex = 0;
+
+    // Sanity checks
+    if((NULL == self) || !isByteAccessAvailable(self))
+    {
+        return false;
+    }
+
+    readIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+    if(getUsedSpace(self, readIndex, size) < size)
+    {
+        return false;
+    }
+
+    self->isPeeked = false;
+    releaseRecords(self, readIndex, readIndex + (uint32_t) size);
+    countGet(self, 0, size);
+    return true;
+}
+
+bool streamBuffer_setWakeup(streamBufferHandle_t self, streamBufferWakeup_t wakeup, void *context)
+{
+    // Sanity checks
+    if((NULL == self) || self->isShared)
+    {
+        return false;
+    }
+
+    // The context is published with the function, which is removed first
+    atomic_store_explicit(&self->needWakeup, false, memory_order_relaxed);
+    atomic_store_explicit(&self->wakeup, NULL, memory_order_relaxed);
+    if(NULL != wakeup)
+    {
+        self->wakeupContext = context;
+        atomic_store_explicit(&self->wakeup, wakeup, memory_order_release);
+    }
+    return true;
+}
+
+bool streamBuffer_prepareWait(streamBufferHandle_t self)
+{
+    uint32_t readIndex = 0;
+    recordLocation_t location;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == atomic_load_explicit(&self->wakeup, memory_order_relaxed)))
+    {
+        return false;
+    }
+
+    // Raise the flag before checking for records. Paired with the fence of
+    // wakeConsumer, either the producer sees the flag or the consumer sees the
+    // record, so a record is never left behind a sleeping consumer. The
+    // release makes what the consumer did before visible to the wakeup function.
+    atomic_store_explicit(&self->needWakeup, true, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    readIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+    if(((STREAM_BUFFER_FORMAT_RAW == self->format) && (0 != getUsedSpace(self, readIndex, 1))) ||
+        findNextRecord(self, readIndex, &location))
+    {
+        atomic_store_explicit(&self->needWakeup, false, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool streamBuffer_getStats(streamBufferHandle_t self, streamBufferStats_t *stats)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == stats))
+    {
+        return false;
+    }
+
+#if STREAM_BUFFER_ENABLE_STATS
+    // Every counter is read on its own, the snapshot isn't consistent as a
+    // whole while the instance is in use
+    stats->putRecordCount = atomic_load_explicit(&self->putRecordCount, memory_order_relaxed);
+    stats->putByteCount = atomic_load_explicit(&self->putByteCount, memory_order_relaxed);
+    stats->rejectedPutCount = atomic_load_explicit(&self->rejectedPutCount, memory_order_relaxed);
+    stats->getRecordCount = atomic_load_explicit(&self->getRecordCount, memory_order_relaxed);
+    stats->getByteCount = atomic_load_explicit(&self->getByteCount, memory_order_relaxed);
+    stats->maxUsedSize = atomic_load_explicit(&self->maxUsedSize, memory_order_relaxed);
+    stats->largestRecordSize = atomic_load_explicit(&self->largestRecordSize, memory_order_relaxed);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool streamBuffer_getExpiredCount(streamBufferHandle_t self, uint64_t *count)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == count))
+    {
+        return false;
+    }
+
+    *count = atomic_load_explicit(&self->expiredRecordCount, memory_order_relaxed);
+    return true;
+}
+
+bool streamBuffer_empty(streamBufferHandle_t self)
+{
+    uint32_t readIndex = 0;
+    uint32_t nextIndex = 0;
+    recordLocation_t location;
+
+    // Sanity checks
+    if((NULL == self))
+    {
+        return false;
+    }
+
+    self->isPeeked = false;
+    if(self->isMultiProducer)
+    {
+        // Drop the records committed so far
+        readIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+        nextIndex = readIndex;
+        while(findNextRecord(self, nextIndex, &location))
+        {
+            nextIndex = location.nextIndex;
+        }
+        releaseRecords(self, readIndex, nextIndex);
+        return true;
+    }
+
+    // Drop everything that has been published so far
+    self->cachedWriteIndex = atomic_load_explicit(&self->w_ptr, memory_order_acquire);
+    atomic_store_explicit(&self->r_ptr, self->cachedWriteIndex, memory_order_release);
+    return true;
+}
+
+/******************************************************************************
+ ************************* Local function definitions *************************
+ *****************************************************************************/
+static inline uint8_t* getBuffer(streamBufferHandle_t self)
+{
+    return (uint8_t*) ((uintptr_t) self + self->bufferOffset);
+}
+
+static streamBufferMetadata_t* getNextFreeStaticInstance(void)
+{
+    streamBufferMetadata_t *ret = NULL;
+
+    // Reuse the last freed instance first, then the instances never used so far
+    if(NULL != freeInstanceList)
+    {
+        ret = freeInstanceList;
+        freeInstanceList = ret->nextFreeInstance;
+    }
+    else if(neverUsedInstanceIndex < STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT)
+    {
+        ret = &staticInstances[neverUsedInstanceIndex];
+        neverUsedInstanceIndex++;
+    }
+    return ret;
+}
+
+static void releaseStaticInstance(streamBufferMetadata_t *instance)
+{
+    instance->nextFreeInstance = freeInstanceList;
+    freeInstanceList = instance;
+}
+
+static void initInstance(streamBufferMetadata_t *instance, uint8_t *const buffer, size_t bufferSize, bool isPooled)
+{
+    atomic_init(&instance->w_ptr, 0);
+    atomic_init(&instance->r_ptr, 0);
+    instance->cachedReadIndex = 0;
+    instance->cachedWriteIndex = 0;
+    instance->reservedIndex = 0;
+    instance->reservedSize = 0;
+    instance->reservedPrefixSize = 0;
+    instance->isReserved = false;
+    instance->peekedNextIndex = 0;
+    instance->isPeeked = false;
+    instance->mask = bufferSize - 1;
+    instance->size = bufferSize;
+    instance->format = STREAM_BUFFER_FORMAT_PREFIX16;
+    instance->recordAlignment = 1;
+    instance->isMultiProducer = false;
+    instance->isCompressed = false;
+    atomic_init(&instance->wakeup, NULL);
+    instance->wakeupContext = NULL;
+    instance->getTime = NULL;
+    instance->timeToLive = 0;
+    atomic_init(&instance->expiredRecordCount, 0);
+    atomic_init(&instance->needWakeup, false);
+    instance->maxRecordSize = MISC_UTILS_MIN((size_t) QUEUE_ELEMENT_PREFIX16_MAX_LENGTH, getSizeAfterPrefix(bufferSize, QUEUE_ELEMENT_PREFIX16_SIZE));
+    instance->bufferOffset = (uintptr_t) buffer - (uintptr_t) instance;
+    instance->isInitialized = true;
+    instance->isShared = false;
+    instance->isPooled = isPooled;
+    instance->isDynamic = false;
+    instance->maxDynamicSize = 0;
+    instance->nextFreeInstance = NULL;
+#if STREAM_BUFFER_ENABLE_STATS
+    atomic_init(&instance->putRecordCount, 0);
+    atomic_init(&instance->putByteCount, 0);
+    atomic_init(&instance->rejectedPutCount, 0);
+    atomic_init(&instance->maxUsedSize, 0);
+    atomic_init(&instance->largestRecordSize, 0);
+    instance->peekedSize = 0;
+    atomic_init(&instance->getRecordCount, 0);
+    atomic_init(&instance->getByteCount, 0);
+#endif
+}
+
+static bool isSharingAvailable(void)
+{
+#if STREAM_BUFFER_ENABLE_STATS
+    atomic_uint_least64_t counter;
+
+    // The 64 bits counters are updated from every process, a lock would only
+    // protect them within one process. The expired record count stays at 0
+    // since a shared instance can't have a time to live.
+    atomic_init(&counter, 0);
+    return atomic_is_lock_free(&counter);
+#else
+    return true;
+#endif
+}
+
+static bool isBufferValid(const uint8_t *buffer, size_t bufferSize)
+{
+    return (NULL != buffer) && isBufferSizeValid(bufferSize);
+}
+
+static bool isBufferSizeValid(size_t bufferSize)
+{
+    // Above 2^31 bytes, the free-running indexes can't tell a full buffer
+    // from an empty one
+    return miscUtils_isPowerOf2(bufferSize) && (bufferSize <= (UINT32_MAX / 2 + 1));
+}
+
+static uint8_t* allocateBuffer(size_t bufferSize)
+{
+    // Aligned enough for any record alignment, and cleared as the
+    // multi-producer mode expects from the free memory
+    uint8_t *buffer = aligned_alloc(MAX_RECORD_ALIGNMENT, MISC_UTILS_MAX(bufferSize, (size_t) MAX_RECORD_ALIGNMENT));
+
+    if(NULL != buffer)
+    {
+        memset(buffer, 0, bufferSize);
+    }
+    return buffer;
+}
+
+static bool resizeBuffer(streamBufferHandle_t self, size_t newSize)
+{
+    uint32_t readIndex = atomic_load_explicit(&self->r_ptr, memory_order_acquire);
+    uint32_t usedSize = (uint32_t) (atomic_load_explicit(&self->w_ptr, memory_order_acquire) - readIndex);
+    uint32_t readOffset = readIndex & self->mask;
+    uint32_t firstChunkSize = MISC_UTILS_MIN(usedSize, self->size - readOffset);
+    uint32_t alignment = self->isMultiProducer ? MP_RECORD_ALIGNMENT : self->recordAlignment;
+    uint32_t newReadIndex = 0;
+    uint8_t *oldBuffer = getBuffer(self);
+    uint8_t *newBuffer = NULL;
+
+    // The live bytes crossing the end of the buffer keep crossing the end of
+    // the new buffer at the same place, so the split records and the wrap
+    // padding stay valid. Otherwise they move to the start of the new buffer,
+    // at the same offset modulo the record alignment.
+    if(firstChunkSize < usedSize)
+    {
+        newReadIndex = newSize - firstChunkSize;
+    }
+    else
+    {
+        newReadIndex = readIndex & (alignment - 1);
+    }
+    if((usedSize > newSize) || ((newReadIndex + firstChunkSize) > newSize))
+    {
+        return false;
+    }
+
+    newBuffer = allocateBuffer(newSize);
+    if(NULL == newBuffer)
+    {
+        return false;
+    }
+    memcpy(&newBuffer[newReadIndex], &oldBuffer[readOffset], firstChunkSize);
+    memcpy(newBuffer, oldBuffer, usedSize - firstChunkSize);
+    free(oldBuffer);
+
+    self->bufferOffset = (uintptr_t) newBuffer - (uintptr_t) self;
+    self->size = newSize;
+    self->mask = newSize - 1;
+    self->maxRecordSize = getMaxRecordSize(self, newSize);
+    self->cachedReadIndex = newReadIndex;
+    self->cachedWriteIndex = newReadIndex + usedSize;
+    atomic_store_explicit(&self->w_ptr, self->cachedWriteIndex, memory_order_relaxed);
+    atomic_store_explicit(&self->r_ptr, self->cachedReadIndex, memory_order_release);
+    return true;
+}
+
+static void growOnDemand(streamBufferHandle_t self, size_t requiredSize, size_t recordCount)
+{
+    uint32_t writeIndex = 0;
+    size_t usedSize = 0;
+    size_t newSize = 0;
+
+    // Several producers can't move the buffer under each other, nor can it be
+    // moved under a peeked or reserved record
+    if((0 == self->maxDynamicSize) || self->isMultiProducer || self->isPeeked || self->isReserved)
+    {
+        return;
+    }
+
+    // Aligned records may need up to their own size of padding at the end of
+    // the buffer, and the alignment slack after each of them
+    if(1 != self->recordAlignment)
+    {
+        requiredSize = 2 * (requiredSize + recordCount * self->recordAlignment);
+    }
+
+    writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    usedSize = self->size - getFreeSpace(self, writeIndex, requiredSize);
+    newSize = self->size;
+    while(((newSize - usedSize) < requiredSize) && (newSize < self->maxDynamicSize))
+    {
+        newSize *= 2;
+    }
+
+    // The current buffer is kept if the allocation fails
+    if(newSize != self->size)
+    {
+        resizeBuffer(self, newSize);
+    }
+}
+
+static size_t getMaxRecordSize(streamBufferHandle_t self, size_t bufferSize)
+{
+    // Multi-producer and aligned records are contiguous: one that doesn't fit
+    // before the end of the buffer is preceded by a padding up to its own size.
+    // Half of the buffer is the largest record placeable at any write index.
+    if(self->isMultiProducer)
+    {
+        return MISC_UTILS_MIN((size_t) QUEUE_ELEMENT_PREFIX16_MAX_LENGTH, (bufferSize / 2) - MP_HEADER_SIZE);
+    }
+    if(1 != self->recordAlignment)
+    {
+        return MISC_UTILS_MIN((size_t) QUEUE_ELEMENT_PREFIX16_MAX_LENGTH, (bufferSize / 2) - self->recordAlignment);
+    }
+    if(self->isCompressed)
+    {
+        return MISC_UTILS_MIN((size_t) COMPRESSED_MAX_LENGTH, getSizeAfterPrefix(bufferSize, QUEUE_ELEMENT_PREFIX16_SIZE));
+    }
+
+    switch(self->format)
+    {
+        case STREAM_BUFFER_FORMAT_VARINT:
+            return getSizeAfterPrefix(bufferSize, getPrefixSize(self, bufferSize));
+
+        case STREAM_BUFFER_FORMAT_RAW:
+            // No record at all, only streamBuffer_write and streamBuffer_read
+            return 0;
+
+        case STREAM_BUFFER_FORMAT_FIXED:
+            // The record size doesn't depend on the buffer size
+            return self->maxRecordSize;
+
+        default:
+            return MISC_UTILS_MIN((size_t) QUEUE_ELEMENT_PREFIX16_MAX_LENGTH, getSizeAfterPrefix(bufferSize, getPrefixSize(self, bufferSize)));
+    }
+}
+
+static size_t getSizeAfterPrefix(size_t bufferSize, size_t prefixSize)
+{
+    // A buffer too small for the prefix, e.g. a few bytes used with
+    // streamBuffer_write and streamBuffer_read, can't hold any record
+    return (bufferSize > prefixSize) ? (bufferSize - prefixSize) : 0;
+}
+
+static bool isRecordSizeValid(streamBufferHandle_t self, size_t size)
+{
+    if(STREAM_BUFFER_FORMAT_FIXED == self->format)
+    {
+        return size == self->maxRecordSize;
+    }
+    return (0 != size) && (size <= self->maxRecordSize);
+}
+
+static size_t getFreeSpace(streamBufferHandle_t self, uint32_t writeIndex, size_t requestedSize)
+{
+    size_t freeSpace = self->size - (uint32_t) (writeIndex - self->cachedReadIndex);
+
+    // Only touch the consumer cache line when the cached index isn't enough
+    if(freeSpace < requestedSize)
+    {
+        self->cachedReadIndex = atomic_load_explicit(&self->r_ptr, memory_order_acquire);
+        freeSpace = self->size - (uint32_t) (writeIndex - self->cachedReadIndex);
+    }
+    return freeSpace;
+}
+
+static size_t getUsedSpace(streamBufferHandle_t self, uint32_t readIndex, size_t requestedSize)
+{
+    size_t usedSpace = (uint32_t) (self->cachedWriteIndex - readIndex);
+
+    // Only touch the producer cache line when the cached index isn't enough
+    if(usedSpace < requestedSize)
+    {
+        self->cachedWriteIndex = atomic_load_explicit(&self->w_ptr, memory_order_acquire);
+        usedSpace = (uint32_t) (self->cachedWriteIndex - readIndex);
+    }
+    return usedSpace;
+}
+
+static size_t getPrefixSize(streamBufferHandle_t self, size_t length)
+{
+    size_t prefixSize = 1;
+
+    if(STREAM_BUFFER_FORMAT_PREFIX16 == self->format)
+    {
+        return QUEUE_ELEMENT_PREFIX16_SIZE + getTimestampSize(self, length);
+    }
+    if(STREAM_BUFFER_FORMAT_FIXED == self->format)
+    {
+        return 0;
+    }
+
+    // One byte for each started group of 7 bits
+    while(length > VARINT_PAYLOAD_MASK)
+    {
+        length >>= VARINT_PAYLOAD_BIT_COUNT;
+        prefixSize++;
+    }
+    return prefixSize + getTimestampSize(self, length);
+}
+
+static size_t getTimestampSize(streamBufferHandle_t self, size_t length)
+{
+    // The wrap paddings only have a length
+    return ((0 != self->timeToLive) && (QUEUE_WRAP_PADDING_LENGTH != length)) ? QUEUE_ELEMENT_TIMESTAMP_SIZE : 0;
+}
+
+static void encodePrefix(streamBufferHandle_t self, size_t length, size_t prefixSize, uint8_t *bytes)
+{
+    uint32_t timestamp = 0;
+
+    // The timestamp is taken when the record is published and follows the length
+    if(0 != getTimestampSize(self, length))
+    {
+        prefixSize -= QUEUE_ELEMENT_TIMESTAMP_SIZE;
+        timestamp = self->getTime();
+        memcpy(&bytes[prefixSize], &timestamp, QUEUE_ELEMENT_TIMESTAMP_SIZE);
+    }
+
+    if(STREAM_BUFFER_FORMAT_PREFIX16 == self->format)
+    {
+        miscUtils_uint16ToBigEndianBytes((uint16_t) length, bytes);
+        return;
+    }
+    if(STREAM_BUFFER_FORMAT_FIXED == self->format)
+    {
+        return;
+    }
+
+    // LEB128, least significant group first. If prefixSize is larger than
+    // needed, the value is padded with redundant continuation bytes.
+    for(size_t i = 0; i < prefixSize; i++)
+    {
+        bytes[i] = (uint8_t) (length & VARINT_PAYLOAD_MASK);
+        if(i < (prefixSize - 1))
+        {
+            bytes[i] |= VARINT_CONTINUATION_FLAG;
+        }
+        length >>= VARINT_PAYLOAD_BIT_COUNT;
+    }
+}
+
+static size_t decodePrefix(streamBufferHandle_t self, uint32_t index, size_t *length)
+{
+    uint8_t prefix[QUEUE_ELEMENT_PREFIX16_SIZE] = { 0 };
+    uint16_t length16 = 0;
+    uint8_t byte = 0;
+    size_t prefixSize = 0;
+
+    if(STREAM_BUFFER_FORMAT_PREFIX16 == self->format)
+    {
+        readDataFromBuffer(self, index, prefix, QUEUE_ELEMENT_PREFIX16_SIZE);
+        miscUtils_bigEndianBytesToUint16(prefix, &length16);
+        *length = length16;
+        return QUEUE_ELEMENT_PREFIX16_SIZE + getTimestampSize(self, *length);
+    }
+    if(STREAM_BUFFER_FORMAT_FIXED == self->format)
+    {
+        *length = self->maxRecordSize;
+        return 0;
+    }
+
+    *length = 0;
+    do
+    {
+        byte = getBuffer(self)[(index + prefixSize) & self->mask];
+        *length |= (size_t) (byte & VARINT_PAYLOAD_MASK) << (VARINT_PAYLOAD_BIT_COUNT * prefixSize);
+        prefixSize++;
+    } while((0 != (byte & VARINT_CONTINUATION_FLAG)) && (prefixSize < QUEUE_ELEMENT_VARINT_MAX_SIZE));
+    return prefixSize + getTimestampSize(self, *length);
+}
+
+static size_t readRecordHeader(streamBufferHandle_t self, uint32_t *readIndex, size_t *length)
+{
+    size_t prefixSize = decodePrefix(self, *readIndex, length);
+
+    // A wrap padding is always published together with the record following
+    // it, so that record is already available
+    if(QUEUE_WRAP_PADDING_LENGTH == *length)
+    {
+        *readIndex = alignRecordIndex(self, *readIndex + self->size - (*readIndex & self->mask));
+        prefixSize = decodePrefix(self, *readIndex, length);
+    }
+    return prefixSize;
+}
+
+static bool findNextRecord(streamBufferHandle_t self, uint32_t readIndex, recordLocation_t *location)
+{
+    uint32_t header = 0;
+    size_t prefixSize = 0;
+
+    if(!self->isMultiProducer)
+    {
+        if((STREAM_BUFFER_FORMAT_RAW == self->format) || (0 == getUsedSpace(self, readIndex, 1)))
+        {
+            return false;
+        }
+
+        prefixSize = readRecordHeader(self, &readIndex, &location->length);
+        location->isCompressed = self->isCompressed && (0 != (location->length & COMPRESSED_FLAG));
+        if(location->isCompressed)
+        {
+            location->length &= ~(size_t) COMPRESSED_FLAG;
+        }
+        location->dataIndex = readIndex + prefixSize;
+        location->nextIndex = alignRecordIndex(self, location->dataIndex + location->length);
+        return true;
+    }
+
+    // Skip the padding at the end of the buffer
+    header = atomic_load_explicit(getMultiProducerHeader(self, readIndex), memory_order_acquire);
+    if(0 != (header & MP_HEADER_PADDING_FLAG))
+    {
+        readIndex += MP_HEADER_SIZE + (header >> MP_HEADER_LENGTH_SHIFT);
+        header = atomic_load_explicit(getMultiProducerHeader(self, readIndex), memory_order_acquire);
+    }
+
+    // Stop at the first record which isn't completely written
+    if(0 == (header & MP_HEADER_COMMITTED_FLAG))
+    {
+        return false;
+    }
+
+    location->length = header >> MP_HEADER_LENGTH_SHIFT;
+    location->isCompressed = false;
+    location->dataIndex = readIndex + MP_HEADER_SIZE;
+    location->nextIndex = readIndex + getMultiProducerRecordSize(location->length);
+    return true;
+}
+
+static bool readRecord(streamBufferHandle_t self, const recordLocation_t *location, uint8_t *data, size_t capacity, size_t *size)
+{
+    const uint8_t *record = &getBuffer(self)[location->dataIndex & self->mask];
+    uint16_t length = 0;
+
+    if(!location->isCompressed)
+    {
+        *size = location->length;
+        if(location->length > capacity)
+        {
+            return false;
+        }
+        readDataFromBuffer(self, location->dataIndex, data, location->length);
+        return true;
+    }
+
+    // A compressed record is never split and holds at least its header and a
+    // byte of data, a corrupted one is reported with a null size
+    if((location->length <= COMPRESSED_HEADER_SIZE) ||
+        (location->length > (self->size - (location->dataIndex & self->mask))))
+    {
+        *size = 0;
+        return false;
+    }
+    miscUtils_bigEndianBytesToUint16(record, &length);
+    *size = length;
+    if(length > capacity)
+    {
+        return false;
+    }
+
+    // So is a record which doesn't decompress to its stored length
+    if(!lzUtils_decompress(&record[COMPRESSED_HEADER_SIZE], location->length - COMPRESSED_HEADER_SIZE, data, length, size) ||
+        (*size != length))
+    {
+        *size = 0;
+        return false;
+    }
+    return true;
+}
+
+static void describeRecord(streamBufferHandle_t self, const recordLocation_t *location, streamBufferRecord_t *record)
+{
+    uint32_t offset = location->dataIndex & self->mask;
+
+    record->size = location->length;
+    record->spans[0].data = &getBuffer(self)[offset];
+    record->spans[0].size = MISC_UTILS_MIN(location->length, (size_t) (self->size - offset));
+    record->spans[1].data = getBuffer(self);
+    record->spans[1].size = location->length - record->spans[0].size;
+}
+
+static bool isByteAccessAvailable(streamBufferHandle_t self)
+{
+    // The bytes between the indexes shall be the records back to back, as the
+    // producer published them
+    return !self->isMultiProducer && (1 == self->recordAlignment) && !self->isCompressed && (0 == self->timeToLive);
+}
+
+static void skipWrapPadding(streamBufferHandle_t self, uint32_t index, streamBufferRecord_t *bytes)
+{
+    uint32_t wrapIndex = index + self->size - (index & self->mask);
+    size_t prefixSize = 0;
+    size_t length = 0;
+
+    // Only streamBuffer_reserve pads the end of the buffer, and index shall be
+    // at a record boundary since the bytes are handed over up to the write index
+    if((STREAM_BUFFER_FORMAT_PREFIX16 != self->format) && (STREAM_BUFFER_FORMAT_VARINT != self->format))
+    {
+        return;
+    }
+
+    // A padding reaches the end of the buffer, so only the records before the
+    // wrap are walked
+    while((int32_t) (wrapIndex - index) > 0)
+    {
+        prefixSize = decodePrefix(self, index, &length);
+        if(QUEUE_WRAP_PADDING_LENGTH == length)
+        {
+            // The first span stops at the padding, the second one is left as is
+            bytes->spans[0].size -= wrapIndex - index;
+            return;
+        }
+        index += (uint32_t) (prefixSize + length);
+    }
+}
+
+static bool putCompressed(streamBufferHandle_t self, const uint8_t *data, size_t size)
+{
+    uint32_t writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    uint32_t tailSize = self->size - (writeIndex & self->mask);
+    uint32_t paddingSize = 0;
+    uint8_t prefix[QUEUE_ELEMENT_PREFIX16_SIZE] = { 0 };
+    uint8_t *record = NULL;
+    size_t freeSpace = getFreeSpace(self, writeIndex, QUEUE_ELEMENT_PREFIX16_SIZE + size);
+    size_t capacity = 0;
+    size_t compressedSize = 0;
+
+    // Compress straight into the free space. The LZ77 stream shall be
+    // contiguous, so the end of the buffer is padded as streamBuffer_reserve
+    // does when there's more room at the start of the buffer.
+    if(tailSize <= QUEUE_ELEMENT_PREFIX16_SIZE)
+    {
+        capacity = freeSpace;
+    }
+    else
+    {
+        capacity = MISC_UTILS_MIN(freeSpace, (size_t) tailSize);
+        if((freeSpace > tailSize) && ((freeSpace - tailSize) > capacity))
+        {
+            paddingSize = tailSize;
+            capacity = freeSpace - tailSize;
+        }
+    }
+    if((size <= COMPRESSED_HEADER_SIZE) || (capacity <= (QUEUE_ELEMENT_PREFIX16_SIZE + COMPRESSED_HEADER_SIZE)))
+    {
+        return false;
+    }
+    capacity = MISC_UTILS_MIN(capacity - QUEUE_ELEMENT_PREFIX16_SIZE - COMPRESSED_HEADER_SIZE, size - COMPRESSED_HEADER_SIZE - 1);
+
+    // Only keep the compressed record if it's smaller
+    record = &getBuffer(self)[(writeIndex + paddingSize + QUEUE_ELEMENT_PREFIX16_SIZE) & self->mask];
+    if(!lzUtils_compress(data, size, &record[COMPRESSED_HEADER_SIZE], capacity, &compressedSize))
+    {
+        return false;
+    }
+    miscUtils_uint16ToBigEndianBytes((uint16_t) size, record);
+
+    if(0 != paddingSize)
+    {
+        encodePrefix(self, QUEUE_WRAP_PADDING_LENGTH, QUEUE_ELEMENT_PREFIX16_SIZE, prefix);
+        writeDataInBuffer(self, writeIndex, prefix, QUEUE_ELEMENT_PREFIX16_SIZE);
+    }
+    writeIndex += paddingSize;
+    encodePrefix(self, (COMPRESSED_HEADER_SIZE + compressedSize) | COMPRESSED_FLAG, QUEUE_ELEMENT_PREFIX16_SIZE, prefix);
+    writeDataInBuffer(self, writeIndex, prefix, QUEUE_ELEMENT_PREFIX16_SIZE);
+
+    // Publish the element to the consumer
+    writeIndex += QUEUE_ELEMENT_PREFIX16_SIZE + COMPRESSED_HEADER_SIZE + compressedSize;
+    atomic_store_explicit(&self->w_ptr, writeIndex, memory_order_release);
+    wakeConsumer(self);
+    countPut(self, writeIndex, 1, size, size);
+    return true;
+}
+
+static void releaseRecords(streamBufferHandle_t self, uint32_t readIndex, uint32_t nextIndex)
+{
+    // The producers rely on the free memory being cleared in multi-producer mode
+    if(self->isMultiProducer)
+    {
+        clearDataInBuffer(self, readIndex, (uint32_t) (nextIndex - readIndex));
+    }
+    atomic_store_explicit(&self->r_ptr, nextIndex, memory_order_release);
+}
+
+static bool putMultiProducer(streamBufferHandle_t self, const streamBufferSpan_t *records, size_t recordCount)
+{
+    uint32_t writeIndex = 0;
+    size_t totalSize = 0;
+    size_t dataSize = 0;
+    size_t largestSize = 0;
+
+    for(size_t i = 0; i < recordCount; i++)
+    {
+        totalSize += getMultiProducerRecordSize(records[i].size);
+    }
+    if(!claimMultiProducerSpace(self, totalSize, &writeIndex))
+    {
+        return false;
+    }
+
+    // Write the records, then hand each of them over to the consumer
+    for(size_t i = 0; i < recordCount; i++)
+    {
+        memcpy(&getBuffer(self)[(writeIndex + MP_HEADER_SIZE) & self->mask], records[i].data, records[i].size);
+        atomic_store_explicit(getMultiProducerHeader(self, writeIndex),
+            ((uint32_t) records[i].size << MP_HEADER_LENGTH_SHIFT) | MP_HEADER_COMMITTED_FLAG, memory_order_release);
+        writeIndex += getMultiProducerRecordSize(records[i].size);
+        dataSize += records[i].size;
+        largestSize = MISC_UTILS_MAX(largestSize, records[i].size);
+    }
+    wakeConsumer(self);
+    countPut(self, writeIndex, recordCount, dataSize, largestSize);
+    return true;
+}
+
+static bool putvMultiProducer(streamBufferHandle_t self, const streamBufferSpan_t *fragments, size_t fragmentCount, size_t size)
+{
+    uint32_t writeIndex = 0;
+    uint32_t dataIndex = 0;
+
+    if(!claimMultiProducerSpace(self, getMultiProducerRecordSize(size), &writeIndex))
+    {
+        return false;
+    }
+
+    // The record is contiguous, the fragments are copied one after the other
+    dataIndex = writeIndex + MP_HEADER_SIZE;
+    for(size_t i = 0; i < fragmentCount; i++)
+    {
+        memcpy(&getBuffer(self)[dataIndex & self->mask], fragments[i].data, fragments[i].size);
+        dataIndex += fragments[i].size;
+    }
+    atomic_store_explicit(getMultiProducerHeader(self, writeIndex),
+        ((uint32_t) size << MP_HEADER_LENGTH_SHIFT) | MP_HEADER_COMMITTED_FLAG, memory_order_release);
+    wakeConsumer(self);
+    countPut(self, writeIndex + getMultiProducerRecordSize(size), 1, size, size);
+    return true;
+}
+
+static bool claimMultiProducerSpace(streamBufferHandle_t self, size_t totalSize, uint32_t *writeIndex)
+{
+    uint32_t readIndex = 0;
+    uint32_t offset = 0;
+    uint32_t paddingSize = 0;
+
+    // Like a single record, a batch larger than half of the buffer doesn't fit
+    // at every write position and could be rejected forever
+    if(totalSize > (self->size / 2))
+    {
+        countRejectedPut(self);
+        return false;
+    }
+
+    // Claim the space. The records are contiguous, so the end of the buffer is
+    // skipped when they don't fit before it.
+    *writeIndex = atomic_load_explicit(&self->w_ptr, memory_order_relaxed);
+    do
+    {
+        offset = *writeIndex & self->mask;
+        paddingSize = ((self->size - offset) < totalSize) ? (self->size - offset) : 0;
+        readIndex = atomic_load_explicit(&self->r_ptr, memory_order_acquire);
+        if((self->size - (uint32_t) (*writeIndex - readIndex)) < (paddingSize + totalSize))
+        {
+            countRejectedPut(self);
+            return false;
+        }
+    } while(!atomic_compare_exchange_weak_explicit(&self->w_ptr, writeIndex, *writeIndex + paddingSize + totalSize,
+        memory_order_relaxed, memory_order_relaxed));
+
+    if(0 != paddingSize)
+    {
+        atomic_store_explicit(getMultiProducerHeader(self, *writeIndex),
+            ((paddingSize - MP_HEADER_SIZE) << MP_HEADER_LENGTH_SHIFT) | MP_HEADER_PADDING_FLAG | MP_HEADER_COMMITTED_FLAG,
+            memory_order_release);
+        *writeIndex += paddingSize;
+    }
+    return true;
+}
+
+static atomic_uint_least32_t* getMultiProducerHeader(streamBufferHandle_t self, uint32_t index)
+{
+    return (atomic_uint_least32_t*) &getBuffer(self)[index & self->mask];
+}
+
+static size_t getMultiProducerRecordSize(size_t length)
+{
+    return MP_HEADER_SIZE + ((length + MP_RECORD_ALIGNMENT - 1) & ~((size_t) MP_RECORD_ALIGNMENT - 1));
+}
+
+static bool putAligned(streamBufferHandle_t self, const streamBufferSpan_t *fragments, size_t fragmentCount, size_t size)
+{
+    uint8_t *record = NULL;
+
+    // An aligned record is always contiguous
+    if(!streamBuffer_reserve(self, size, &record))
+    {
+        return false;
+    }
+    for(size_t i = 0; i < fragmentCount; i++)
+    {
+        memcpy(record, fragments[i].data, fragments[i].size);
+        record += fragments[i].size;
+    }
+    return streamBuffer_commit(self, size);
+}
+
+static uint32_t getRecordPlacement(streamBufferHandle_t self, uint32_t writeIndex, size_t prefixSize, size_t size, uint32_t *paddingSize)
+{
+    // The payload shall be contiguous: if it would cross the end of the buffer,
+    // pad the end of the buffer and start the record at the beginning instead
+    *paddingSize = 0;
+    if((((writeIndex + prefixSize) & self->mask) + size) > self->size)
+    {
+        *paddingSize = alignRecordIndex(self, writeIndex + self->size - (writeIndex & self->mask)) - writeIndex;
+    }
+    return alignRecordIndex(self, writeIndex + *paddingSize + prefixSize + size);
+}
+
+static uint32_t alignRecordIndex(streamBufferHandle_t self, uint32_t index)
+{
+    // Aligned records start QUEUE_ELEMENT_PREFIX16_SIZE bytes before an aligned
+    // offset, so their payload is aligned
+    if(1 == self->recordAlignment)
+    {
+        return index;
+    }
+    return ((index + QUEUE_ELEMENT_PREFIX16_SIZE + self->recordAlignment - 1) & ~(self->recordAlignment - 1)) -
+        QUEUE_ELEMENT_PREFIX16_SIZE;
+}
+
+static size_t writeRecordInBuffer(streamBufferHandle_t self, uint32_t index, const uint8_t *data, size_t size)
+{
+    uint32_t offset = index & self->mask;
+    size_t prefixSize = getPrefixSize(self, size);
+    uint8_t dataPrefix[QUEUE_ELEMENT_PREFIX_MAX_SIZE] = { 0 };
+
+    if((offset + prefixSize + size) <= self->size)
+    {
+        // The whole element is contiguous: serialize the prefix in place
+        encodePrefix(self, size, prefixSize, &getBuffer(self)[offset]);
+        memcpy(&getBuffer(self)[offset + prefixSize], data, size);
+    }
+    else
+    {
+        encodePrefix(self, size, prefixSize, dataPrefix);
+        writeDataInBuffer(self, index, dataPrefix, prefixSize);
+        writeDataInBuffer(self, index + prefixSize, data, size);
+    }
+    return prefixSize + size;
+}
+
+static void writeDataInBuffer(streamBufferHandle_t self, uint32_t index, const uint8_t *data, size_t size)
+{
+    uint32_t offset = index & self->mask;
+    size_t firstChunkSize = self->size - offset;
+
+    if(size <= firstChunkSize)
+    {
+        // The element may be written in one go
+        memcpy(&getBuffer(self)[offset], data, size);
+    }
+    else
+    {
+        // The element shall be written in two chunks
+        memcpy(&getBuffer(self)[offset], data, firstChunkSize);
+        memcpy(&getBuffer(self)[0], &data[firstChunkSize], size - firstChunkSize);
+    }
+}
+
+static void readDataFromBuffer(streamBufferHandle_t self, uint32_t index, uint8_t *data, size_t size)
+{
+    uint32_t offset = index & self->mask;
+    size_t firstChunkSize = self->size - offset;
+
+    if(size <= firstChunkSize)
+    {
+        // The element may be read in one go
+        memcpy(data, &getBuffer(self)[offset], size);
+    }
+    else
+    {
+        // The element shall be read in two chunks
+        memcpy(data, &getBuffer(self)[offset], firstChunkSize);
+        memcpy(&data[firstChunkSize], &getBuffer(self)[0], size - firstChunkSize);
+    }
+}
+
+static void clearDataInBuffer(streamBufferHandle_t self, uint32_t index, size_t size)
+{
+    uint32_t offset = index & self->mask;
+    size_t firstChunkSize = self->size - offset;
+
+    if(size <= firstChunkSize)
+    {
+        memset(&getBuffer(self)[offset], 0, size);
+    }
+    else
+    {
+        memset(&getBuffer(self)[offset], 0, firstChunkSize);
+        memset(&getBuffer(self)[0], 0, size - firstChunkSize);
+    }
+}
+
+static void wakeConsumer(streamBufferHandle_t self)
+{
+    streamBufferWakeup_t wakeup = atomic_load_explicit(&self->wakeup, memory_order_acquire);
+
+    // Without a wakeup function the consumer never waits, so the fence is
+    // left out of the put path
+    if(NULL == wakeup)
+    {
+        return;
+    }
+
+    // The consumer only asks for a wakeup once it found the buffer empty, so
+    // the callback is skipped as long as it keeps up with the producer
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(&self->needWakeup, memory_order_relaxed) &&
+        atomic_exchange_explicit(&self->needWakeup, false, memory_order_acquire))
+    {
+        wakeup(self->wakeupContext);
+    }
+}
+
+static void countPut(streamBufferHandle_t self, uint32_t writeIndex, size_t recordCount, size_t byteCount, size_t largestSize)
+{
+#if STREAM_BUFFER_ENABLE_STATS
+    uint32_t usedSize = 0;
+    uint32_t maxSize = 0;
+
+    if(self->isMultiProducer)
+    {
+        // Several producers may update the counters at once
+        atomic_fetch_add_explicit(&self->putRecordCount, recordCount, memory_order_relaxed);
+        atomic_fetch_add_explicit(&self->putByteCount, byteCount, memory_order_relaxed);
+
+        // The consumer may already be past this record, which gives a bogus usage
+        usedSize = writeIndex - atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+        maxSize = atomic_load_explicit(&self->maxUsedSize, memory_order_relaxed);
+        while((usedSize <= self->size) && (usedSize > maxSize) &&
+            !atomic_compare_exchange_weak_explicit(&self->maxUsedSize, &maxSize, usedSize, memory_order_relaxed, memory_order_relaxed))
+        {
+        }
+        maxSize = atomic_load_explicit(&self->largestRecordSize, memory_order_relaxed);
+        while((largestSize > maxSize) &&
+            !atomic_compare_exchange_weak_explicit(&self->largestRecordSize, &maxSize, (uint32_t) largestSize,
+                memory_order_relaxed, memory_order_relaxed))
+        {
+        }
+        return;
+    }
+
+    // Only the producer writes these, a load/store pair is enough and avoids
+    // a locked instruction on the put path
+    atomic_store_explicit(&self->putRecordCount,
+        atomic_load_explicit(&self->putRecordCount, memory_order_relaxed) + recordCount, memory_order_relaxed);
+    atomic_store_explicit(&self->putByteCount,
+        atomic_load_explicit(&self->putByteCount, memory_order_relaxed) + byteCount, memory_order_relaxed);
+
+    // The cached read index gives an upper bound of the usage, the shared
+    // one is only loaded when this bound beats the high-water mark
+    maxSize = atomic_load_explicit(&self->maxUsedSize, memory_order_relaxed);
+    if((writeIndex - self->cachedReadIndex) > maxSize)
+    {
+        usedSize = writeIndex - atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+        if((usedSize <= self->size) && (usedSize > maxSize))
+        {
+            atomic_store_explicit(&self->maxUsedSize, usedSize, memory_order_relaxed);
+        }
+    }
+    if(largestSize > atomic_load_explicit(&self->largestRecordSize, memory_order_relaxed))
+    {
+        atomic_store_explicit(&self->largestRecordSize, (uint32_t) largestSize, memory_order_relaxed);
+    }
+#else
+    (void) self;
+    (void) writeIndex;
+    (void) recordCount;
+    (void) byteCount;
+    (void) largestSize;
+#endif
+}
+
+static void countRejectedPut(streamBufferHandle_t self)
+{
+#if STREAM_BUFFER_ENABLE_STATS
+    if(self->isMultiProducer)
+    {
+        atomic_fetch_add_explicit(&self->rejectedPutCount, 1, memory_order_relaxed);
+    }
+    else
+    {
+        atomic_store_explicit(&self->rejectedPutCount,
+            atomic_load_explicit(&self->rejectedPutCount, memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+#else
+    (void) self;
+#endif
+}
+
+static void countGet(streamBufferHandle_t self, size_t recordCount, size_t byteCount)
+{
+#if STREAM_BUFFER_ENABLE_STATS
+    // There's a single consumer in every mode
+    atomic_store_explicit(&self->getRecordCount,
+        atomic_load_explicit(&self->getRecordCount, memory_order_relaxed) + recordCount, memory_order_relaxed);
+    atomic_store_explicit(&self->getByteCount,
+        atomic_load_explicit(&self->getByteCount, memory_order_relaxed) + byteCount, memory_order_relaxed);
+#else
+    (void) self;
+    (void) recordCount;
+    (void) byteCount;
+#endif
+}
+
+static void discardExpiredRecords(streamBufferHandle_t self)
+{
+    uint32_t readIndex = 0;
+    uint32_t nextIndex = 0;
+    uint64_t count = 0;
+
+    // A peeked record is kept until it's released, with the records after it
+    if(self->isPeeked)
+    {
+        return;
+    }
+
+    readIndex = atomic_load_explicit(&self->r_ptr, memory_order_relaxed);
+    nextIndex = skipExpiredRecords(self, readIndex, &count);
+    if(0 != count)
+    {
+        releaseRecords(self, readIndex, nextIndex);
+        atomic_store_explicit(&self->expiredRecordCount,
+            atomic_load_explicit(&self->expiredRecordCount, memory_order_relaxed) + count, memory_order_relaxed);
+    }
+}
+
+static uint32_t skipExpiredRecords(streamBufferHandle_t self, uint32_t readIndex, uint64_t *count)
+{
+    uint32_t now = 0;
+    uint32_t timestamp = 0;
+    recordLocation_t location;
+
+    *count = 0;
+    if(0 == self->timeToLive)
+    {
+        return readIndex;
+    }
+
+    // The records are published in chronological order, so the expired ones
+    // are all at the head. Only their prefix is read.
+    now = self->getTime();
+    while(findNextRecord(self, readIndex, &location))
+    {
+        readDataFromBuffer(self, location.dataIndex - QUEUE_ELEMENT_TIMESTAMP_SIZE, (uint8_t*) &timestamp,
+            QUEUE_ELEMENT_TIMESTAMP_SIZE);
+        if((uint32_t) (now - timestamp) <= self->timeToLive)
+        {
+            break;
+        }
+        readIndex = location.nextIndex;
+        (*count)++;
     }
+    return readIndex;
 }
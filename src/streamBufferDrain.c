@@ -0,0 +1,356 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "streamBufferDrain.h"
+#include "miscUtils.h"
+
+/******************************************************************************
+ ********************** Local Type/Constant definitions ***********************
+ *****************************************************************************/
+
+/******************************************************************************
+ ************************ Local function declarations *************************
+ *****************************************************************************/
+static bool mapRings(streamBufferDrain_t *self, const struct io_uring_params *params);
+static void unmapRings(streamBufferDrain_t *self);
+static bool reapCompletions(streamBufferDrain_t *self);
+static size_t releaseWrittenSlots(streamBufferDrain_t *self);
+static void queueNewBytes(streamBufferDrain_t *self);
+static void submitSlots(streamBufferDrain_t *self);
+
+/******************************************************************************
+ ************************ Global variables definitions ************************
+ *****************************************************************************/
+
+/******************************************************************************
+ ************************ Local variables declarations ************************
+ *****************************************************************************/
+
+/******************************************************************************
+ ************************ Public function definitions *************************
+ *****************************************************************************/
+bool streamBufferDrain_init(streamBufferDrain_t *self, streamBufferHandle_t streamBuffer, int fd, bool isSocket, uint64_t offset)
+{
+    struct io_uring_params params;
+
+    // Sanity checks. Releasing no byte tells if the byte functions serve the
+    // stream buffer, the drain would never write anything otherwise.
+    if((NULL == self) || (NULL == streamBuffer) || (0 > fd) || !streamBuffer_releaseBytes(streamBuffer, 0))
+    {
+        return false;
+    }
+
+    // No need for liburing: the ring is set up with the raw system calls. A
+    // completion is posted for each slot at most, so the rings never overflow.
+    memset(self, 0, sizeof(*self));
+    memset(&params, 0, sizeof(params));
+    self->ringFd = (int) syscall(__NR_io_uring_setup, STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT, &params);
+    if(0 > self->ringFd)
+    {
+        return false;
+    }
+    if(!mapRings(self, &params))
+    {
+        close(self->ringFd);
+        self->ringFd = -1;
+        return false;
+    }
+
+    self->streamBuffer = streamBuffer;
+    self->fd = fd;
+    self->isSocket = isSocket;
+    self->nextOffset = offset;
+    return true;
+}
+
+bool streamBufferDrain_deinit(streamBufferDrain_t *self)
+{
+    // Sanity checks
+    if((NULL == self) || (0 > self->ringFd))
+    {
+        return false;
+    }
+
+    unmapRings(self);
+    close(self->ringFd);
+    self->ringFd = -1;
+    self->streamBuffer = NULL;
+    return true;
+}
+
+bool streamBufferDrain_run(streamBufferDrain_t *self, bool isWaiting, size_t *drainedSize, bool *isIdle)
+{
+    bool isSuccessful = true;
+    uint32_t submissionCount = 0;
+    uint32_t completionCount = 0;
+    long result = 0;
+
+    // Sanity checks
+    if((NULL == self) || (0 > self->ringFd) || (NULL == drainedSize) || (NULL == isIdle))
+    {
+        return false;
+    }
+
+    // The bytes are given back to the producer in order, once every write
+    // before them completed
+    isSuccessful = reapCompletions(self);
+    *drainedSize = releaseWrittenSlots(self);
+    queueNewBytes(self);
+    submitSlots(self);
+
+    // The entries the kernel didn't take yet, e.g. after an interrupted call,
+    // are submitted along with the new ones
+    submissionCount = *self->submissionTail - atomic_load_explicit((atomic_uint_least32_t*) self->submissionHead, memory_order_acquire);
+    completionCount = (isWaiting && (0 != self->inFlightCount)) ? 1 : 0;
+    if((0 != submissionCount) || (0 != completionCount))
+    {
+        result = syscall(__NR_io_uring_enter, self->ringFd, submissionCount, completionCount,
+            (0 != completionCount) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if((0 > result) && (EINTR != errno) && (EAGAIN != errno) && (EBUSY != errno))
+        {
+            isSuccessful = false;
+        }
+    }
+
+    *isIdle = (0 == self->slotCount);
+    return isSuccessful;
+}
+
+/******************************************************************************
+ ************************* Local function definitions *************************
+ *****************************************************************************/
+static bool mapRings(streamBufferDrain_t *self, const struct io_uring_params *params)
+{
+    uint8_t *submissionRing = NULL;
+    uint8_t *completionRing = NULL;
+
+    self->submissionRingSize = params->sq_off.array + params->sq_entries * sizeof(uint32_t);
+    self->completionRingSize = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    if(0 != (params->features & IORING_FEAT_SINGLE_MMAP))
+    {
+        self->submissionRingSize = MISC_UTILS_MAX(self->submissionRingSize, self->completionRingSize);
+        self->completionRingSize = 0;
+    }
+    self->entriesSize = params->sq_entries * sizeof(struct io_uring_sqe);
+
+    self->submissionRing = mmap(NULL, self->submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        self->ringFd, IORING_OFF_SQ_RING);
+    self->completionRing = self->submissionRing;
+    if((MAP_FAILED != self->submissionRing) && (0 != self->completionRingSize))
+    {
+        self->completionRing = mmap(NULL, self->completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            self->ringFd, IORING_OFF_CQ_RING);
+    }
+    self->entries = mmap(NULL, self->entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        self->ringFd, IORING_OFF_SQES);
+    if((MAP_FAILED == self->submissionRing) || (MAP_FAILED == self->completionRing) || (MAP_FAILED == self->entries))
+    {
+        unmapRings(self);
+        return false;
+    }
+
+    submissionRing = (uint8_t*) self->submissionRing;
+    completionRing = (uint8_t*) self->completionRing;
+    self->submissionHead = (uint32_t*) &submissionRing[params->sq_off.head];
+    self->submissionTail = (uint32_t*) &submissionRing[params->sq_off.tail];
+    self->submissionMask = (uint32_t*) &submissionRing[params->sq_off.ring_mask];
+    self->submissionArray = (uint32_t*) &submissionRing[params->sq_off.array];
+    self->completionHead = (uint32_t*) &completionRing[params->cq_off.head];
+    self->completionTail = (uint32_t*) &completionRing[params->cq_off.tail];
+    self->completionMask = (uint32_t*) &completionRing[params->cq_off.ring_mask];
+    self->completions = &completionRing[params->cq_off.cqes];
+    return true;
+}
+
+static void unmapRings(streamBufferDrain_t *self)
+{
+    if((NULL != self->entries) && (MAP_FAILED != self->entries))
+    {
+        munmap(self->entries, self->entriesSize);
+    }
+    if((NULL != self->completionRing) && (MAP_FAILED != self->completionRing) && (self->completionRing != self->submissionRing))
+    {
+        munmap(self->completionRing, self->completionRingSize);
+    }
+    if((NULL != self->submissionRing) && (MAP_FAILED != self->submissionRing))
+    {
+        munmap(self->submissionRing, self->submissionRingSize);
+    }
+    self->entries = NULL;
+    self->completionRing = NULL;
+    self->submissionRing = NULL;
+}
+
+static bool reapCompletions(streamBufferDrain_t *self)
+{
+    const struct io_uring_cqe *completions = (const struct io_uring_cqe*) self->completions;
+    uint32_t head = *self->completionHead;
+    uint32_t tail = atomic_load_explicit((atomic_uint_least32_t*) self->completionTail, memory_order_acquire);
+    streamBufferDrainSlot_t *slot = NULL;
+    bool isSuccessful = true;
+
+    for(; head != tail; head++)
+    {
+        const struct io_uring_cqe *completion = &completions[head & *self->completionMask];
+
+        slot = &self->slots[completion->user_data];
+        slot->isInFlight = false;
+        self->inFlightCount--;
+
+        // A short write is submitted again from where it stopped, as well as
+        // the sends canceled behind it. Nothing written at all is an error, or
+        // the span would be submitted forever.
+        if(0 < completion->res)
+        {
+            slot->writtenSize += (uint32_t) completion->res;
+        }
+        else if((-ECANCELED != completion->res) && (-EINTR != completion->res) && (-EAGAIN != completion->res))
+        {
+            isSuccessful = false;
+        }
+    }
+    atomic_store_explicit((atomic_uint_least32_t*) self->completionHead, head, memory_order_release);
+    return isSuccessful;
+}
+
+static size_t releaseWrittenSlots(streamBufferDrain_t *self)
+{
+    size_t releasedSize = 0;
+
+    while((0 != self->slotCount) && (self->slots[self->firstSlot].writtenSize == self->slots[self->firstSlot].size))
+    {
+        releasedSize += self->slots[self->firstSlot].size + self->slots[self->firstSlot].skippedSize;
+        self->firstSlot = (self->firstSlot + 1) % STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT;
+        self->slotCount--;
+    }
+
+    // A single store of the read index for all the completed spans
+    if(0 != releasedSize)
+    {
+        streamBuffer_releaseBytes(self->streamBuffer, releasedSize);
+        self->queuedSize -= releasedSize;
+    }
+    return releasedSize;
+}
+
+static void queueNewBytes(streamBufferDrain_t *self)
+{
+    streamBufferRecord_t bytes;
+    streamBufferDrainSlot_t *slot = NULL;
+    size_t skippedSize = 0;
+
+    // The bytes already in the slots stay in the stream buffer until written
+    if((STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT == self->slotCount) ||
+        !streamBuffer_peekBytes(self->streamBuffer, self->queuedSize, &bytes))
+    {
+        return;
+    }
+
+    // A span for each side of the end of the buffer. The wrap padding between
+    // them is never written, it's released along with the first queued span.
+    skippedSize = bytes.size - bytes.spans[0].size - bytes.spans[1].size;
+    for(size_t i = 0; (i < 2) && (STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT > self->slotCount); i++)
+    {
+        if(0 == bytes.spans[i].size)
+        {
+            continue;
+        }
+
+        slot = &self->slots[(self->firstSlot + self->slotCount) % STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT];
+        slot->data = bytes.spans[i].data;
+        slot->size = (uint32_t) bytes.spans[i].size;
+        slot->skippedSize = (uint32_t) skippedSize;
+        slot->writtenSize = 0;
+        slot->offset = self->nextOffset;
+        slot->isInFlight = false;
+        self->nextOffset += bytes.spans[i].size;
+        self->queuedSize += bytes.spans[i].size + skippedSize;
+        self->slotCount++;
+        skippedSize = 0;
+    }
+}
+
+static void submitSlots(streamBufferDrain_t *self)
+{
+    struct io_uring_sqe *entries = (struct io_uring_sqe*) self->entries;
+    struct io_uring_sqe *entry = NULL;
+    uint32_t tail = *self->submissionTail;
+    uint32_t slotIndex = 0;
+    streamBufferDrainSlot_t *slot = NULL;
+
+    // The kernel may complete the writes in any order. It doesn't matter for
+    // a file since each span has its own position, but the sends of a socket
+    // are linked, so they are only submitted once the previous chain is over.
+    // MSG_WAITALL makes a short send fail the chain: the sends behind it are
+    // canceled and everything from the short one on is sent again in order.
+    if(self->isSocket && (0 != self->inFlightCount))
+    {
+        return;
+    }
+
+    for(uint32_t i = 0; i < self->slotCount; i++)
+    {
+        slotIndex = (self->firstSlot + i) % STREAM_BUFFER_DRAIN_MAX_SLOT_COUNT;
+        slot = &self->slots[slotIndex];
+        if(slot->isInFlight || (slot->writtenSize == slot->size))
+        {
+            continue;
+        }
+
+        entry = &entries[tail & *self->submissionMask];
+        memset(entry, 0, sizeof(*entry));
+        entry->fd = self->fd;
+        entry->addr = (uint64_t) (uintptr_t) &slot->data[slot->writtenSize];
+        entry->len = slot->size - slot->writtenSize;
+        entry->user_data = slotIndex;
+        if(self->isSocket)
+        {
+            entry->opcode = IORING_OP_SEND;
+            entry->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            entry->flags = IOSQE_IO_LINK;
+        }
+        else
+        {
+            entry->opcode = IORING_OP_WRITE;
+            entry->off = slot->offset + slot->writtenSize;
+        }
+        self->submissionArray[tail & *self->submissionMask] = tail & *self->submissionMask;
+        slot->isInFlight = true;
+        self->inFlightCount++;
+        tail++;
+    }
+
+    // The chain ends with the last send
+    if(NULL != entry)
+    {
+        entry->flags &= ~IOSQE_IO_LINK;
+        atomic_store_explicit((atomic_uint_least32_t*) self->submissionTail, tail, memory_order_release);
+    }
+}
@@ -0,0 +1,261 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#include <string.h>
+
+#include "streamBufferIngest.h"
+#include "miscUtils.h"
+
+/******************************************************************************
+ ************************ Local function declarations *************************
+ *****************************************************************************/
+static bool isRuleValid(const streamBufferIngestRule_t *rule);
+static bool readPrefix(streamBufferIngest_t *self, const uint8_t *data, size_t size, size_t *offset);
+static bool readFrame(streamBufferIngest_t *self, const uint8_t *data, size_t size, size_t *offset);
+static size_t decodePrefix(const streamBufferIngest_t *self);
+static void endFrame(streamBufferIngest_t *self, size_t frameSize);
+
+/******************************************************************************
+ ************************ Public function definitions *************************
+ *****************************************************************************/
+bool streamBufferIngest_init(streamBufferIngest_t *self, streamBufferHandle_t streamBuffer, const streamBufferIngestRule_t *rule)
+{
+    size_t maxReserveSize = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == streamBuffer) || (NULL == rule) || !isRuleValid(rule))
+    {
+        return false;
+    }
+
+    // A frame that can't be reserved would stall the parsing forever
+    if(!streamBuffer_getMaxReserveSize(streamBuffer, &maxReserveSize) || (rule->maxFrameSize > maxReserveSize))
+    {
+        return false;
+    }
+
+    self->streamBuffer = streamBuffer;
+    self->rule = *rule;
+    self->prefixCount = 0;
+    self->frame = NULL;
+    self->frameSize = 0;
+    self->frameCount = 0;
+    return true;
+}
+
+bool streamBufferIngest_push(streamBufferIngest_t *self, const uint8_t *data, size_t size, size_t *consumedSize)
+{
+    size_t offset = 0;
+    bool isValid = true;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == self->streamBuffer) || (NULL == data) || (NULL == consumedSize))
+    {
+        return false;
+    }
+
+    while(isValid)
+    {
+        if(NULL == self->frame)
+        {
+            // Learn the size of the frame first
+            if(STREAM_BUFFER_INGEST_FRAMING_PREFIX == self->rule.framing)
+            {
+                if(!readPrefix(self, data, size, &offset))
+                {
+                    break;
+                }
+                if(0 == self->frameSize)
+                {
+                    self->prefixCount = 0;
+                    continue;
+                }
+                if(self->frameSize > self->rule.maxFrameSize)
+                {
+                    isValid = false;
+                    break;
+                }
+            }
+            else if(offset == size)
+            {
+                break;
+            }
+
+            // The frame is written in place, stop while the stream buffer is full
+            if(!streamBuffer_reserve(self->streamBuffer, (STREAM_BUFFER_INGEST_FRAMING_PREFIX == self->rule.framing) ?
+                self->frameSize : self->rule.maxFrameSize, &self->frame))
+            {
+                self->frame = NULL;
+                break;
+            }
+            self->frameCount = 0;
+        }
+
+        isValid = readFrame(self, data, size, &offset);
+        if(offset == size)
+        {
+            break;
+        }
+    }
+
+    *consumedSize = offset;
+    return isValid;
+}
+
+bool streamBufferIngest_reset(streamBufferIngest_t *self)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == self->streamBuffer))
+    {
+        return false;
+    }
+
+    endFrame(self, 0);
+    return true;
+}
+
+/******************************************************************************
+ ************************* Local function definitions *************************
+ *****************************************************************************/
+static bool isRuleValid(const streamBufferIngestRule_t *rule)
+{
+    if(0 == rule->maxFrameSize)
+    {
+        return false;
+    }
+
+    switch(rule->framing)
+    {
+        case STREAM_BUFFER_INGEST_FRAMING_PREFIX:
+            return (1 == rule->prefixSize) || (2 == rule->prefixSize) || (4 == rule->prefixSize);
+
+        case STREAM_BUFFER_INGEST_FRAMING_DELIMITER:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool readPrefix(streamBufferIngest_t *self, const uint8_t *data, size_t size, size_t *offset)
+{
+    size_t count = MISC_UTILS_MIN((size_t) (self->rule.prefixSize - self->prefixCount), size - *offset);
+
+    // The prefix may be split between chunks
+    memcpy(&self->prefix[self->prefixCount], &data[*offset], count);
+    self->prefixCount += count;
+    *offset += count;
+    if(self->prefixCount < self->rule.prefixSize)
+    {
+        return false;
+    }
+
+    self->frameSize = decodePrefix(self);
+    return true;
+}
+
+static bool readFrame(streamBufferIngest_t *self, const uint8_t *data, size_t size, size_t *offset)
+{
+    const uint8_t *delimiter = NULL;
+    size_t count = size - *offset;
+
+    if(STREAM_BUFFER_INGEST_FRAMING_PREFIX == self->rule.framing)
+    {
+        count = MISC_UTILS_MIN(count, self->frameSize - self->frameCount);
+        memcpy(&self->frame[self->frameCount], &data[*offset], count);
+        self->frameCount += count;
+        *offset += count;
+        if(self->frameCount == self->frameSize)
+        {
+            endFrame(self, self->frameSize);
+        }
+        return true;
+    }
+
+    // Copy up to the delimiter, which isn't part of the record
+    delimiter = memchr(&data[*offset], self->rule.delimiter, count);
+    if(NULL != delimiter)
+    {
+        count = (size_t) (delimiter - &data[*offset]);
+    }
+    if(count > (self->rule.maxFrameSize - self->frameCount))
+    {
+        endFrame(self, 0);
+        return false;
+    }
+
+    memcpy(&self->frame[self->frameCount], &data[*offset], count);
+    self->frameCount += count;
+    *offset += count;
+    if(NULL != delimiter)
+    {
+        (*offset)++;
+        endFrame(self, self->frameCount);
+    }
+    return true;
+}
+
+static size_t decodePrefix(const streamBufferIngest_t *self)
+{
+    uint16_t length16 = 0;
+    uint32_t length32 = 0;
+
+    switch(self->rule.prefixSize)
+    {
+        case 1:
+            return self->prefix[0];
+
+        case 2:
+            if(self->rule.isLittleEndian)
+            {
+                miscUtils_littleEndianBytesToUint16(self->prefix, &length16);
+            }
+            else
+            {
+                miscUtils_bigEndianBytesToUint16(self->prefix, &length16);
+            }
+            return length16;
+
+        default:
+            if(self->rule.isLittleEndian)
+            {
+                miscUtils_littleEndianBytesToUint32(self->prefix, &length32);
+            }
+            else
+            {
+                miscUtils_bigEndianBytesToUint32(self->prefix, &length32);
+            }
+            return length32;
+    }
+}
+
+static void endFrame(streamBufferIngest_t *self, size_t frameSize)
+{
+    // Committing 0 byte cancels the reservation, so empty frames are dropped
+    if(NULL != self->frame)
+    {
+        streamBuffer_commit(self->streamBuffer, frameSize);
+    }
+    self->frame = NULL;
+    self->frameSize = 0;
+    self->frameCount = 0;
+    self->prefixCount = 0;
+}
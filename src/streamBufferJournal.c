@@ -0,0 +1,441 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "streamBufferJournal.h"
+#include "crcUtils.h"
+#include "miscUtils.h"
+
+/******************************************************************************
+ ********************** Local Type/Constant definitions ***********************
+ *****************************************************************************/
+#define JOURNAL_MAGIC (0x53424A4C)      // "SBJL"
+#define JOURNAL_VERSION (1)
+#define JOURNAL_FLAG_CHECKSUM (0x0001)
+#define JOURNAL_PREFIX_SIZE (2)         // Same framing as STREAM_BUFFER_FORMAT_PREFIX16
+#define JOURNAL_CHECKSUM_SIZE (1)
+#define JOURNAL_INDEX_DIGIT_COUNT (8)
+
+// A segment starts with a header made of the magic number (4 bytes), the
+// version (2 bytes) and the flags (2 bytes), all big endian. The records follow
+// and the rest of the segment is filled with zeros: a length of 0 marks the end
+// of the records. The data of a record is written before its prefix, so a
+// record torn by a process crash is never seen as complete: the page cache
+// keeps the stores in order and the kernel writes it back later. That order
+// doesn't survive a power loss or a kernel crash, as the dirty pages of the
+// mapping are written back in any order. A record appended after the last
+// streamBufferJournal_sync can then be found with its prefix but not its data,
+// and only the checksum tells it apart.
+
+/******************************************************************************
+ ************************ Local function declarations *************************
+ *****************************************************************************/
+static bool buildSegmentPath(const char *pathPrefix, uint32_t segmentIndex, char *path);
+static bool startSegment(streamBufferJournal_t *self, uint32_t segmentIndex);
+static bool recoverSegment(streamBufferJournal_t *self, uint32_t segmentIndex);
+static uint8_t* mapSegment(const char *path, bool isWritable, size_t *size);
+static bool readSegmentHeader(const uint8_t *segment, size_t size, bool *isChecksumEnabled);
+static bool readRecord(const uint8_t *segment, size_t size, size_t offset, bool isChecksumEnabled, streamBufferSpan_t *record);
+static size_t getRecordSize(size_t size, bool isChecksumEnabled);
+
+/******************************************************************************
+ ************************ Public function definitions *************************
+ *****************************************************************************/
+bool streamBufferJournal_open(streamBufferJournal_t *self, const char *directory, const char *name, size_t segmentSize, bool isChecksumEnabled)
+{
+    uint32_t firstIndex = 0;
+    uint32_t lastIndex = 0;
+    int length = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == directory) || (NULL == name) ||
+        (segmentSize < (STREAM_BUFFER_JOURNAL_HEADER_SIZE + getRecordSize(1, isChecksumEnabled))))
+    {
+        return false;
+    }
+
+    length = snprintf(self->pathPrefix, sizeof(self->pathPrefix), "%s/%s", directory, name);
+    if((0 > length) || ((size_t) length + 1 + JOURNAL_INDEX_DIGIT_COUNT >= sizeof(self->pathPrefix)))
+    {
+        return false;
+    }
+    self->segment = NULL;
+    self->segmentSize = segmentSize;
+    self->isChecksumEnabled = isChecksumEnabled;
+
+    // Continue the last segment if possible
+    if(streamBufferJournal_findSegments(directory, name, &firstIndex, &lastIndex))
+    {
+        return recoverSegment(self, lastIndex) || startSegment(self, lastIndex + 1);
+    }
+    return startSegment(self, 0);
+}
+
+bool streamBufferJournal_append(streamBufferJournal_t *self, const uint8_t *data, size_t size)
+{
+    size_t recordSize = 0;
+    uint8_t *record = NULL;
+    uint8_t prefix[JOURNAL_PREFIX_SIZE] = { 0 };
+    uint8_t checksum = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == self->segment) || (NULL == data) || (0 == size) || (UINT16_MAX < size))
+    {
+        return false;
+    }
+
+    // Start a new segment when the record doesn't fit in the current one
+    recordSize = getRecordSize(size, self->isChecksumEnabled);
+    if(recordSize > (self->mappingSize - self->writeOffset))
+    {
+        if(recordSize > (self->segmentSize - STREAM_BUFFER_JOURNAL_HEADER_SIZE))
+        {
+            return false;
+        }
+
+        munmap(self->segment, self->mappingSize);
+        self->segment = NULL;
+        if(!startSegment(self, self->segmentIndex + 1))
+        {
+            return false;
+        }
+    }
+
+    // The prefix is written last, after the checksum which covers it, so the
+    // record is never seen with its length but without its checksum. The fence
+    // only orders the stores for a process crash, see above.
+    record = &self->segment[self->writeOffset];
+    memcpy(&record[JOURNAL_PREFIX_SIZE], data, size);
+    if(self->isChecksumEnabled)
+    {
+        miscUtils_uint16ToBigEndianBytes((uint16_t) size, prefix);
+        crcUtils_Ccitt8Compute(prefix, JOURNAL_PREFIX_SIZE, &checksum);
+        crcUtils_Ccitt8Compute(&record[JOURNAL_PREFIX_SIZE], size, &checksum);
+        record[JOURNAL_PREFIX_SIZE + size] = checksum;
+    }
+    atomic_thread_fence(memory_order_release);
+    miscUtils_uint16ToBigEndianBytes((uint16_t) size, record);
+    self->writeOffset += recordSize;
+    return true;
+}
+
+bool streamBufferJournal_sync(streamBufferJournal_t *self)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == self->segment))
+    {
+        return false;
+    }
+
+    return 0 == msync(self->segment, self->mappingSize, MS_SYNC);
+}
+
+bool streamBufferJournal_close(streamBufferJournal_t *self)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == self->segment))
+    {
+        return false;
+    }
+
+    munmap(self->segment, self->mappingSize);
+    self->segment = NULL;
+    return true;
+}
+
+bool streamBufferJournal_findSegments(const char *directory, const char *name, uint32_t *firstIndex, uint32_t *lastIndex)
+{
+    DIR *dir = NULL;
+    struct dirent *entry = NULL;
+    size_t nameLength = 0;
+    bool isFound = false;
+
+    // Sanity checks
+    if((NULL == directory) || (NULL == name) || (NULL == firstIndex) || (NULL == lastIndex))
+    {
+        return false;
+    }
+
+    dir = opendir(directory);
+    if(NULL == dir)
+    {
+        return false;
+    }
+
+    // Only "<name>.<8 digits>" are segments of the journal
+    nameLength = strlen(name);
+    while(NULL != (entry = readdir(dir)))
+    {
+        const char *suffix = &entry->d_name[nameLength + 1];
+        char *end = NULL;
+        uint32_t index = 0;
+
+        if((0 != strncmp(entry->d_name, name, nameLength)) || ('.' != entry->d_name[nameLength]) ||
+            (JOURNAL_INDEX_DIGIT_COUNT != strspn(suffix, "0123456789")) || ('\0' != suffix[JOURNAL_INDEX_DIGIT_COUNT]))
+        {
+            continue;
+        }
+
+        index = (uint32_t) strtoul(suffix, &end, 10);
+        *firstIndex = (!isFound || (index < *firstIndex)) ? index : *firstIndex;
+        *lastIndex = (!isFound || (index > *lastIndex)) ? index : *lastIndex;
+        isFound = true;
+    }
+    closedir(dir);
+    return isFound;
+}
+
+bool streamBufferJournal_openReader(streamBufferJournalReader_t *self, const char *directory, const char *name, uint32_t segmentIndex)
+{
+    char pathPrefix[STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH] = { 0 };
+    char path[STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH] = { 0 };
+    int length = 0;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == directory) || (NULL == name))
+    {
+        return false;
+    }
+
+    length = snprintf(pathPrefix, sizeof(pathPrefix), "%s/%s", directory, name);
+    if((0 > length) || ((size_t) length >= sizeof(pathPrefix)) || !buildSegmentPath(pathPrefix, segmentIndex, path))
+    {
+        return false;
+    }
+
+    self->segment = mapSegment(path, false, &self->segmentSize);
+    if(NULL == self->segment)
+    {
+        return false;
+    }
+    if(!readSegmentHeader(self->segment, self->segmentSize, &self->isChecksumEnabled))
+    {
+        munmap((void*) self->segment, self->segmentSize);
+        self->segment = NULL;
+        return false;
+    }
+    self->readOffset = STREAM_BUFFER_JOURNAL_HEADER_SIZE;
+    return true;
+}
+
+bool streamBufferJournal_readNext(streamBufferJournalReader_t *self, streamBufferSpan_t *record)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == self->segment) || (NULL == record))
+    {
+        return false;
+    }
+
+    if(!readRecord(self->segment, self->segmentSize, self->readOffset, self->isChecksumEnabled, record))
+    {
+        return false;
+    }
+    self->readOffset += getRecordSize(record->size, self->isChecksumEnabled);
+    return true;
+}
+
+bool streamBufferJournal_closeReader(streamBufferJournalReader_t *self)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == self->segment))
+    {
+        return false;
+    }
+
+    munmap((void*) self->segment, self->segmentSize);
+    self->segment = NULL;
+    return true;
+}
+
+/******************************************************************************
+ ************************* Local function definitions *************************
+ *****************************************************************************/
+static bool buildSegmentPath(const char *pathPrefix, uint32_t segmentIndex, char *path)
+{
+    int length = snprintf(path, STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH, "%s.%08u", pathPrefix, (unsigned int) segmentIndex);
+
+    return (0 <= length) && ((size_t) length < STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH);
+}
+
+static bool startSegment(streamBufferJournal_t *self, uint32_t segmentIndex)
+{
+    char path[STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH] = { 0 };
+    int fd = -1;
+
+    if(!buildSegmentPath(self->pathPrefix, segmentIndex, path))
+    {
+        return false;
+    }
+
+    // The file is extended with zeros, so the segment is empty. Its blocks
+    // are allocated now: a store to the mapping can't report a full storage,
+    // it would raise SIGBUS.
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(0 > fd)
+    {
+        return false;
+    }
+    if(0 != posix_fallocate(fd, 0, (off_t) self->segmentSize))
+    {
+        close(fd);
+        unlink(path);
+        return false;
+    }
+    self->segment = mmap(NULL, self->segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(MAP_FAILED == self->segment)
+    {
+        self->segment = NULL;
+        unlink(path);
+        return false;
+    }
+
+    miscUtils_uint32ToBigEndianBytes(JOURNAL_MAGIC, &self->segment[0]);
+    miscUtils_uint16ToBigEndianBytes(JOURNAL_VERSION, &self->segment[4]);
+    miscUtils_uint16ToBigEndianBytes(self->isChecksumEnabled ? JOURNAL_FLAG_CHECKSUM : 0, &self->segment[6]);
+    self->mappingSize = self->segmentSize;
+    self->writeOffset = STREAM_BUFFER_JOURNAL_HEADER_SIZE;
+    self->segmentIndex = segmentIndex;
+    return true;
+}
+
+static bool recoverSegment(streamBufferJournal_t *self, uint32_t segmentIndex)
+{
+    char path[STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH] = { 0 };
+    streamBufferSpan_t record;
+    bool isChecksumEnabled = false;
+    size_t offset = STREAM_BUFFER_JOURNAL_HEADER_SIZE;
+
+    if(!buildSegmentPath(self->pathPrefix, segmentIndex, path))
+    {
+        return false;
+    }
+
+    self->segment = mapSegment(path, true, &self->mappingSize);
+    if(NULL == self->segment)
+    {
+        return false;
+    }
+    if(!readSegmentHeader(self->segment, self->mappingSize, &isChecksumEnabled) || (isChecksumEnabled != self->isChecksumEnabled))
+    {
+        munmap(self->segment, self->mappingSize);
+        self->segment = NULL;
+        return false;
+    }
+
+    // Erase everything after the last valid record, so a torn record can't be
+    // completed by the next records
+    while(readRecord(self->segment, self->mappingSize, offset, isChecksumEnabled, &record))
+    {
+        offset += getRecordSize(record.size, isChecksumEnabled);
+    }
+    memset(&self->segment[offset], 0, self->mappingSize - offset);
+    self->writeOffset = offset;
+    self->segmentIndex = segmentIndex;
+    return true;
+}
+
+static uint8_t* mapSegment(const char *path, bool isWritable, size_t *size)
+{
+    struct stat status;
+    uint8_t *segment = NULL;
+    int fd = open(path, (isWritable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+
+    if(0 > fd)
+    {
+        return NULL;
+    }
+    // A segment written before may be sparse, its blocks are allocated before
+    // the recovery writes to it
+    if((0 != fstat(fd, &status)) || (STREAM_BUFFER_JOURNAL_HEADER_SIZE > status.st_size) ||
+        (isWritable && (0 != posix_fallocate(fd, 0, status.st_size))))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    *size = (size_t) status.st_size;
+    segment = mmap(NULL, *size, isWritable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return (MAP_FAILED == segment) ? NULL : segment;
+}
+
+static bool readSegmentHeader(const uint8_t *segment, size_t size, bool *isChecksumEnabled)
+{
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    uint16_t flags = 0;
+
+    if(STREAM_BUFFER_JOURNAL_HEADER_SIZE > size)
+    {
+        return false;
+    }
+
+    miscUtils_bigEndianBytesToUint32(&segment[0], &magic);
+    miscUtils_bigEndianBytesToUint16(&segment[4], &version);
+    miscUtils_bigEndianBytesToUint16(&segment[6], &flags);
+    *isChecksumEnabled = (0 != (flags & JOURNAL_FLAG_CHECKSUM));
+    return (JOURNAL_MAGIC == magic) && (JOURNAL_VERSION == version);
+}
+
+static bool readRecord(const uint8_t *segment, size_t size, size_t offset, bool isChecksumEnabled, streamBufferSpan_t *record)
+{
+    uint16_t length = 0;
+    uint8_t checksum = 0;
+
+    // A null length marks the end of the records
+    if(JOURNAL_PREFIX_SIZE > (size - offset))
+    {
+        return false;
+    }
+    miscUtils_bigEndianBytesToUint16(&segment[offset], &length);
+    if((0 == length) || (getRecordSize(length, isChecksumEnabled) > (size - offset)))
+    {
+        return false;
+    }
+
+    if(isChecksumEnabled)
+    {
+        crcUtils_Ccitt8Compute(&segment[offset], JOURNAL_PREFIX_SIZE + length, &checksum);
+        if(checksum != segment[offset + JOURNAL_PREFIX_SIZE + length])
+        {
+            return false;
+        }
+    }
+
+    record->data = &segment[offset + JOURNAL_PREFIX_SIZE];
+    record->size = length;
+    return true;
+}
+
+static size_t getRecordSize(size_t size, bool isChecksumEnabled)
+{
+    return JOURNAL_PREFIX_SIZE + size + (isChecksumEnabled ? JOURNAL_CHECKSUM_SIZE : 0);
+}
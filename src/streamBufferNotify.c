@@ -0,0 +1,112 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "streamBufferNotify.h"
+
+/******************************************************************************
+ ************************ Local function declarations *************************
+ *****************************************************************************/
+static void signalEventFd(void *context);
+
+/******************************************************************************
+ ************************ Public function definitions *************************
+ *****************************************************************************/
+bool streamBufferNotify_init(streamBufferNotify_t *self, streamBufferHandle_t streamBuffer)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == streamBuffer))
+    {
+        return false;
+    }
+
+    self->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(0 > self->fd)
+    {
+        return false;
+    }
+
+    self->streamBuffer = streamBuffer;
+    if(!streamBuffer_setWakeup(streamBuffer, signalEventFd, self))
+    {
+        close(self->fd);
+        self->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool streamBufferNotify_deinit(streamBufferNotify_t *self)
+{
+    // Sanity checks
+    if((NULL == self) || (0 > self->fd))
+    {
+        return false;
+    }
+
+    streamBuffer_setWakeup(self->streamBuffer, NULL, NULL);
+    close(self->fd);
+    self->fd = -1;
+    self->streamBuffer = NULL;
+    return true;
+}
+
+int streamBufferNotify_getFd(const streamBufferNotify_t *self)
+{
+    return (NULL == self) ? -1 : self->fd;
+}
+
+bool streamBufferNotify_arm(streamBufferNotify_t *self)
+{
+    uint64_t eventCount = 0;
+
+    // Sanity checks
+    if((NULL == self) || (0 > self->fd))
+    {
+        return false;
+    }
+
+    // Drain the eventfd first, a wakeup sent after this point is kept
+    if((0 > read(self->fd, &eventCount, sizeof(eventCount))) && (EAGAIN != errno))
+    {
+        return false;
+    }
+    return streamBuffer_prepareWait(self->streamBuffer);
+}
+
+/******************************************************************************
+ ************************* Local function definitions *************************
+ *****************************************************************************/
+static void signalEventFd(void *context)
+{
+    const streamBufferNotify_t *self = context;
+    const uint64_t eventCount = 1;
+    ssize_t ret = 0;
+
+    // The write only fails if the counter overflows, the eventfd is readable
+    // anyway in that case
+    ret = write(self->fd, &eventCount, sizeof(eventCount));
+    (void) ret;
+}
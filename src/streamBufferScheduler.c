@@ -0,0 +1,297 @@
+/*******************************************************************************
+* Copyright 2021 Joakim Nicolet (joakimnicolet@gmail.com)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files(the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions :
+*
+* - The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+#include <stdatomic.h>
+
+#include "streamBufferScheduler.h"
+#include "miscUtils.h"
+
+/******************************************************************************
+ ********************** Local Type/Constant definitions ***********************
+ *****************************************************************************/
+typedef enum laneStatus
+{
+    LANE_STATUS_RECORD = 0,     // A record was read
+    LANE_STATUS_EMPTY,          // The lane is left aside until it gets records
+    LANE_STATUS_OVER_BUDGET,    // The next record is larger than the deficit
+    LANE_STATUS_TOO_LARGE,      // The next record doesn't fit in the destination
+} laneStatus_t;
+
+typedef struct schedulerLane
+{
+    struct streamBufferScheduler *scheduler;    // The context of the wakeup function
+    streamBufferHandle_t streamBuffer;
+    uint32_t quantum;
+    uint32_t deficit;   // Bytes the lane may still give in this round
+    uint32_t mask;      // The bit of the lane in the bitmaps
+} schedulerLane_t;
+
+// A bit of the ready bitmap is cleared by the consumer when it finds the lane
+// empty, and set again by the wakeup function called from the producer. The
+// consumer only looks at the lanes with their bit set.
+typedef struct streamBufferScheduler
+{
+    atomic_uint_least32_t readyLanes;
+    uint32_t priorityLanes;
+    uint32_t weightedLanes;
+    size_t laneCount;
+    size_t currentLane;     // The weighted lane having its turn
+    streamBufferWakeup_t wakeup;
+    void *wakeupContext;
+    schedulerLane_t lanes[STREAM_BUFFER_SCHEDULER_MAX_LANE_COUNT];
+} streamBufferSchedulerMetadata_t;
+
+_Static_assert(sizeof(streamBufferSchedulerMetadata_t) <= sizeof(streamBufferSchedulerStatic_t),
+    "STREAM_BUFFER_SCHEDULER_STORAGE_SIZE is too small");
+_Static_assert(_Alignof(streamBufferSchedulerMetadata_t) <= _Alignof(streamBufferSchedulerStatic_t),
+    "streamBufferSchedulerStatic_t isn't aligned enough");
+
+/******************************************************************************
+ ************************ Local function declarations *************************
+ *****************************************************************************/
+static laneStatus_t readLane(streamBufferSchedulerHandle_t self, size_t index, uint8_t *data, size_t capacity, size_t budget,
+    size_t *size);
+static size_t getNextLane(uint32_t lanes, size_t index);
+static size_t getLowestLane(uint32_t lanes);
+static void markLaneReady(void *context);
+
+/******************************************************************************
+ ************************ Public function definitions *************************
+ *****************************************************************************/
+streamBufferSchedulerHandle_t streamBufferScheduler_init(streamBufferSchedulerStatic_t *storage, const streamBufferLane_t *lanes,
+    size_t laneCount, streamBufferWakeup_t wakeup, void *context)
+{
+    streamBufferSchedulerMetadata_t *newInstance = (streamBufferSchedulerMetadata_t*) storage;
+
+    // Sanity checks
+    if((NULL == storage) || (NULL == lanes) || (0 == laneCount) || (STREAM_BUFFER_SCHEDULER_MAX_LANE_COUNT < laneCount))
+    {
+        return NULL;
+    }
+    for(size_t i = 0; i < laneCount; i++)
+    {
+        if((NULL == lanes[i].streamBuffer) || (!lanes[i].isPriority && (0 == lanes[i].quantum)))
+        {
+            return NULL;
+        }
+    }
+
+    newInstance->priorityLanes = 0;
+    newInstance->weightedLanes = 0;
+    newInstance->laneCount = laneCount;
+    newInstance->currentLane = 0;
+    newInstance->wakeup = wakeup;
+    newInstance->wakeupContext = context;
+    for(size_t i = 0; i < laneCount; i++)
+    {
+        schedulerLane_t *lane = &newInstance->lanes[i];
+
+        lane->scheduler = newInstance;
+        lane->streamBuffer = lanes[i].streamBuffer;
+        lane->quantum = lanes[i].quantum;
+        lane->deficit = 0;
+        lane->mask = UINT32_C(1) << i;
+        if(lanes[i].isPriority)
+        {
+            newInstance->priorityLanes |= lane->mask;
+        }
+        else
+        {
+            newInstance->weightedLanes |= lane->mask;
+        }
+
+        // Shared instances can't call a wakeup function
+        if(!streamBuffer_setWakeup(lane->streamBuffer, markLaneReady, lane))
+        {
+            for(size_t j = 0; j < i; j++)
+            {
+                streamBuffer_setWakeup(newInstance->lanes[j].streamBuffer, NULL, NULL);
+            }
+            return NULL;
+        }
+    }
+
+    // Every lane is looked at once before being left aside
+    atomic_init(&newInstance->readyLanes, newInstance->priorityLanes | newInstance->weightedLanes);
+    if(0 != newInstance->weightedLanes)
+    {
+        newInstance->currentLane = getLowestLane(newInstance->weightedLanes);
+        newInstance->lanes[newInstance->currentLane].deficit = newInstance->lanes[newInstance->currentLane].quantum;
+    }
+    return newInstance;
+}
+
+bool streamBufferScheduler_deinit(streamBufferSchedulerHandle_t *self)
+{
+    // Sanity checks
+    if((NULL == self) || (NULL == *self))
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < (*self)->laneCount; i++)
+    {
+        streamBuffer_setWakeup((*self)->lanes[i].streamBuffer, NULL, NULL);
+    }
+    *self = NULL;
+    return true;
+}
+
+bool streamBufferScheduler_get(streamBufferSchedulerHandle_t self, uint8_t *data, size_t capacity, size_t *size, size_t *laneIndex)
+{
+    uint32_t readyLanes = 0;
+    laneStatus_t status = LANE_STATUS_EMPTY;
+    schedulerLane_t *lane = NULL;
+
+    // Sanity checks
+    if((NULL == self) || (NULL == data) || (NULL == size) || (NULL == laneIndex))
+    {
+        return false;
+    }
+
+    // The strict priority lanes first, the lowest index first
+    readyLanes = atomic_load_explicit(&self->readyLanes, memory_order_acquire) & self->priorityLanes;
+    while(0 != readyLanes)
+    {
+        *laneIndex = getLowestLane(readyLanes);
+        status = readLane(self, *laneIndex, data, capacity, capacity, size);
+        if(LANE_STATUS_EMPTY != status)
+        {
+            return LANE_STATUS_RECORD == status;
+        }
+        readyLanes = atomic_load_explicit(&self->readyLanes, memory_order_acquire) & self->priorityLanes;
+    }
+
+    // Then the deficit round robin: the current lane keeps its turn as long as
+    // its deficit covers its next record, then the next ready lane gets its
+    // quantum for the round
+    readyLanes = atomic_load_explicit(&self->readyLanes, memory_order_acquire) & self->weightedLanes;
+    while(0 != readyLanes)
+    {
+        lane = &self->lanes[self->currentLane];
+        if(0 != (readyLanes & lane->mask))
+        {
+            *laneIndex = self->currentLane;
+            status = readLane(self, self->currentLane, data, capacity, lane->deficit, size);
+            if(LANE_STATUS_RECORD == status)
+            {
+                lane->deficit -= *size;
+                return true;
+            }
+            if(LANE_STATUS_TOO_LARGE == status)
+            {
+                return false;
+            }
+            if(LANE_STATUS_EMPTY == status)
+            {
+                // An idle lane doesn't save up its deficit
+                lane->deficit = 0;
+            }
+            readyLanes = atomic_load_explicit(&self->readyLanes, memory_order_acquire) & self->weightedLanes;
+            if(0 == readyLanes)
+            {
+                break;
+            }
+        }
+
+        self->currentLane = getNextLane(readyLanes, self->currentLane);
+        lane = &self->lanes[self->currentLane];
+        lane->deficit = (uint32_t) MISC_UTILS_MIN((uint64_t) lane->deficit + lane->quantum, (uint64_t) UINT32_MAX);
+    }
+
+    *size = 0;
+    return false;
+}
+
+bool streamBufferScheduler_prepareWait(streamBufferSchedulerHandle_t self)
+{
+    // Sanity checks
+    if(NULL == self)
+    {
+        return false;
+    }
+
+    // Each empty lane was armed before its bit was cleared
+    return 0 == atomic_load_explicit(&self->readyLanes, memory_order_acquire);
+}
+
+/******************************************************************************
+ ************************* Local function definitions *************************
+ *****************************************************************************/
+static laneStatus_t readLane(streamBufferSchedulerHandle_t self, size_t index, uint8_t *data, size_t capacity, size_t budget,
+    size_t *size)
+{
+    schedulerLane_t *lane = &self->lanes[index];
+
+    if(streamBuffer_getBounded(lane->streamBuffer, data, MISC_UTILS_MIN(capacity, budget), size))
+    {
+        return LANE_STATUS_RECORD;
+    }
+    if(0 != *size)
+    {
+        return (*size > capacity) ? LANE_STATUS_TOO_LARGE : LANE_STATUS_OVER_BUDGET;
+    }
+
+    // Clear the bit before arming the wakeup, so the wakeup function of a
+    // record added later sets it again. A record which arrived before the
+    // wakeup was armed is found by streamBuffer_prepareWait instead.
+    atomic_fetch_and_explicit(&self->readyLanes, ~lane->mask, memory_order_relaxed);
+    if(!streamBuffer_prepareWait(lane->streamBuffer))
+    {
+        atomic_fetch_or_explicit(&self->readyLanes, lane->mask, memory_order_relaxed);
+    }
+    return LANE_STATUS_EMPTY;
+}
+
+static size_t getNextLane(uint32_t lanes, size_t index)
+{
+    // The first lane after index, wrapping around to the lowest one
+    uint32_t nextLanes = lanes & ~((UINT32_C(2) << index) - 1);
+
+    return getLowestLane((0 != nextLanes) ? nextLanes : lanes);
+}
+
+static size_t getLowestLane(uint32_t lanes)
+{
+#if defined(__GNUC__)
+    return (size_t) __builtin_ctz(lanes);
+#else
+    size_t index = 0;
+
+    while(0 == (lanes & (UINT32_C(1) << index)))
+    {
+        index++;
+    }
+    return index;
+#endif
+}
+
+static void markLaneReady(void *context)
+{
+    schedulerLane_t *lane = context;
+    streamBufferSchedulerMetadata_t *scheduler = lane->scheduler;
+
+    atomic_fetch_or_explicit(&scheduler->readyLanes, lane->mask, memory_order_release);
+    if(NULL != scheduler->wakeup)
+    {
+        scheduler->wakeup(scheduler->wakeupContext);
+    }
+}
@@ -19,16 +19,36 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 * SOFTWARE.
 *******************************************************************************/
+#include <string.h>
+
 #include "timerManager.h"
 
 /*************************************************************************
  ********************* Local Type/Constant definitions *******************
  ************************************************************************/
+#define TIMER_WHEEL_LEVEL_COUNT     ((32 + TIMER_WHEEL_SLOT_BITS - 1) / TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_COUNT      (1u << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK       (TIMER_WHEEL_SLOT_COUNT - 1u)
+#define TIMER_DUE_LIST_LEVEL        (TIMER_WHEEL_LEVEL_COUNT)   /**< Level tag of the timers waiting in dueTimerList */
+
+_Static_assert((TIMER_WHEEL_SLOT_BITS >= 1) && (TIMER_WHEEL_SLOT_BITS <= 8),
+    "TIMER_WHEEL_SLOT_BITS shall be between 1 and 8");
+
+/**
+ * Timers are kept in a hierarchical timing wheel. Level n holds the timers whose
+ * deadline is less than TIMER_WHEEL_SLOT_COUNT^(n + 1) ticks ahead of wheelTime, in
+ * the slot given by the n-th group of TIMER_WHEEL_SLOT_BITS bits of the deadline. Each slot is an intrusive list: next links to the
+ * following timer and previousNext points to whatever pointer links to this timer,
+ * so that a timer can be unlinked without knowing its slot.
+ */
 typedef struct timer_t
 {
+    struct timer_t *next;
+    struct timer_t **previousNext;
     timerExpired_t callback;
     uint32_t targetTime;
-    uint32_t startTime;
+    uint32_t deadline;
+    uint8_t level;
     bool isStarted;
     bool isPeriodic;
 } timer_t;
@@ -36,7 +56,15 @@ typedef struct timer_t
 /*************************************************************************
  *********************** Local variables declarations ********************
  ************************************************************************/
-static timer_t timerInstancesArray[MAX_TIMER_COUNT] = { {.callback = NULL, .targetTime = 0, .startTime = 0, .isStarted = false, .isPeriodic = false}};
+static timer_t timerInstancesArray[MAX_TIMER_COUNT];
+static timer_t *freeTimerList = NULL;
+static size_t usedTimerCount = 0;
+static timer_t *timerWheel[TIMER_WHEEL_LEVEL_COUNT][TIMER_WHEEL_SLOT_COUNT];
+static uint32_t timerWheelCount[TIMER_WHEEL_LEVEL_COUNT];
+static timer_t *dueTimerList = NULL;
+static uint32_t wheelTime = 0;
+static uint32_t nextDeadline = 0;
+static bool isNextDeadlineValid = false;   /**< nextDeadline is the earliest deadline in timerWheel */
 static volatile uint32_t currentTime = 0;
 static timerLockCb_t requestLock;
 static bool isInitialized = false;
@@ -47,6 +75,15 @@ static bool isInitialized = false;
 static timer_t* getFirstFreeTimer();
 static uint32_t getCurrentTime();
 static void initTimer(timer_t* const timer);
+static void resetWheel();
+static void linkTimer(timer_t * const timer, timer_t ** const list, uint8_t level);
+static void unlinkTimer(timer_t * const timer);
+static void detachList(timer_t ** const list, timer_t ** const detachedList);
+static void scheduleTimer(timer_t * const timer);
+static void cascadeSlot(uint8_t level);
+static void expireTimers(timer_t ** const expiredList, uint32_t time);
+static void skipIdleTicks(uint32_t time);
+static bool findNextDeadline(uint32_t * const deadline);
 
 /*************************************************************************
  *********************** Public function definitions *********************
@@ -60,6 +97,7 @@ bool timerManager_init(timerLockCb_t lockCb)
     }
 
     requestLock = lockCb;
+    resetWheel();
     isInitialized = true;
     return true;
 }
@@ -72,6 +110,7 @@ bool timerManager_uninit()
         return false;
     }
 
+    resetWheel();
     requestLock = NULL;
     isInitialized = false;
     return true;
@@ -80,7 +119,8 @@ bool timerManager_uninit()
 void timerManager_run()
 {
     uint32_t time = 0;
-    uint32_t elapsedTime = 0;
+    timer_t *expiredList = NULL;
+    uint8_t level = 0;
 
     if(!isInitialized)
     {
@@ -88,35 +128,33 @@ void timerManager_run()
     }
 
     time = getCurrentTime();
-    // Iterate through all started timers
-    for(size_t i = 0; i < MAX_TIMER_COUNT; i++)
+
+    // Timers started with a tick count of 0 expire on the first run following their start
+    detachList(&dueTimerList, &expiredList);
+    expireTimers(&expiredList, time);
+
+    // Walk the ticks elapsed since the last call, one level 0 slot per tick
+    while(wheelTime != time)
     {
-        if(timerInstancesArray[i].isStarted)
+        skipIdleTicks(time);
+        if(wheelTime == time)
         {
-            // Calculate the elapsed time
-            if(time < timerInstancesArray[i].startTime)
-            {
-                elapsedTime = time + (UINT32_MAX - timerInstancesArray[i].startTime) + 1;
-            }
-            else
-            {
-                elapsedTime = time - timerInstancesArray[i].startTime;
-            }
+            break;
+        }
 
-            // Check if the timer has expired
-            if(elapsedTime >= timerInstancesArray[i].targetTime)
+        wheelTime++;
+
+        // When a level wraps, redistribute the next slot of the level above (highest level first)
+        for(level = TIMER_WHEEL_LEVEL_COUNT - 1; level > 0; level--)
+        {
+            if(0 == (wheelTime & ((1u << (level * TIMER_WHEEL_SLOT_BITS)) - 1u)))
             {
-                if(timerInstancesArray[i].isPeriodic)
-                {
-                    timerInstancesArray[i].startTime = time;
-                }
-                else
-                {
-                    timerInstancesArray[i].isStarted = false;
-                }
-                (*timerInstancesArray[i].callback)(&timerInstancesArray[i]);
+                cascadeSlot(level);
             }
         }
+
+        detachList(&timerWheel[0][wheelTime & TIMER_WHEEL_SLOT_MASK], &expiredList);
+        expireTimers(&expiredList, time);
     }
 }
 
@@ -138,9 +176,8 @@ timerHandle_t timerManager_createTimer(timerExpired_t callback)
     }
 
     // Initialize the timer
+    initTimer(newTimer);
     newTimer->callback = callback;
-    newTimer->isStarted = false;
-    newTimer->isPeriodic = false;
 
     return (timerHandle_t) newTimer;
 }
@@ -155,9 +192,17 @@ bool timerManager_deleteTimer(timerHandle_t* timer)
         return false;
     }
 
-    // Uninitialize the timer
     timerPointer = (timer_t*) *timer;
+    if(NULL == timerPointer->callback)
+    {
+        return false;
+    }
+
+    // Uninitialize the timer and give it back to the free list
+    unlinkTimer(timerPointer);
     initTimer(timerPointer);
+    timerPointer->next = freeTimerList;
+    freeTimerList = timerPointer;
     *timer = NULL;
     return true;
 }
@@ -173,10 +218,17 @@ bool timerManager_startTimer(timerHandle_t timer, uint32_t tickCount, bool isPer
     }
 
     timerPointer = (timer_t*) timer;
-    timerPointer->startTime = getCurrentTime();
+    if(NULL == timerPointer->callback)
+    {
+        return false;
+    }
+
+    unlinkTimer(timerPointer);
+    timerPointer->deadline = getCurrentTime() + tickCount;
     timerPointer->targetTime = tickCount;
     timerPointer->isStarted = true;
     timerPointer->isPeriodic = isPeriodic;
+    scheduleTimer(timerPointer);
     return true;
 }
 
@@ -191,12 +243,18 @@ bool timerManager_stopTimer(timerHandle_t timer)
     }
 
     timerPointer = (timer_t*) timer;
+    unlinkTimer(timerPointer);
     timerPointer->isStarted = false;
     timerPointer->isPeriodic = false;
     return true;
 }
 
 bool timerManager_incrementTimeBase()
+{
+    return timerManager_advanceTimeBase(1);
+}
+
+bool timerManager_advanceTimeBase(uint32_t tickCount)
 {
     // Sanity check
     if(!isInitialized)
@@ -204,27 +262,68 @@ bool timerManager_incrementTimeBase()
         return false;
     }
 
-    // Increment time
+    // Advance time
     requestLock(true, false);
-    currentTime++;
+    currentTime += tickCount;
     requestLock(false, false);
     return true;
 }
 
+bool timerManager_getNextExpiry(uint32_t *tickCount)
+{
+    uint32_t time = 0;
+    uint32_t deadline = 0;
+
+    // Sanity check
+    if((NULL == tickCount) || !isInitialized)
+    {
+        return false;
+    }
+
+    time = getCurrentTime();
+    if(NULL != dueTimerList)
+    {
+        *tickCount = 0;
+        return true;
+    }
+
+    if(!findNextDeadline(&deadline))
+    {
+        return false;
+    }
+
+    // The deadline may already be reached if timerManager_run is late
+    if((deadline - wheelTime) <= (time - wheelTime))
+    {
+        *tickCount = 0;
+    }
+    else
+    {
+        *tickCount = deadline - time;
+    }
+    return true;
+}
+
 /*************************************************************************
  *********************** Local function definitions **********************
  ************************************************************************/
 static timer_t* getFirstFreeTimer()
 {
-    for(size_t i = 0; i < MAX_TIMER_COUNT; i++)
+    timer_t *timer = NULL;
+
+    // Reuse a deleted timer first, then hand out the ones never used so far
+    if(NULL != freeTimerList)
     {
-        if(NULL == timerInstancesArray[i].callback)
-        {
-            return &timerInstancesArray[i];
-        }
+        timer = freeTimerList;
+        freeTimerList = timer->next;
+    }
+    else if(usedTimerCount < MAX_TIMER_COUNT)
+    {
+        timer = &timerInstancesArray[usedTimerCount];
+        usedTimerCount++;
     }
 
-    return NULL;
+    return timer;
 }
 
 static uint32_t getCurrentTime()
@@ -240,9 +339,237 @@ static uint32_t getCurrentTime()
 
 static void initTimer(timer_t * const timer)
 {
+    timer->next = NULL;
+    timer->previousNext = NULL;
     timer->callback = NULL;
     timer->isPeriodic = false;
     timer->isStarted = false;
-    timer->startTime = 0;
+    timer->deadline = 0;
     timer->targetTime = 0;
+    timer->level = 0;
+}
+
+static void resetWheel()
+{
+    // The started timers are stopped, the free ones are only linked through next
+    for(size_t i = 0; i < usedTimerCount; i++)
+    {
+        if(NULL != timerInstancesArray[i].previousNext)
+        {
+            timerInstancesArray[i].next = NULL;
+            timerInstancesArray[i].previousNext = NULL;
+            timerInstancesArray[i].isStarted = false;
+            timerInstancesArray[i].isPeriodic = false;
+        }
+    }
+
+    memset(timerWheel, 0, sizeof(timerWheel));
+    memset(timerWheelCount, 0, sizeof(timerWheelCount));
+    dueTimerList = NULL;
+    wheelTime = currentTime;
+    isNextDeadlineValid = false;
+}
+
+static void linkTimer(timer_t * const timer, timer_t ** const list, uint8_t level)
+{
+    timer->next = *list;
+    if(NULL != timer->next)
+    {
+        timer->next->previousNext = &timer->next;
+    }
+    timer->previousNext = list;
+    timer->level = level;
+    *list = timer;
+
+    if(level < TIMER_WHEEL_LEVEL_COUNT)
+    {
+        timerWheelCount[level]++;
+    }
+}
+
+static void unlinkTimer(timer_t * const timer)
+{
+    // Not in any list
+    if(NULL == timer->previousNext)
+    {
+        return;
+    }
+
+    *timer->previousNext = timer->next;
+    if(NULL != timer->next)
+    {
+        timer->next->previousNext = timer->previousNext;
+    }
+    timer->next = NULL;
+    timer->previousNext = NULL;
+
+    if(timer->level < TIMER_WHEEL_LEVEL_COUNT)
+    {
+        timerWheelCount[timer->level]--;
+
+        // Another timer may share the deadline, look for it on the next query
+        if(timer->deadline == nextDeadline)
+        {
+            isNextDeadlineValid = false;
+        }
+    }
+}
+
+static void detachList(timer_t ** const list, timer_t ** const detachedList)
+{
+    // Move the whole list so that callbacks can start or stop any timer while it is walked
+    *detachedList = *list;
+    *list = NULL;
+    if(NULL != *detachedList)
+    {
+        (*detachedList)->previousNext = detachedList;
+    }
+}
+
+static void scheduleTimer(timer_t * const timer)
+{
+    uint32_t delta = 0;
+    uint8_t level = 0;
+
+    if(0 == timer->targetTime)
+    {
+        linkTimer(timer, &dueTimerList, TIMER_DUE_LIST_LEVEL);
+        return;
+    }
+
+    // Pick the lowest level able to hold the deadline, then the slot from the matching byte
+    delta = timer->deadline - wheelTime;
+    while((level < (TIMER_WHEEL_LEVEL_COUNT - 1)) && (delta >= (1u << ((level + 1) * TIMER_WHEEL_SLOT_BITS))))
+    {
+        level++;
+    }
+
+    linkTimer(timer, &timerWheel[level][(timer->deadline >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK], level);
+
+    if(isNextDeadlineValid && (delta < (nextDeadline - wheelTime)))
+    {
+        nextDeadline = timer->deadline;
+    }
+}
+
+static void cascadeSlot(uint8_t level)
+{
+    timer_t *cascadedList = NULL;
+    timer_t *timer = NULL;
+
+    // All these deadlines are now less than TIMER_WHEEL_SLOT_COUNT^level ticks ahead and land in a lower level
+    detachList(&timerWheel[level][(wheelTime >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK], &cascadedList);
+    while(NULL != cascadedList)
+    {
+        timer = cascadedList;
+        unlinkTimer(timer);
+        scheduleTimer(timer);
+    }
+}
+
+static void expireTimers(timer_t ** const expiredList, uint32_t time)
+{
+    timer_t *timer = NULL;
+
+    while(NULL != *expiredList)
+    {
+        timer = *expiredList;
+        unlinkTimer(timer);
+
+        if(timer->isPeriodic)
+        {
+            timer->deadline = time + timer->targetTime;
+            scheduleTimer(timer);
+        }
+        else
+        {
+            timer->isStarted = false;
+        }
+        (*timer->callback)(timer);
+    }
+}
+
+static void skipIdleTicks(uint32_t time)
+{
+    uint8_t emptyLevelCount = 0;
+    uint32_t lastIdleTick = 0;
+
+    while((emptyLevelCount < TIMER_WHEEL_LEVEL_COUNT) && (0 == timerWheelCount[emptyLevelCount]))
+    {
+        emptyLevelCount++;
+    }
+
+    if(0 == emptyLevelCount)
+    {
+        return;
+    }
+
+    if(TIMER_WHEEL_LEVEL_COUNT == emptyLevelCount)
+    {
+        wheelTime = time;
+        return;
+    }
+
+    // Nothing can happen before the next cascade of the first non empty level
+    lastIdleTick = wheelTime | ((1u << (emptyLevelCount * TIMER_WHEEL_SLOT_BITS)) - 1u);
+    if((lastIdleTick - wheelTime) >= (time - wheelTime))
+    {
+        wheelTime = time;
+    }
+    else
+    {
+        wheelTime = lastIdleTick;
+    }
+}
+
+static bool findNextDeadline(uint32_t * const deadline)
+{
+    uint32_t delta = 0;
+    uint32_t slot = 0;
+    uint8_t level = 0;
+    timer_t *timer = NULL;
+    bool isFound = false;
+
+    if(isNextDeadlineValid)
+    {
+        *deadline = nextDeadline;
+        return true;
+    }
+
+    // A timer placed in a higher level can expire before one placed later in a lower level, so the
+    // first non empty slot of each level is searched. The slot of wheelTime comes last as it holds
+    // deadlines a full turn ahead.
+    for(level = 0; level < TIMER_WHEEL_LEVEL_COUNT; level++)
+    {
+        if(0 == timerWheelCount[level])
+        {
+            continue;
+        }
+
+        for(uint32_t i = 1; i <= TIMER_WHEEL_SLOT_COUNT; i++)
+        {
+            slot = ((wheelTime >> (level * TIMER_WHEEL_SLOT_BITS)) + i) & TIMER_WHEEL_SLOT_MASK;
+            if(NULL != timerWheel[level][slot])
+            {
+                break;
+            }
+        }
+
+        for(timer = timerWheel[level][slot]; NULL != timer; timer = timer->next)
+        {
+            if(!isFound || ((timer->deadline - wheelTime) < delta))
+            {
+                delta = timer->deadline - wheelTime;
+                isFound = true;
+            }
+        }
+    }
+
+    if(isFound)
+    {
+        nextDeadline = wheelTime + delta;
+        isNextDeadlineValid = true;
+        *deadline = nextDeadline;
+    }
+    return isFound;
 }
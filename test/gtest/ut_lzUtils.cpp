@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "lzUtils.h"
+
+static std::vector<uint8_t> roundTrip(const std::vector<uint8_t> &input, size_t *compressedSize)
+{
+    std::vector<uint8_t> compressed(input.size() + input.size() / 255 + 16);
+    std::vector<uint8_t> output(input.size());
+    size_t outputSize = 0;
+
+    EXPECT_TRUE(lzUtils_compress(input.data(), input.size(), compressed.data(), compressed.size(), compressedSize));
+    EXPECT_TRUE(lzUtils_decompress(compressed.data(), *compressedSize, output.data(), output.size(), &outputSize));
+    output.resize(outputSize);
+    return output;
+}
+
+TEST(LzUtilsTest, InvalidParameters)
+{
+    uint8_t data[16] = { 0 };
+    uint8_t output[16] = { 0 };
+    size_t outputSize = 0;
+    std::vector<uint8_t> tooLarge(LZ_UTILS_MAX_INPUT_SIZE + 1);
+    std::vector<uint8_t> largeOutput(2 * tooLarge.size());
+
+    EXPECT_FALSE(lzUtils_compress(NULL, sizeof(data), output, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_compress(data, sizeof(data), NULL, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_compress(data, sizeof(data), output, sizeof(output), NULL));
+    EXPECT_FALSE(lzUtils_compress(tooLarge.data(), tooLarge.size(), largeOutput.data(), largeOutput.size(), &outputSize));
+    EXPECT_FALSE(lzUtils_decompress(NULL, sizeof(data), output, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_decompress(data, 0, output, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_decompress(data, sizeof(data), NULL, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_decompress(data, sizeof(data), output, sizeof(output), NULL));
+}
+
+TEST(LzUtilsTest, RepetitiveTextShrinks)
+{
+    std::string text;
+    size_t compressedSize = 0;
+
+    for(int i = 0; i < 40; i++)
+    {
+        text += "{\"sensor\":\"temperature\",\"unit\":\"C\",\"value\":" + std::to_string(20 + i % 7) + "},";
+    }
+    std::vector<uint8_t> input(text.begin(), text.end());
+
+    EXPECT_EQ(input, roundTrip(input, &compressedSize));
+    EXPECT_LT(compressedSize * 5, input.size());
+}
+
+TEST(LzUtilsTest, LongRunsAndLiterals)
+{
+    std::vector<uint8_t> input(1000, 'a');
+    std::mt19937 generator(42);
+    size_t compressedSize = 0;
+
+    // A single byte run is an overlapping match, then 600 incompressible
+    // bytes need several length extension bytes
+    for(int i = 0; i < 600; i++)
+    {
+        input.push_back((uint8_t) generator());
+    }
+    EXPECT_EQ(input, roundTrip(input, &compressedSize));
+
+    for(size_t size : { 1, 3, 4, 5, 15, 16, 19, 270, 271 })
+    {
+        std::vector<uint8_t> small(input.end() - size, input.end());
+        EXPECT_EQ(small, roundTrip(small, &compressedSize)) << size << " bytes.\n";
+    }
+}
+
+TEST(LzUtilsTest, OutputTooSmall)
+{
+    std::vector<uint8_t> input(256);
+    std::vector<uint8_t> output(256);
+    size_t compressedSize = 0;
+    size_t outputSize = 0;
+
+    for(size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = (uint8_t) (i * 7);
+    }
+    EXPECT_FALSE(lzUtils_compress(input.data(), input.size(), output.data(), input.size(), &compressedSize))
+        << "Incompressible data is larger once compressed.\n";
+
+    std::fill(input.begin(), input.end(), 'x');
+    ASSERT_TRUE(lzUtils_compress(input.data(), input.size(), output.data(), output.size(), &compressedSize));
+    EXPECT_FALSE(lzUtils_compress(input.data(), input.size(), output.data(), compressedSize - 1, &compressedSize));
+    ASSERT_TRUE(lzUtils_compress(input.data(), input.size(), output.data(), output.size(), &compressedSize));
+    EXPECT_FALSE(lzUtils_decompress(output.data(), compressedSize, input.data(), input.size() - 1, &outputSize));
+}
+
+TEST(LzUtilsTest, MalformedData)
+{
+    const uint8_t offsetBeforeStart[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+    const uint8_t truncatedLiterals[] = { 0x30, 'a', 'b' };
+    const uint8_t endsWithMatch[] = { 0x10, 'a', 0x01, 0x00 };
+    const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+    uint8_t output[64] = { 0 };
+    size_t outputSize = 0;
+
+    EXPECT_FALSE(lzUtils_decompress(offsetBeforeStart, sizeof(offsetBeforeStart), output, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_decompress(truncatedLiterals, sizeof(truncatedLiterals), output, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_decompress(endsWithMatch, sizeof(endsWithMatch), output, sizeof(output), &outputSize));
+    EXPECT_FALSE(lzUtils_decompress(zeroOffset, sizeof(zeroOffset), output, sizeof(output), &outputSize));
+}
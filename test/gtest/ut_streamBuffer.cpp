@@ -0,0 +1,2279 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "streamBuffer.h"
+
+constexpr size_t BUFFER_SIZE = 64;
+constexpr size_t PREFIX_SIZE = 2;
+
+class StreamBufferTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        streamBuffer = streamBuffer_createStatic(bufferArray, BUFFER_SIZE);
+        ASSERT_TRUE(NULL != streamBuffer);
+    }
+
+    void TearDown() override
+    {
+        streamBuffer_freeStatic(&streamBuffer);
+    }
+
+    alignas(8) uint8_t bufferArray[BUFFER_SIZE] = { 0 };
+    streamBufferHandle_t streamBuffer = NULL;
+};
+
+TEST_F(StreamBufferTest, CreateStaticInvalidParameters)
+{
+    uint8_t otherArray[BUFFER_SIZE] = { 0 };
+
+    EXPECT_TRUE(NULL == streamBuffer_createStatic(NULL, BUFFER_SIZE));
+    EXPECT_TRUE(NULL == streamBuffer_createStatic(otherArray, 0));
+    EXPECT_TRUE(NULL == streamBuffer_createStatic(otherArray, BUFFER_SIZE - 1));
+}
+
+TEST_F(StreamBufferTest, CreateStaticTooMuch)
+{
+    uint8_t otherArrays[STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT][BUFFER_SIZE] = { 0 };
+    std::vector<streamBufferHandle_t> instances;
+
+    // One instance is already used by the fixture
+    for(size_t i = 1; i < STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT; i++)
+    {
+        instances.push_back(streamBuffer_createStatic(otherArrays[i], BUFFER_SIZE));
+        EXPECT_TRUE(NULL != instances.back());
+    }
+    EXPECT_TRUE(NULL == streamBuffer_createStatic(otherArrays[0], BUFFER_SIZE));
+
+    // Freeing an instance makes it available again
+    ASSERT_TRUE(streamBuffer_freeStatic(&instances.back()));
+    EXPECT_TRUE(NULL == instances.back());
+    instances.back() = streamBuffer_createStatic(otherArrays[0], BUFFER_SIZE);
+    EXPECT_TRUE(NULL != instances.back());
+
+    for(auto &instance : instances)
+    {
+        streamBuffer_freeStatic(&instance);
+    }
+}
+
+TEST_F(StreamBufferTest, FreeStaticNullPointer)
+{
+    streamBufferHandle_t nullHandle = NULL;
+
+    EXPECT_FALSE(streamBuffer_freeStatic(NULL));
+    EXPECT_FALSE(streamBuffer_freeStatic(&nullHandle));
+}
+
+TEST_F(StreamBufferTest, FreeStaticTwice)
+{
+    streamBufferHandle_t copy = streamBuffer;
+
+    EXPECT_TRUE(streamBuffer_freeStatic(&streamBuffer));
+    EXPECT_FALSE(streamBuffer_freeStatic(&copy));
+}
+
+TEST_F(StreamBufferTest, InitStaticInvalidParameters)
+{
+    streamBufferStatic_t storage;
+    uint8_t otherArray[BUFFER_SIZE] = { 0 };
+
+    EXPECT_TRUE(NULL == streamBuffer_initStatic(NULL, otherArray, BUFFER_SIZE));
+    EXPECT_TRUE(NULL == streamBuffer_initStatic(&storage, NULL, BUFFER_SIZE));
+    EXPECT_TRUE(NULL == streamBuffer_initStatic(&storage, otherArray, BUFFER_SIZE - 1));
+}
+
+TEST_F(StreamBufferTest, InitStaticManyInstances)
+{
+    constexpr size_t instanceCount = 10 * STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT;
+    std::vector<streamBufferStatic_t> storages(instanceCount);
+    std::vector<std::vector<uint8_t>> arrays(instanceCount, std::vector<uint8_t>(BUFFER_SIZE));
+    std::vector<streamBufferHandle_t> instances(instanceCount, NULL);
+    uint8_t data[4] = { 0 };
+    uint16_t size = 0;
+
+    for(size_t i = 0; i < instanceCount; i++)
+    {
+        instances[i] = streamBuffer_initStatic(&storages[i], arrays[i].data(), BUFFER_SIZE);
+        ASSERT_TRUE(NULL != instances[i]);
+        memset(data, (int) i, sizeof(data));
+        EXPECT_TRUE(streamBuffer_put(instances[i], data, sizeof(data)));
+    }
+
+    for(size_t i = 0; i < instanceCount; i++)
+    {
+        EXPECT_TRUE(streamBuffer_get(instances[i], data, &size));
+        EXPECT_EQ(sizeof(data), size);
+        EXPECT_EQ(i, data[0]);
+        EXPECT_TRUE(streamBuffer_freeStatic(&instances[i]));
+        EXPECT_TRUE(NULL == instances[i]);
+    }
+
+    // The pool isn't affected by the instances with a caller provided storage
+    EXPECT_TRUE(streamBuffer_freeStatic(&streamBuffer));
+    for(size_t i = 0; i < STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT; i++)
+    {
+        instances[i] = streamBuffer_createStatic(arrays[i].data(), BUFFER_SIZE);
+        EXPECT_TRUE(NULL != instances[i]);
+    }
+    for(size_t i = 0; i < STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT; i++)
+    {
+        streamBuffer_freeStatic(&instances[i]);
+    }
+}
+
+TEST_F(StreamBufferTest, PutGetNullPointer)
+{
+    uint8_t data[4] = { 0 };
+    uint16_t size = 0;
+
+    EXPECT_FALSE(streamBuffer_put(NULL, data, sizeof(data)));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, NULL, sizeof(data)));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 0));
+    EXPECT_FALSE(streamBuffer_get(NULL, data, &size));
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, NULL, &size));
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, data, NULL));
+}
+
+TEST_F(StreamBufferTest, PutGet)
+{
+    const uint8_t inputData[] = { 1, 2, 3, 4, 5 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    size_t usedSpace = 0;
+
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, sizeof(inputData)));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(PREFIX_SIZE + sizeof(inputData), usedSpace);
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+    EXPECT_EQ(sizeof(inputData), size);
+    EXPECT_EQ(0, memcmp(inputData, outputData, sizeof(inputData)));
+
+    // The queue is now empty
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, outputData, &size));
+    EXPECT_EQ(0, size);
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(0, usedSpace);
+}
+
+TEST_F(StreamBufferTest, PutUsesFullCapacity)
+{
+    uint8_t inputData[BUFFER_SIZE - PREFIX_SIZE] = { 0 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    size_t usedSpace = 0;
+
+    for(size_t i = 0; i < sizeof(inputData); i++)
+    {
+        inputData[i] = (uint8_t) i;
+    }
+
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, inputData, sizeof(inputData) + 1));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, sizeof(inputData)));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(BUFFER_SIZE, usedSpace);
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, inputData, 1));
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+    EXPECT_EQ(sizeof(inputData), size);
+    EXPECT_EQ(0, memcmp(inputData, outputData, sizeof(inputData)));
+}
+
+TEST_F(StreamBufferTest, PutGetWrapAround)
+{
+    uint8_t inputData[23] = { 0 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    // Push enough records for the prefixes and the payloads to cross the end
+    // of the buffer at every possible offset
+    for(size_t i = 0; i < 10 * BUFFER_SIZE; i++)
+    {
+        memset(inputData, (int) i, sizeof(inputData));
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, sizeof(inputData)));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+        ASSERT_EQ(sizeof(inputData), size);
+        ASSERT_EQ(0, memcmp(inputData, outputData, sizeof(inputData)));
+    }
+}
+
+TEST_F(StreamBufferTest, Empty)
+{
+    const uint8_t inputData[] = { 1, 2, 3 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    size_t usedSpace = 0;
+
+    EXPECT_FALSE(streamBuffer_empty(NULL));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, sizeof(inputData)));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, sizeof(inputData)));
+    EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(0, usedSpace);
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, outputData, &size));
+}
+
+TEST_F(StreamBufferTest, SpaceNullPointer)
+{
+    size_t usedSpace = 0;
+
+    EXPECT_FALSE(streamBuffer_space(NULL, &usedSpace));
+    EXPECT_FALSE(streamBuffer_space(streamBuffer, NULL));
+}
+
+TEST_F(StreamBufferTest, SingleProducerSingleConsumer)
+{
+    constexpr uint32_t recordCount = 100000;
+    bool isSequenceValid = true;
+
+    std::thread producer([this]()
+    {
+        uint8_t record[8] = { 0 };
+
+        for(uint32_t i = 0; i < recordCount; i++)
+        {
+            memcpy(record, &i, sizeof(i));
+            memcpy(&record[sizeof(i)], &i, sizeof(i));
+            while(!streamBuffer_put(streamBuffer, record, 1 + (i % sizeof(record))))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    for(uint32_t i = 0; i < recordCount; i++)
+    {
+        while(!streamBuffer_get(streamBuffer, record, &size))
+        {
+            std::this_thread::yield();
+        }
+
+        uint8_t expected[8] = { 0 };
+        memcpy(expected, &i, sizeof(i));
+        memcpy(&expected[sizeof(i)], &i, sizeof(i));
+        if((size != 1 + (i % sizeof(expected))) || (0 != memcmp(expected, record, size)))
+        {
+            isSequenceValid = false;
+        }
+    }
+    producer.join();
+
+    EXPECT_TRUE(isSequenceValid);
+}
+
+TEST_F(StreamBufferTest, ReserveCommitInvalidParameters)
+{
+    uint8_t *span = NULL;
+
+    EXPECT_FALSE(streamBuffer_reserve(NULL, 4, &span));
+    EXPECT_FALSE(streamBuffer_reserve(streamBuffer, 4, NULL));
+    EXPECT_FALSE(streamBuffer_reserve(streamBuffer, 0, &span));
+    EXPECT_FALSE(streamBuffer_reserve(streamBuffer, BUFFER_SIZE - PREFIX_SIZE + 1, &span));
+    EXPECT_FALSE(streamBuffer_commit(NULL, 4));
+    EXPECT_FALSE(streamBuffer_commit(streamBuffer, 4)) << "Commit without reservation.\n";
+
+    ASSERT_TRUE(streamBuffer_reserve(streamBuffer, 4, &span));
+    EXPECT_FALSE(streamBuffer_reserve(streamBuffer, 4, &span)) << "Two reservations at once.\n";
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, span, 4)) << "Put during a reservation.\n";
+    EXPECT_FALSE(streamBuffer_commit(streamBuffer, 5)) << "Commit more than reserved.\n";
+    EXPECT_TRUE(streamBuffer_commit(streamBuffer, 4));
+}
+
+TEST_F(StreamBufferTest, ReserveCommit)
+{
+    const uint8_t inputData[] = { 9, 8, 7, 6, 5, 4 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint8_t *span = NULL;
+    uint16_t size = 0;
+
+    ASSERT_TRUE(streamBuffer_reserve(streamBuffer, 16, &span));
+    memcpy(span, inputData, sizeof(inputData));
+
+    // The record isn't visible before the commit
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, outputData, &size));
+    ASSERT_TRUE(streamBuffer_commit(streamBuffer, sizeof(inputData)));
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+    EXPECT_EQ(sizeof(inputData), size);
+    EXPECT_EQ(0, memcmp(inputData, outputData, sizeof(inputData)));
+}
+
+TEST_F(StreamBufferTest, ReserveCancel)
+{
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint8_t *span = NULL;
+    uint16_t size = 0;
+    size_t usedSpace = 0;
+
+    ASSERT_TRUE(streamBuffer_reserve(streamBuffer, 16, &span));
+    EXPECT_TRUE(streamBuffer_commit(streamBuffer, 0));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(0, usedSpace);
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, outputData, &size));
+}
+
+TEST_F(StreamBufferTest, ReserveIsContiguous)
+{
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint8_t *span = NULL;
+    uint16_t size = 0;
+
+    // Mix reserved and regular records so that every possible write offset is
+    // tested, and check that a reserved area never crosses the buffer end
+    for(size_t i = 0; i < 10 * BUFFER_SIZE; i++)
+    {
+        const size_t recordSize = 1 + (i % 13);
+
+        ASSERT_TRUE(streamBuffer_reserve(streamBuffer, recordSize, &span));
+        EXPECT_TRUE((span >= bufferArray) && ((span + recordSize) <= (bufferArray + BUFFER_SIZE)));
+        memset(span, (int) i, recordSize);
+        ASSERT_TRUE(streamBuffer_commit(streamBuffer, recordSize));
+
+        memset(outputData, (int) (i + 1), recordSize);
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, outputData, (uint16_t) (i % 7 + 1)));
+
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+        ASSERT_EQ(recordSize, size);
+        for(size_t j = 0; j < recordSize; j++)
+        {
+            ASSERT_EQ((uint8_t) i, outputData[j]);
+        }
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+        ASSERT_EQ(i % 7 + 1, size);
+        ASSERT_EQ((uint8_t) (i + 1), outputData[0]);
+    }
+}
+
+TEST_F(StreamBufferTest, ReserveLargestAtAnyOffset)
+{
+    const streamBufferFormat_t formats[] = { STREAM_BUFFER_FORMAT_PREFIX16, STREAM_BUFFER_FORMAT_VARINT };
+    streamBufferConfig_t config = { };
+    uint8_t data[2] = { 0 };
+    uint8_t *span = NULL;
+    size_t maxSize = 0;
+    size_t size = 0;
+    bool isLargerRejected = false;
+
+    EXPECT_FALSE(streamBuffer_getMaxReserveSize(NULL, &maxSize));
+    EXPECT_FALSE(streamBuffer_getMaxReserveSize(streamBuffer, NULL));
+
+    // Records of 3 bytes with their prefix move the write index to every offset
+    for(streamBufferFormat_t format : formats)
+    {
+        const uint16_t recordSize = (STREAM_BUFFER_FORMAT_PREFIX16 == format) ? 1 : 2;
+
+        config.format = format;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+        ASSERT_TRUE(streamBuffer_getMaxReserveSize(streamBuffer, &maxSize));
+        for(size_t i = 0; i < BUFFER_SIZE; i++)
+        {
+            ASSERT_TRUE(streamBuffer_reserve(streamBuffer, maxSize, &span)) << "Offset " << i << ".\n";
+            ASSERT_TRUE(streamBuffer_commit(streamBuffer, 0));
+            if(streamBuffer_reserve(streamBuffer, maxSize + 1, &span))
+            {
+                ASSERT_TRUE(streamBuffer_commit(streamBuffer, 0));
+            }
+            else
+            {
+                isLargerRejected = true;
+            }
+            ASSERT_TRUE(streamBuffer_put(streamBuffer, data, recordSize));
+            ASSERT_TRUE(streamBuffer_getBounded(streamBuffer, data, sizeof(data), &size));
+        }
+        EXPECT_TRUE(isLargerRejected) << "The largest size isn't tight.\n";
+    }
+
+    // No reservation at all in these modes
+    config.format = STREAM_BUFFER_FORMAT_FIXED;
+    config.fixedRecordSize = 4;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBuffer_getMaxReserveSize(streamBuffer, &maxSize));
+    config.format = STREAM_BUFFER_FORMAT_PREFIX16;
+    config.isMultiProducer = true;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBuffer_getMaxReserveSize(streamBuffer, &maxSize));
+}
+
+TEST_F(StreamBufferTest, GetBounded)
+{
+    const uint8_t inputData[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t outputData[sizeof(inputData)] = { 0 };
+    size_t size = 0;
+
+    EXPECT_FALSE(streamBuffer_getBounded(NULL, outputData, sizeof(outputData), &size));
+    EXPECT_FALSE(streamBuffer_getBounded(streamBuffer, NULL, sizeof(outputData), &size));
+    EXPECT_FALSE(streamBuffer_getBounded(streamBuffer, outputData, sizeof(outputData), NULL));
+
+    // A record too big for the destination is left in the queue
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, sizeof(inputData)));
+    EXPECT_FALSE(streamBuffer_getBounded(streamBuffer, outputData, sizeof(inputData) - 1, &size));
+    EXPECT_EQ(sizeof(inputData), size);
+    for(auto byte : outputData)
+    {
+        EXPECT_EQ(0, byte) << "Destination written past its capacity.\n";
+    }
+
+    ASSERT_TRUE(streamBuffer_getBounded(streamBuffer, outputData, sizeof(outputData), &size));
+    EXPECT_EQ(sizeof(inputData), size);
+    EXPECT_EQ(0, memcmp(inputData, outputData, sizeof(inputData)));
+}
+
+TEST_F(StreamBufferTest, PeekReleaseInvalidParameters)
+{
+    streamBufferRecord_t record;
+
+    EXPECT_FALSE(streamBuffer_peek(NULL, &record));
+    EXPECT_FALSE(streamBuffer_peek(streamBuffer, NULL));
+    EXPECT_FALSE(streamBuffer_peek(streamBuffer, &record)) << "Peek on an empty buffer.\n";
+    EXPECT_FALSE(streamBuffer_release(NULL));
+    EXPECT_FALSE(streamBuffer_release(streamBuffer)) << "Release without peek.\n";
+}
+
+TEST_F(StreamBufferTest, PeekRelease)
+{
+    uint8_t inputData[BUFFER_SIZE / 2] = { 0 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    streamBufferRecord_t record;
+    size_t usedSpace = 0;
+
+    // Use every offset so that records are split at every possible position
+    for(size_t i = 0; i < 10 * BUFFER_SIZE; i++)
+    {
+        const size_t recordSize = 1 + (i % sizeof(inputData));
+
+        for(size_t j = 0; j < recordSize; j++)
+        {
+            inputData[j] = (uint8_t) (i + j);
+        }
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, (uint16_t) recordSize));
+
+        // Peeking twice returns the same record
+        ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+        ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+        ASSERT_EQ(recordSize, record.size);
+        ASSERT_EQ(recordSize, record.spans[0].size + record.spans[1].size);
+        ASSERT_TRUE((0 == record.spans[1].size) || (bufferArray == record.spans[1].data));
+        memcpy(outputData, record.spans[0].data, record.spans[0].size);
+        memcpy(&outputData[record.spans[0].size], record.spans[1].data, record.spans[1].size);
+        ASSERT_EQ(0, memcmp(inputData, outputData, recordSize));
+
+        ASSERT_TRUE(streamBuffer_release(streamBuffer));
+        ASSERT_FALSE(streamBuffer_release(streamBuffer));
+        ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+        ASSERT_EQ(0, usedSpace);
+    }
+}
+
+TEST(StreamBufferTinyTest, BufferSmallerThanPrefix)
+{
+    streamBufferStatic_t storage;
+    streamBufferConfig_t config = { };
+    uint8_t buffer[4] = { 0 };
+    uint8_t data[4] = { 1, 2, 3, 4 };
+    uint8_t readData[4] = { 0 };
+    streamBufferHandle_t streamBuffer = NULL;
+    uint16_t recordSize = 0;
+    size_t size = 0;
+
+    // Any power of 2 is accepted, no record fits in a buffer not larger than the prefix
+    for(size_t bufferSize = 1; bufferSize <= 2; bufferSize *= 2)
+    {
+        streamBuffer = streamBuffer_initStatic(&storage, buffer, bufferSize);
+        ASSERT_TRUE(NULL != streamBuffer);
+        EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 1));
+        config.format = STREAM_BUFFER_FORMAT_RAW;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+        ASSERT_TRUE(streamBuffer_write(streamBuffer, data, sizeof(data), &size));
+        EXPECT_EQ(bufferSize, size);
+        ASSERT_TRUE(streamBuffer_read(streamBuffer, readData, sizeof(readData), &size));
+        EXPECT_EQ(bufferSize, size);
+        EXPECT_EQ(0, memcmp(data, readData, size));
+        config.format = STREAM_BUFFER_FORMAT_PREFIX16;
+    }
+
+    // With a time to live, the timestamp takes 4 more bytes
+    streamBuffer = streamBuffer_initStatic(&storage, buffer, sizeof(buffer));
+    ASSERT_TRUE(NULL != streamBuffer);
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 4));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 3));
+    config.timeToLive = 10;
+    config.getTime = [](void) -> uint32_t { return 0; };
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &recordSize));
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 1));
+}
+
+TEST_F(StreamBufferTest, PeekReservedRecordIsContiguous)
+{
+    streamBufferRecord_t record;
+    uint8_t *span = NULL;
+
+    for(size_t i = 0; i < 10 * BUFFER_SIZE; i++)
+    {
+        const size_t recordSize = 1 + (i % 29);
+
+        ASSERT_TRUE(streamBuffer_reserve(streamBuffer, recordSize, &span));
+        memset(span, (int) i, recordSize);
+        ASSERT_TRUE(streamBuffer_commit(streamBuffer, recordSize));
+
+        ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+        ASSERT_EQ(recordSize, record.size);
+        ASSERT_EQ(0, record.spans[1].size);
+        ASSERT_EQ(span, record.spans[0].data);
+        ASSERT_TRUE(streamBuffer_release(streamBuffer));
+    }
+}
+
+TEST_F(StreamBufferTest, PutBatchInvalidParameters)
+{
+    const uint8_t data[4] = { 0 };
+    streamBufferSpan_t records[2] = { { data, sizeof(data) }, { NULL, sizeof(data) } };
+    size_t usedSpace = 0;
+
+    EXPECT_FALSE(streamBuffer_putBatch(NULL, records, 1));
+    EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, NULL, 1));
+    EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, records, 0));
+    EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, records, 2));
+    records[1] = { data, 0 };
+    EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, records, 2));
+
+    // Nothing shall be written when a record is invalid
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(0, usedSpace);
+}
+
+TEST_F(StreamBufferTest, PutBatchAllOrNothing)
+{
+    const uint8_t data[18] = { 0 };
+    streamBufferSpan_t records[3] = { { data, sizeof(data) }, { data, sizeof(data) }, { data, sizeof(data) } };
+    size_t usedSpace = 0;
+
+    ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 2));
+    EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, records, 2));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(2 * (PREFIX_SIZE + sizeof(data)), usedSpace);
+    EXPECT_TRUE(streamBuffer_putBatch(streamBuffer, records, 1));
+}
+
+TEST_F(StreamBufferTest, PutBatchGetBatch)
+{
+    uint8_t inputData[BUFFER_SIZE] = { 0 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    streamBufferSpan_t records[3];
+    size_t offsets[4] = { 0 };
+    size_t recordCount = 0;
+    uint16_t size = 0;
+
+    for(size_t i = 0; i < sizeof(inputData); i++)
+    {
+        inputData[i] = (uint8_t) i;
+    }
+
+    // Shift the write position for the batches to wrap at different offsets
+    for(size_t i = 0; i < BUFFER_SIZE; i++)
+    {
+        records[0] = { &inputData[0], 1 + (i % 5) };
+        records[1] = { &inputData[10], 7 };
+        records[2] = { &inputData[20], 3 + (i % 11) };
+        ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 3));
+
+        // Read a single record first, the rest in a batch
+        ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, outputData, sizeof(outputData), offsets, 1, &recordCount));
+        ASSERT_EQ(1, recordCount);
+        ASSERT_EQ(0, offsets[0]);
+        ASSERT_EQ(records[0].size, offsets[1]);
+        ASSERT_EQ(0, memcmp(records[0].data, outputData, records[0].size));
+
+        ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, outputData, sizeof(outputData), offsets, 3, &recordCount));
+        ASSERT_EQ(2, recordCount);
+        ASSERT_EQ(0, offsets[0]);
+        ASSERT_EQ(records[1].size, offsets[1]);
+        ASSERT_EQ(records[1].size + records[2].size, offsets[2]);
+        ASSERT_EQ(0, memcmp(records[1].data, &outputData[offsets[0]], records[1].size));
+        ASSERT_EQ(0, memcmp(records[2].data, &outputData[offsets[1]], records[2].size));
+
+        ASSERT_FALSE(streamBuffer_getBatch(streamBuffer, outputData, sizeof(outputData), offsets, 3, &recordCount));
+        ASSERT_EQ(0, recordCount);
+    }
+
+    // The batch stops at the first record which doesn't fit
+    records[0] = { inputData, 4 };
+    records[1] = { inputData, 8 };
+    ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 2));
+    ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, outputData, 10, offsets, 3, &recordCount));
+    EXPECT_EQ(1, recordCount);
+    EXPECT_EQ(4, offsets[1]);
+    EXPECT_FALSE(streamBuffer_getBatch(streamBuffer, outputData, 4, offsets, 3, &recordCount));
+    EXPECT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+    EXPECT_EQ(8, size);
+}
+
+TEST_F(StreamBufferTest, GetBatchInvalidParameters)
+{
+    uint8_t data[4] = { 0 };
+    size_t offsets[2] = { 0 };
+    size_t recordCount = 0;
+
+    EXPECT_FALSE(streamBuffer_getBatch(NULL, data, sizeof(data), offsets, 1, &recordCount));
+    EXPECT_FALSE(streamBuffer_getBatch(streamBuffer, NULL, sizeof(data), offsets, 1, &recordCount));
+    EXPECT_FALSE(streamBuffer_getBatch(streamBuffer, data, sizeof(data), NULL, 1, &recordCount));
+    EXPECT_FALSE(streamBuffer_getBatch(streamBuffer, data, sizeof(data), offsets, 0, &recordCount));
+    EXPECT_FALSE(streamBuffer_getBatch(streamBuffer, data, sizeof(data), offsets, 1, NULL));
+}
+
+TEST_F(StreamBufferTest, ConfigureInvalidParameters)
+{
+    const uint8_t data[4] = { 0 };
+    streamBufferConfig_t config = { };
+    uint8_t *span = NULL;
+
+    EXPECT_FALSE(streamBuffer_configure(NULL, &config));
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, NULL));
+    config.format = (streamBufferFormat_t) 0x42;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+
+    // The format can't change while records are stored
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    ASSERT_TRUE(streamBuffer_empty(streamBuffer));
+    ASSERT_TRUE(streamBuffer_reserve(streamBuffer, sizeof(data), &span));
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    ASSERT_TRUE(streamBuffer_commit(streamBuffer, 0));
+    EXPECT_TRUE(streamBuffer_configure(streamBuffer, &config));
+}
+
+class StreamBufferVarintTest : public StreamBufferTest
+{
+protected:
+    void SetUp() override
+    {
+        streamBufferConfig_t config = { };
+
+        StreamBufferTest::SetUp();
+        config.format = STREAM_BUFFER_FORMAT_VARINT;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    }
+};
+
+TEST_F(StreamBufferVarintTest, SmallRecordPrefix)
+{
+    const uint8_t data[1] = { 0x5A };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    size_t usedSpace = 0;
+
+    // A 1 byte record only takes 2 bytes in the buffer
+    for(size_t i = 0; i < (BUFFER_SIZE / 2); i++)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    }
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSpace));
+    EXPECT_EQ(BUFFER_SIZE, usedSpace);
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, outputData, &size));
+    EXPECT_EQ(1, size);
+    EXPECT_EQ(0x5A, outputData[0]);
+}
+
+TEST_F(StreamBufferVarintTest, PutGetWrapAround)
+{
+    uint8_t inputData[BUFFER_SIZE] = { 0 };
+    uint8_t outputData[BUFFER_SIZE] = { 0 };
+    size_t size = 0;
+
+    // A record and its 1 byte prefix may fill the whole buffer
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, inputData, BUFFER_SIZE));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, inputData, 0));
+    for(size_t i = 0; i < 10 * BUFFER_SIZE; i++)
+    {
+        const size_t recordSize = 1 + (i % (BUFFER_SIZE - 1));
+
+        memset(inputData, (int) i, recordSize);
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, inputData, recordSize));
+        ASSERT_TRUE(streamBuffer_getBounded(streamBuffer, outputData, sizeof(outputData), &size));
+        ASSERT_EQ(recordSize, size);
+        ASSERT_EQ(0, memcmp(inputData, outputData, recordSize));
+    }
+}
+
+TEST_F(StreamBufferVarintTest, ReserveCommitSmallerThanReserved)
+{
+    uint8_t bigArray[1024] = { 0 };
+    streamBufferStatic_t storage;
+    streamBufferConfig_t config = { };
+    streamBufferRecord_t record;
+    streamBufferHandle_t bigBuffer = NULL;
+    uint8_t *span = NULL;
+
+    bigBuffer = streamBuffer_initStatic(&storage, bigArray, sizeof(bigArray));
+    ASSERT_TRUE(NULL != bigBuffer);
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    ASSERT_TRUE(streamBuffer_configure(bigBuffer, &config));
+
+    // The prefix is sized for 300 bytes but the record only contains 3
+    ASSERT_TRUE(streamBuffer_reserve(bigBuffer, 300, &span));
+    memcpy(span, "abc", 3);
+    ASSERT_TRUE(streamBuffer_commit(bigBuffer, 3));
+
+    ASSERT_TRUE(streamBuffer_peek(bigBuffer, &record));
+    EXPECT_EQ(3, record.size);
+    EXPECT_EQ(span, record.spans[0].data);
+    EXPECT_EQ(0, memcmp("abc", record.spans[0].data, 3));
+    EXPECT_TRUE(streamBuffer_release(bigBuffer));
+    EXPECT_TRUE(streamBuffer_freeStatic(&bigBuffer));
+}
+
+TEST_F(StreamBufferVarintTest, LargeRecords)
+{
+    constexpr size_t bigBufferSize = 1 << 18;
+    constexpr size_t recordSize = 100000;
+    std::vector<uint8_t> bigArray(bigBufferSize);
+    std::vector<uint8_t> inputData(recordSize);
+    std::vector<uint8_t> outputData(recordSize);
+    streamBufferStatic_t storage;
+    streamBufferConfig_t config = { };
+    streamBufferHandle_t bigBuffer = NULL;
+    uint16_t size16 = 0;
+    size_t size = 0;
+
+    for(size_t i = 0; i < recordSize; i++)
+    {
+        inputData[i] = (uint8_t) (i * 7);
+    }
+
+    // Records bigger than 64 KiB are rejected with the 2 bytes prefix
+    bigBuffer = streamBuffer_initStatic(&storage, bigArray.data(), bigBufferSize);
+    ASSERT_TRUE(NULL != bigBuffer);
+    EXPECT_FALSE(streamBuffer_put(bigBuffer, inputData.data(), recordSize));
+
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    ASSERT_TRUE(streamBuffer_configure(bigBuffer, &config));
+    for(size_t i = 0; i < 5; i++)
+    {
+        ASSERT_TRUE(streamBuffer_put(bigBuffer, inputData.data(), recordSize));
+
+        // The legacy get can't report the size of such a record
+        EXPECT_FALSE(streamBuffer_get(bigBuffer, outputData.data(), &size16));
+        EXPECT_FALSE(streamBuffer_getBounded(bigBuffer, outputData.data(), recordSize - 1, &size));
+        EXPECT_EQ(recordSize, size);
+        ASSERT_TRUE(streamBuffer_getBounded(bigBuffer, outputData.data(), recordSize, &size));
+        ASSERT_EQ(recordSize, size);
+        ASSERT_EQ(inputData, outputData);
+    }
+    EXPECT_TRUE(streamBuffer_freeStatic(&bigBuffer));
+}
+
+class StreamBufferMultiProducerTest : public StreamBufferTest
+{
+protected:
+    void SetUp() override
+    {
+        streamBufferConfig_t config = { };
+
+        StreamBufferTest::SetUp();
+        config.isMultiProducer = true;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    }
+};
+
+TEST_F(StreamBufferTest, ConfigureMultiProducerInvalidParameters)
+{
+    alignas(8) uint8_t otherArray[BUFFER_SIZE + 1] = { 0 };
+    streamBufferConfig_t config = { };
+    streamBufferHandle_t misaligned = streamBuffer_createStatic(&otherArray[1], BUFFER_SIZE);
+
+    config.isMultiProducer = true;
+    ASSERT_TRUE(NULL != misaligned);
+    EXPECT_FALSE(streamBuffer_configure(misaligned, &config)) << "The buffer shall be aligned on 4 bytes.\n";
+    EXPECT_TRUE(streamBuffer_freeStatic(&misaligned));
+
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+}
+
+TEST_F(StreamBufferMultiProducerTest, ReserveNotAvailable)
+{
+    uint8_t *span = NULL;
+
+    EXPECT_FALSE(streamBuffer_reserve(streamBuffer, 4, &span));
+}
+
+TEST_F(StreamBufferMultiProducerTest, PutGetWrapAround)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) i;
+    }
+
+    // A record takes at most half of the buffer
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE / 2 - 3));
+    EXPECT_TRUE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE / 2 - 4));
+    EXPECT_TRUE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE / 2 - 4));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 1));
+    for(size_t i = 0; i < 2; i++)
+    {
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        EXPECT_EQ(BUFFER_SIZE / 2 - 4, size);
+        EXPECT_EQ(0, memcmp(data, record, size));
+    }
+
+    // Records never cross the end of the buffer
+    for(size_t i = 0; i < 100; i++)
+    {
+        size_t recordSize = 1 + (i % 27);
+
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, &data[i % 8], recordSize));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_EQ(recordSize, size);
+        EXPECT_EQ(0, memcmp(&data[i % 8], record, size));
+    }
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, record, &size));
+}
+
+TEST_F(StreamBufferMultiProducerTest, LargestRecordAtAnyOffset)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    // Whatever the write position, the largest record fits in the empty buffer
+    for(size_t offset = 0; offset < BUFFER_SIZE; offset += 4)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE / 2 - 4)) << "At offset " << offset << ".\n";
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 1));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    }
+}
+
+TEST_F(StreamBufferMultiProducerTest, LargestBatchAtAnyOffset)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    const streamBufferSpan_t records[] = { { data, 12 }, { data, 12 }, { data, 12 } };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    // Each record takes 16 bytes with its header, a batch is limited to half of the buffer
+    for(size_t offset = 0; offset < BUFFER_SIZE; offset += 4)
+    {
+        EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, records, 3)) << "At offset " << offset << ".\n";
+        ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 2)) << "At offset " << offset << ".\n";
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 1));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    }
+}
+
+TEST_F(StreamBufferMultiProducerTest, PutBatchPeekEmpty)
+{
+    const uint8_t data[6] = { 1, 2, 3, 4, 5, 6 };
+    const streamBufferSpan_t records[] = { { data, 2 }, { &data[2], 4 } };
+    streamBufferRecord_t record;
+    size_t byteCount = 0;
+
+    ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 2));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+    EXPECT_EQ(2U, record.size);
+    EXPECT_EQ(0, memcmp(data, record.spans[0].data, 2));
+    ASSERT_TRUE(streamBuffer_release(streamBuffer));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+    EXPECT_EQ(4U, record.size);
+    EXPECT_EQ(0, memcmp(&data[2], record.spans[0].data, 4));
+
+    EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+    EXPECT_FALSE(streamBuffer_release(streamBuffer));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &byteCount));
+    EXPECT_EQ(0U, byteCount);
+}
+
+TEST_F(StreamBufferMultiProducerTest, MultiProducerSingleConsumer)
+{
+    constexpr uint32_t producerCount = 4;
+    constexpr uint32_t recordCount = 50000;
+    std::vector<std::thread> producers;
+    uint32_t nextSequence[producerCount] = { 0 };
+    bool isSequenceValid = true;
+
+    for(uint32_t id = 0; id < producerCount; id++)
+    {
+        producers.emplace_back([this, id]()
+        {
+            uint32_t record[2] = { id, 0 };
+
+            for(uint32_t i = 0; i < recordCount; i++)
+            {
+                record[1] = i;
+                while(!streamBuffer_put(streamBuffer, (const uint8_t*) record, 5 + (i % 4)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // The records of each producer shall come out in order
+    uint32_t record[BUFFER_SIZE / sizeof(uint32_t)] = { 0 };
+    uint16_t size = 0;
+    for(uint32_t i = 0; i < producerCount * recordCount; i++)
+    {
+        while(!streamBuffer_get(streamBuffer, (uint8_t*) record, &size))
+        {
+            std::this_thread::yield();
+        }
+
+        uint32_t id = record[0] % producerCount;
+        if((id != record[0]) || (size != 5 + (nextSequence[id] % 4)) || ((record[1] & 0xFF) != (nextSequence[id] & 0xFF)))
+        {
+            isSequenceValid = false;
+        }
+        nextSequence[id]++;
+    }
+    for(std::thread &producer : producers)
+    {
+        producer.join();
+    }
+
+    EXPECT_TRUE(isSequenceValid);
+}
+
+static void countWakeup(void *context)
+{
+    (*(uint32_t*) context)++;
+}
+
+TEST_F(StreamBufferTest, PrepareWaitInvalidParameters)
+{
+    uint32_t wakeupCount = 0;
+
+    EXPECT_FALSE(streamBuffer_setWakeup(NULL, countWakeup, &wakeupCount));
+    EXPECT_FALSE(streamBuffer_prepareWait(NULL));
+    EXPECT_FALSE(streamBuffer_prepareWait(streamBuffer)) << "No wakeup function.\n";
+}
+
+TEST_F(StreamBufferTest, WakeupOnlyWhenWaiting)
+{
+    const uint8_t data[4] = { 1, 2, 3, 4 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    uint32_t wakeupCount = 0;
+
+    ASSERT_TRUE(streamBuffer_setWakeup(streamBuffer, countWakeup, &wakeupCount));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_EQ(0U, wakeupCount) << "The consumer isn't waiting.\n";
+    EXPECT_FALSE(streamBuffer_prepareWait(streamBuffer)) << "A record is available.\n";
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_EQ(0U, wakeupCount);
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    EXPECT_TRUE(streamBuffer_prepareWait(streamBuffer));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_EQ(1U, wakeupCount);
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_EQ(1U, wakeupCount) << "Only the first record wakes the consumer up.\n";
+
+    ASSERT_TRUE(streamBuffer_empty(streamBuffer));
+    EXPECT_TRUE(streamBuffer_prepareWait(streamBuffer));
+    ASSERT_TRUE(streamBuffer_setWakeup(streamBuffer, NULL, NULL));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_EQ(1U, wakeupCount);
+}
+
+TEST_F(StreamBufferMultiProducerTest, WakeupOnlyWhenWaiting)
+{
+    const uint8_t data[4] = { 1, 2, 3, 4 };
+    uint32_t wakeupCount = 0;
+
+    ASSERT_TRUE(streamBuffer_setWakeup(streamBuffer, countWakeup, &wakeupCount));
+    EXPECT_TRUE(streamBuffer_prepareWait(streamBuffer));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_EQ(1U, wakeupCount);
+    EXPECT_FALSE(streamBuffer_prepareWait(streamBuffer));
+}
+
+class StreamBufferRawTest : public StreamBufferTest
+{
+protected:
+    void SetUp() override
+    {
+        streamBufferConfig_t config = { };
+
+        StreamBufferTest::SetUp();
+        config.format = STREAM_BUFFER_FORMAT_RAW;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    }
+};
+
+TEST_F(StreamBufferTest, WriteReadNeedRawFormat)
+{
+    const uint8_t data[4] = { 0 };
+    uint8_t bytes[4] = { 0 };
+    size_t size = 0;
+
+    EXPECT_FALSE(streamBuffer_write(streamBuffer, data, sizeof(data), &size));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_FALSE(streamBuffer_read(streamBuffer, bytes, sizeof(bytes), &size));
+}
+
+TEST_F(StreamBufferRawTest, InvalidParameters)
+{
+    uint8_t data[4] = { 0 };
+    size_t size = 0;
+    uint16_t recordSize = 0;
+    uint8_t *span = NULL;
+    streamBufferRecord_t record;
+
+    EXPECT_FALSE(streamBuffer_write(NULL, data, sizeof(data), &size));
+    EXPECT_FALSE(streamBuffer_write(streamBuffer, NULL, sizeof(data), &size));
+    EXPECT_FALSE(streamBuffer_write(streamBuffer, data, sizeof(data), NULL));
+    EXPECT_FALSE(streamBuffer_read(NULL, data, sizeof(data), &size));
+    EXPECT_FALSE(streamBuffer_read(streamBuffer, NULL, sizeof(data), &size));
+    EXPECT_FALSE(streamBuffer_read(streamBuffer, data, sizeof(data), NULL));
+
+    // No record in a byte stream
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_FALSE(streamBuffer_reserve(streamBuffer, sizeof(data), &span));
+    ASSERT_TRUE(streamBuffer_write(streamBuffer, data, sizeof(data), &size));
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, data, &recordSize));
+    EXPECT_FALSE(streamBuffer_peek(streamBuffer, &record));
+}
+
+TEST_F(StreamBufferRawTest, PartialWriteRead)
+{
+    uint8_t data[BUFFER_SIZE + 8] = { 0 };
+    uint8_t bytes[BUFFER_SIZE] = { 0 };
+    size_t size = 0;
+
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) i;
+    }
+
+    // Only the free space is written
+    ASSERT_TRUE(streamBuffer_write(streamBuffer, data, 40, &size));
+    EXPECT_EQ(40U, size);
+    ASSERT_TRUE(streamBuffer_write(streamBuffer, &data[40], 40, &size));
+    EXPECT_EQ(BUFFER_SIZE - 40, size);
+    EXPECT_FALSE(streamBuffer_write(streamBuffer, data, 1, &size));
+    EXPECT_EQ(0U, size);
+
+    // Only the available bytes are read
+    ASSERT_TRUE(streamBuffer_read(streamBuffer, bytes, 10, &size));
+    EXPECT_EQ(10U, size);
+    EXPECT_EQ(0, memcmp(data, bytes, size));
+    ASSERT_TRUE(streamBuffer_read(streamBuffer, bytes, sizeof(bytes), &size));
+    EXPECT_EQ(BUFFER_SIZE - 10, size);
+    EXPECT_EQ(0, memcmp(&data[10], bytes, size));
+    EXPECT_FALSE(streamBuffer_read(streamBuffer, bytes, sizeof(bytes), &size));
+    EXPECT_EQ(0U, size);
+}
+
+TEST_F(StreamBufferRawTest, ByteStreamAcrossThreads)
+{
+    constexpr size_t byteCount = 1000000;
+    bool isStreamValid = true;
+
+    std::thread producer([this]()
+    {
+        uint8_t chunk[23] = { 0 };
+        size_t sentCount = 0;
+
+        while(sentCount < byteCount)
+        {
+            size_t chunkSize = std::min(sizeof(chunk), byteCount - sentCount);
+            size_t writtenSize = 0;
+
+            for(size_t i = 0; i < chunkSize; i++)
+            {
+                chunk[i] = (uint8_t) ((sentCount + i) % 251);
+            }
+            if(!streamBuffer_write(streamBuffer, chunk, chunkSize, &writtenSize))
+            {
+                std::this_thread::yield();
+            }
+            sentCount += writtenSize;
+        }
+    });
+
+    uint8_t bytes[17] = { 0 };
+    size_t receivedCount = 0;
+    while(receivedCount < byteCount)
+    {
+        size_t readSize = 0;
+
+        if(!streamBuffer_read(streamBuffer, bytes, sizeof(bytes), &readSize))
+        {
+            std::this_thread::yield();
+        }
+        for(size_t i = 0; i < readSize; i++)
+        {
+            if(bytes[i] != (uint8_t) ((receivedCount + i) % 251))
+            {
+                isStreamValid = false;
+            }
+        }
+        receivedCount += readSize;
+    }
+    producer.join();
+
+    EXPECT_TRUE(isStreamValid);
+}
+
+TEST_F(StreamBufferTest, PutvInvalidParameters)
+{
+    const uint8_t data[BUFFER_SIZE] = { 0 };
+    const streamBufferSpan_t fragments[] = { { data, 4 }, { NULL, 4 } };
+    const streamBufferSpan_t tooLong[] = { { data, BUFFER_SIZE / 2 }, { data, BUFFER_SIZE / 2 } };
+    uint8_t *span = NULL;
+
+    EXPECT_FALSE(streamBuffer_putv(NULL, fragments, 1));
+    EXPECT_FALSE(streamBuffer_putv(streamBuffer, NULL, 1));
+    EXPECT_FALSE(streamBuffer_putv(streamBuffer, fragments, 0));
+    EXPECT_FALSE(streamBuffer_putv(streamBuffer, fragments, 2));
+    EXPECT_FALSE(streamBuffer_putv(streamBuffer, tooLong, 2));
+
+    ASSERT_TRUE(streamBuffer_reserve(streamBuffer, 4, &span));
+    EXPECT_FALSE(streamBuffer_putv(streamBuffer, fragments, 1)) << "Putv during a reservation.\n";
+    ASSERT_TRUE(streamBuffer_commit(streamBuffer, 0));
+}
+
+TEST_F(StreamBufferTest, PutvWrapAround)
+{
+    const uint8_t header[3] = { 0xA, 0xB, 0xC };
+    uint8_t payload[BUFFER_SIZE] = { 0 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    for(size_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = (uint8_t) i;
+    }
+
+    for(size_t i = 0; i < 100; i++)
+    {
+        const size_t payloadSize = i % 20;
+        const streamBufferSpan_t fragments[] = { { header, sizeof(header) }, { payload, payloadSize } };
+
+        ASSERT_TRUE(streamBuffer_putv(streamBuffer, fragments, 2));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_EQ(sizeof(header) + payloadSize, size);
+        EXPECT_EQ(0, memcmp(header, record, sizeof(header)));
+        EXPECT_EQ(0, memcmp(payload, &record[sizeof(header)], payloadSize));
+    }
+}
+
+TEST_F(StreamBufferMultiProducerTest, Putv)
+{
+    const uint8_t header[3] = { 0xA, 0xB, 0xC };
+    const uint8_t payload[5] = { 1, 2, 3, 4, 5 };
+    const streamBufferSpan_t fragments[] = { { header, sizeof(header) }, { payload, sizeof(payload) } };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    for(size_t i = 0; i < 20; i++)
+    {
+        ASSERT_TRUE(streamBuffer_putv(streamBuffer, fragments, 2));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_EQ(sizeof(header) + sizeof(payload), size);
+        EXPECT_EQ(0, memcmp(header, record, sizeof(header)));
+        EXPECT_EQ(0, memcmp(payload, &record[sizeof(header)], sizeof(payload)));
+    }
+}
+
+class StreamBufferAlignedTest : public StreamBufferTest
+{
+protected:
+    void SetUp() override
+    {
+        streamBufferConfig_t config = { };
+
+        StreamBufferTest::SetUp();
+        config.recordAlignment = ALIGNMENT;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    }
+
+    static constexpr size_t ALIGNMENT = 8;
+};
+
+TEST_F(StreamBufferTest, ConfigureAlignmentInvalidParameters)
+{
+    alignas(8) uint8_t otherArray[BUFFER_SIZE + 4] = { 0 };
+    streamBufferConfig_t config = { };
+    streamBufferHandle_t misaligned = streamBuffer_createStatic(&otherArray[4], BUFFER_SIZE);
+
+    config.recordAlignment = 8;
+    ASSERT_TRUE(NULL != misaligned);
+    EXPECT_FALSE(streamBuffer_configure(misaligned, &config)) << "The buffer shall be aligned as much as the records.\n";
+    EXPECT_TRUE(streamBuffer_freeStatic(&misaligned));
+
+    config.recordAlignment = 12;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.recordAlignment = 128;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.recordAlignment = 64;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config)) << "Not larger than the buffer.\n";
+    config.recordAlignment = 8;
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.format = STREAM_BUFFER_FORMAT_PREFIX16;
+    config.isMultiProducer = true;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+}
+
+TEST_F(StreamBufferAlignedTest, PayloadsAreAligned)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    streamBufferRecord_t record;
+
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) i;
+    }
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE / 2 - ALIGNMENT + 1));
+
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE / 2 - ALIGNMENT));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+    EXPECT_EQ(0U, (uintptr_t) record.spans[0].data % ALIGNMENT);
+    ASSERT_TRUE(streamBuffer_release(streamBuffer));
+
+    for(size_t i = 0; i < 200; i++)
+    {
+        const size_t recordSize = 1 + (i % (BUFFER_SIZE / 2 - ALIGNMENT));
+
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, &data[i % 7], recordSize));
+        ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+        EXPECT_EQ(0U, (uintptr_t) record.spans[0].data % ALIGNMENT);
+        EXPECT_EQ(0U, record.spans[1].size) << "Aligned records are never split.\n";
+        EXPECT_EQ(recordSize, record.size);
+        EXPECT_EQ(0, memcmp(&data[i % 7], record.spans[0].data, record.size));
+        ASSERT_TRUE(streamBuffer_release(streamBuffer));
+    }
+    EXPECT_FALSE(streamBuffer_peek(streamBuffer, &record));
+}
+
+TEST_F(StreamBufferAlignedTest, LargestRecordAtAnyOffset)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    // Whatever the write position, the largest record fits in the empty buffer
+    for(size_t offset = 0; offset < BUFFER_SIZE; offset += ALIGNMENT)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE / 2 - ALIGNMENT)) << "At offset " << offset << ".\n";
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 1));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    }
+}
+
+TEST_F(StreamBufferAlignedTest, LargestBatchAtAnyOffset)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    const streamBufferSpan_t records[] = { { data, 8 }, { data, 8 }, { data, 8 } };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    // Each record takes 16 bytes once aligned, a batch is limited to half of the buffer
+    for(size_t offset = 0; offset < BUFFER_SIZE; offset += ALIGNMENT)
+    {
+        EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, records, 3)) << "At offset " << offset << ".\n";
+        ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 2)) << "At offset " << offset << ".\n";
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 1));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    }
+}
+
+TEST_F(StreamBufferAlignedTest, PutvPutBatchReserve)
+{
+    const uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    const streamBufferSpan_t spans[] = { { data, 3 }, { &data[3], 5 } };
+    const streamBufferSpan_t tooMany[] = { { data, 8 }, { data, 8 }, { data, 8 }, { data, 8 }, { data, 1 } };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint8_t *span = NULL;
+    uint16_t size = 0;
+
+    // Each record of 8 bytes takes 16 bytes once aligned, the buffer can't hold 5 records
+    EXPECT_FALSE(streamBuffer_putBatch(streamBuffer, tooMany, 5));
+    ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, spans, 2));
+    ASSERT_TRUE(streamBuffer_putv(streamBuffer, spans, 2));
+    ASSERT_TRUE(streamBuffer_reserve(streamBuffer, 6, &span));
+    EXPECT_EQ(0U, (uintptr_t) span % ALIGNMENT);
+    memcpy(span, data, 2);
+    ASSERT_TRUE(streamBuffer_commit(streamBuffer, 2));
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    EXPECT_EQ(3U, size);
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    EXPECT_EQ(5U, size);
+    EXPECT_EQ(0, memcmp(&data[3], record, size));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    EXPECT_EQ(8U, size);
+    EXPECT_EQ(0, memcmp(data, record, size));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    EXPECT_EQ(2U, size);
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, record, &size));
+}
+
+class StreamBufferFixedTest : public StreamBufferTest
+{
+protected:
+    void SetUp() override
+    {
+        streamBufferConfig_t config = { };
+
+        StreamBufferTest::SetUp();
+        config.format = STREAM_BUFFER_FORMAT_FIXED;
+        config.fixedRecordSize = RECORD_SIZE;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    }
+
+    static constexpr size_t RECORD_SIZE = 12;
+};
+
+TEST_F(StreamBufferTest, ConfigureFixedInvalidParameters)
+{
+    streamBufferConfig_t config = { };
+
+    config.format = STREAM_BUFFER_FORMAT_FIXED;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.fixedRecordSize = BUFFER_SIZE + 1;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.fixedRecordSize = BUFFER_SIZE;
+    EXPECT_TRUE(streamBuffer_configure(streamBuffer, &config));
+}
+
+TEST_F(StreamBufferFixedTest, PutGetWithoutPrefix)
+{
+    uint8_t data[RECORD_SIZE + 1] = { 0 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint8_t *span = NULL;
+    uint16_t size = 0;
+    size_t byteCount = 0;
+
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, RECORD_SIZE - 1));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, RECORD_SIZE + 1));
+    EXPECT_FALSE(streamBuffer_reserve(streamBuffer, RECORD_SIZE, &span));
+
+    // The whole capacity holds records
+    for(size_t i = 0; i < BUFFER_SIZE / RECORD_SIZE; i++)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, RECORD_SIZE));
+    }
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, RECORD_SIZE));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &byteCount));
+    EXPECT_EQ((BUFFER_SIZE / RECORD_SIZE) * RECORD_SIZE, byteCount);
+    ASSERT_TRUE(streamBuffer_empty(streamBuffer));
+
+    // The records are split across the end of the buffer
+    for(size_t i = 0; i < 100; i++)
+    {
+        memset(data, (int) i, RECORD_SIZE);
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, RECORD_SIZE));
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+        ASSERT_EQ(RECORD_SIZE, size);
+        EXPECT_EQ(0, memcmp(data, record, RECORD_SIZE));
+    }
+}
+
+TEST_F(StreamBufferFixedTest, GetBatchIsAnArray)
+{
+    uint8_t data[RECORD_SIZE] = { 0 };
+    uint8_t records[BUFFER_SIZE] = { 0 };
+    size_t offsets[6] = { 0 };
+    size_t recordCount = 0;
+
+    for(uint8_t i = 0; i < 5; i++)
+    {
+        memset(data, i, RECORD_SIZE);
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, RECORD_SIZE));
+    }
+
+    // Limited by the capacity, then by the available records
+    ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, records, 3 * RECORD_SIZE + 1, offsets, 5, &recordCount));
+    ASSERT_EQ(3U, recordCount);
+    for(size_t i = 0; i <= recordCount; i++)
+    {
+        EXPECT_EQ(i * RECORD_SIZE, offsets[i]);
+    }
+    EXPECT_EQ(0, records[0]);
+    EXPECT_EQ(2, records[3 * RECORD_SIZE - 1]);
+
+    ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, records, sizeof(records), offsets, 5, &recordCount));
+    ASSERT_EQ(2U, recordCount);
+    EXPECT_EQ(3, records[0]);
+    EXPECT_EQ(4, records[2 * RECORD_SIZE - 1]);
+    EXPECT_FALSE(streamBuffer_getBatch(streamBuffer, records, sizeof(records), offsets, 5, &recordCount));
+}
+
+class StreamBufferDynamicTest : public ::testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        streamBuffer_free(&streamBuffer);
+    }
+
+    streamBufferHandle_t streamBuffer = NULL;
+};
+
+TEST_F(StreamBufferTest, CreateInvalidParameters)
+{
+    streamBufferHandle_t dynamic = NULL;
+
+    EXPECT_TRUE(NULL == streamBuffer_create(0, 0));
+    EXPECT_TRUE(NULL == streamBuffer_create(BUFFER_SIZE - 1, 0));
+    EXPECT_TRUE(NULL == streamBuffer_create(BUFFER_SIZE, BUFFER_SIZE / 2));
+    EXPECT_TRUE(NULL == streamBuffer_create(BUFFER_SIZE, BUFFER_SIZE + 1));
+
+    // The static and the dynamic instances aren't freed the same way
+    EXPECT_FALSE(streamBuffer_free(&streamBuffer));
+    EXPECT_FALSE(streamBuffer_resize(streamBuffer, 2 * BUFFER_SIZE));
+    dynamic = streamBuffer_create(BUFFER_SIZE, 0);
+    ASSERT_TRUE(NULL != dynamic);
+    EXPECT_FALSE(streamBuffer_freeStatic(&dynamic));
+    EXPECT_FALSE(streamBuffer_free(NULL));
+    EXPECT_TRUE(streamBuffer_free(&dynamic));
+    EXPECT_TRUE(NULL == dynamic);
+    EXPECT_FALSE(streamBuffer_free(&dynamic));
+}
+
+TEST_F(StreamBufferDynamicTest, ResizeKeepsSplitRecords)
+{
+    const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+    uint8_t readData[sizeof(data)] = { 0 };
+    uint16_t readSize = 0;
+    size_t space = 0;
+
+    streamBuffer = streamBuffer_create(16, 0);
+    ASSERT_TRUE(NULL != streamBuffer);
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 15)) << "No growth on demand without maxBufferSize.\n";
+
+    // The last record is split at the end of the buffer
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 5));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, &data[5], 5));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, &data[9], 5));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 2));
+
+    ASSERT_TRUE(streamBuffer_resize(streamBuffer, 64));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &space));
+    EXPECT_EQ(14U, space);
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_EQ(5U, readSize);
+    EXPECT_EQ(0, memcmp(&data[5], readData, readSize));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_EQ(5U, readSize);
+    EXPECT_EQ(0, memcmp(&data[9], readData, readSize));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_EQ(sizeof(data), readSize);
+    EXPECT_EQ(0, memcmp(data, readData, readSize));
+    EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+}
+
+TEST_F(StreamBufferDynamicTest, ShrinkOnceIdle)
+{
+    const uint8_t data[10] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    const uint8_t largeData[15] = { 0 };
+    uint8_t readData[sizeof(data)] = { 0 };
+    uint16_t readSize = 0;
+    streamBufferRecord_t record;
+
+    streamBuffer = streamBuffer_create(64, 0);
+    ASSERT_TRUE(NULL != streamBuffer);
+    for(size_t i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    }
+    EXPECT_FALSE(streamBuffer_resize(streamBuffer, 32)) << "The records don't fit in the new buffer.\n";
+    EXPECT_FALSE(streamBuffer_resize(streamBuffer, 48));
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+    EXPECT_FALSE(streamBuffer_resize(streamBuffer, 32)) << "Not while a record is peeked.\n";
+    ASSERT_TRUE(streamBuffer_release(streamBuffer));
+
+    ASSERT_TRUE(streamBuffer_resize(streamBuffer, 16));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_EQ(sizeof(data), readSize);
+    EXPECT_EQ(0, memcmp(data, readData, readSize));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, largeData, 15)) << "The maximum record size follows the buffer size.\n";
+    EXPECT_TRUE(streamBuffer_put(streamBuffer, largeData, 14));
+}
+
+TEST_F(StreamBufferDynamicTest, GrowOnDemand)
+{
+    const uint8_t data[5] = { 1, 2, 3, 4, 5 };
+    uint8_t readData[sizeof(data)] = { 0 };
+    uint16_t readSize = 0;
+    size_t recordCount = 0;
+
+    streamBuffer = streamBuffer_create(16, 64);
+    ASSERT_TRUE(NULL != streamBuffer);
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 15)) << "Larger than the current buffer allows.\n";
+
+    // The buffer doubles up to 64 bytes, then the burst is dropped
+    while(streamBuffer_put(streamBuffer, data, sizeof(data)))
+    {
+        recordCount++;
+    }
+    EXPECT_EQ(64 / (PREFIX_SIZE + sizeof(data)), recordCount);
+
+    for(size_t i = 0; i < recordCount; i++)
+    {
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+        ASSERT_EQ(sizeof(data), readSize);
+        EXPECT_EQ(0, memcmp(data, readData, readSize));
+    }
+    EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+    EXPECT_TRUE(streamBuffer_resize(streamBuffer, 16));
+}
+
+TEST_F(StreamBufferDynamicTest, NoGrowthUnderPeekedRecord)
+{
+    const uint8_t data[10] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    uint8_t readData[sizeof(data)] = { 0 };
+    uint16_t readSize = 0;
+    size_t byteCount = 0;
+    streamBufferRecord_t record;
+
+    // The peeked record is split at the end of the buffer
+    streamBuffer = streamBuffer_create(16, 64);
+    ASSERT_TRUE(NULL != streamBuffer);
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 5));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, sizeof(data))) << "The buffer can't move under the peeked record.\n";
+
+    ASSERT_TRUE(streamBuffer_release(streamBuffer));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &byteCount));
+    EXPECT_EQ(0U, byteCount);
+
+    // The growth is back once the record is released
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    for(size_t i = 0; i < 2; i++)
+    {
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+        ASSERT_EQ(sizeof(data), readSize);
+        EXPECT_EQ(0, memcmp(data, readData, readSize));
+    }
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, readData, &readSize));
+}
+
+TEST_F(StreamBufferDynamicTest, ResizeKeepsAlignedPadding)
+{
+    constexpr size_t ALIGNMENT = 8;
+    uint8_t data[10] = { 0 };
+    uint8_t readData[sizeof(data)] = { 0 };
+    uint16_t readSize = 0;
+    streamBufferConfig_t config = { };
+    streamBufferRecord_t record;
+
+    streamBuffer = streamBuffer_create(64, 0);
+    ASSERT_TRUE(NULL != streamBuffer);
+    config.recordAlignment = ALIGNMENT;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+
+    // 16 bytes per record, the fourth one is padded to the start of the buffer
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        data[0] = i;
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    }
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &readSize));
+    data[0] = 3;
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+
+    ASSERT_TRUE(streamBuffer_resize(streamBuffer, 128));
+    for(uint8_t i = 2; i < 5; i++)
+    {
+        if(4 == i)
+        {
+            data[0] = i;
+            ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+        }
+        ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+        EXPECT_EQ(0U, (uintptr_t) record.spans[0].data % ALIGNMENT);
+        ASSERT_EQ(sizeof(data), record.size);
+        EXPECT_EQ(i, record.spans[0].data[0]);
+        ASSERT_TRUE(streamBuffer_release(streamBuffer));
+    }
+    EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+}
+
+class StreamBufferCompressedTest : public StreamBufferDynamicTest
+{
+protected:
+    void SetUp() override
+    {
+        streamBufferConfig_t config = { };
+
+        streamBuffer = streamBuffer_create(SIZE, 0);
+        ASSERT_TRUE(NULL != streamBuffer);
+        config.isCompressed = true;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    }
+
+    // A batch of telemetry samples, as repetitive as JSON usually is
+    static std::string getRecord(size_t index)
+    {
+        std::string record = "{\"id\":" + std::to_string(index) + ",\"samples\":[";
+
+        for(size_t i = 0; i < 6; i++)
+        {
+            record += "{\"sensor\":\"temperature\",\"unit\":\"celsius\",\"value\":" + std::to_string(20 + (index + i) % 3) + "},";
+        }
+        return record + "]}";
+    }
+
+    static constexpr size_t SIZE = 1024;
+};
+
+TEST_F(StreamBufferTest, ConfigureCompressionInvalidParameters)
+{
+    const uint8_t data[4] = { 0 };
+    streamBufferConfig_t config = { };
+    streamBufferRecord_t record;
+
+    config.isCompressed = true;
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.format = STREAM_BUFFER_FORMAT_PREFIX16;
+    config.recordAlignment = 8;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.recordAlignment = 0;
+    config.isMultiProducer = true;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.isMultiProducer = false;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_FALSE(streamBuffer_peek(streamBuffer, &record)) << "The records may be compressed.\n";
+}
+
+TEST_F(StreamBufferTest, TamperedCompressedRecordIsDropped)
+{
+    const uint8_t data[24] = { 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a',
+        'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a' };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    size_t offsets[3] = { 0 };
+    size_t recordCount = 0;
+    size_t readSize = 0;
+    streamBufferConfig_t config = { };
+    size_t headOffset = 0;
+    size_t usedSize = 0;
+
+    config.isCompressed = true;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+
+    // The stored size once decompressed follows the prefix of the first record
+    for(size_t i = 0; i < 2; i++)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 4));
+        ASSERT_TRUE(streamBuffer_space(streamBuffer, &usedSize));
+        bufferArray[headOffset + PREFIX_SIZE + 1]++;
+        headOffset += usedSize;
+        if(0 == i)
+        {
+            EXPECT_FALSE(streamBuffer_getBounded(streamBuffer, readData, sizeof(readData), &readSize));
+            EXPECT_EQ(0U, readSize) << "The record doesn't decompress to its stored size.\n";
+        }
+        else
+        {
+            EXPECT_FALSE(streamBuffer_getBatch(streamBuffer, readData, sizeof(readData), offsets, 2, &recordCount));
+            EXPECT_EQ(0U, recordCount);
+        }
+
+        // The following record isn't blocked by the dropped one
+        ASSERT_TRUE(streamBuffer_getBounded(streamBuffer, readData, sizeof(readData), &readSize));
+        ASSERT_EQ(4U, readSize);
+        EXPECT_EQ(0, memcmp(data, readData, readSize));
+        EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+    }
+}
+
+TEST_F(StreamBufferTest, CompressedRecordTooShortIsDropped)
+{
+    const uint8_t data[4] = { 1, 2, 3, 4 };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    size_t readSize = 0;
+    streamBufferConfig_t config = { };
+
+    config.isCompressed = true;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+
+    // Raw records flagged as compressed, too short to hold the size once decompressed
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 1));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 2));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    bufferArray[0] |= 0x80;
+    bufferArray[PREFIX_SIZE + 1] |= 0x80;
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        EXPECT_FALSE(streamBuffer_getBounded(streamBuffer, readData, sizeof(readData), &readSize));
+        EXPECT_EQ(0U, readSize);
+    }
+    ASSERT_TRUE(streamBuffer_getBounded(streamBuffer, readData, sizeof(readData), &readSize));
+    ASSERT_EQ(sizeof(data), readSize);
+    EXPECT_EQ(0, memcmp(data, readData, readSize));
+}
+
+TEST_F(StreamBufferCompressedTest, EffectiveCapacity)
+{
+    std::vector<uint8_t> readData(SIZE);
+    uint16_t readSize = 0;
+    size_t recordCount = 0;
+    const size_t rawCapacity = SIZE / (PREFIX_SIZE + getRecord(0).size());
+
+    while(streamBuffer_put(streamBuffer, (const uint8_t*) getRecord(recordCount).data(), getRecord(recordCount).size()))
+    {
+        recordCount++;
+    }
+    EXPECT_LE(3 * rawCapacity, recordCount);
+
+    for(size_t i = 0; i < recordCount; i++)
+    {
+        ASSERT_TRUE(streamBuffer_get(streamBuffer, readData.data(), &readSize));
+        EXPECT_EQ(getRecord(i), std::string(readData.begin(), readData.begin() + readSize));
+    }
+    EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+}
+
+TEST_F(StreamBufferCompressedTest, MixedRecords)
+{
+    std::vector<uint8_t> random(100);
+    std::vector<uint8_t> readData(SIZE);
+    size_t offsets[4] = { 0 };
+    size_t recordCount = 0;
+    size_t readSize = 0;
+    streamBufferSpan_t fragment = { (const uint8_t*) "putv", 4 };
+
+    for(size_t i = 0; i < random.size(); i++)
+    {
+        random[i] = (uint8_t) (i * 37 + i / 3);
+    }
+
+    // The incompressible records and the other producer functions store raw records
+    for(size_t lap = 0; lap < 20; lap++)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, (const uint8_t*) getRecord(lap).data(), getRecord(lap).size()));
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, random.data(), random.size()));
+        ASSERT_TRUE(streamBuffer_putv(streamBuffer, &fragment, 1));
+
+        EXPECT_FALSE(streamBuffer_getBounded(streamBuffer, readData.data(), getRecord(lap).size() - 1, &readSize));
+        EXPECT_EQ(getRecord(lap).size(), readSize) << "The size once decompressed.\n";
+        ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, readData.data(), readData.size(), offsets, 3, &recordCount));
+        ASSERT_EQ(3U, recordCount);
+        EXPECT_EQ(getRecord(lap), std::string(readData.begin(), readData.begin() + offsets[1]));
+        EXPECT_EQ(0, memcmp(random.data(), &readData[offsets[1]], random.size()));
+        EXPECT_EQ(4U, offsets[3] - offsets[2]);
+        EXPECT_EQ(0, memcmp("putv", &readData[offsets[2]], 4));
+    }
+    EXPECT_TRUE(streamBuffer_empty(streamBuffer));
+}
+
+TEST_F(StreamBufferTest, GetStatsInvalidParameters)
+{
+    streamBufferStats_t stats;
+
+    EXPECT_FALSE(streamBuffer_getStats(NULL, &stats));
+    EXPECT_FALSE(streamBuffer_getStats(streamBuffer, NULL));
+}
+
+TEST_F(StreamBufferTest, Stats)
+{
+    const uint8_t data[BUFFER_SIZE] = { 0 };
+    const streamBufferSpan_t records[] = { { data, 3 }, { data, 7 } };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    size_t offsets[3] = { 0 };
+    size_t recordCount = 0;
+    streamBufferRecord_t peeked;
+    streamBufferStats_t stats;
+    uint16_t size = 0;
+
+    ASSERT_TRUE(streamBuffer_getStats(streamBuffer, &stats));
+    EXPECT_EQ(0U, stats.putRecordCount);
+    EXPECT_EQ(0U, stats.maxUsedSize);
+
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 20));
+    ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 2));
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, 40));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, record, sizeof(record), offsets, 2, &recordCount));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 5));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &peeked));
+    ASSERT_TRUE(streamBuffer_release(streamBuffer));
+
+    ASSERT_TRUE(streamBuffer_getStats(streamBuffer, &stats));
+    EXPECT_EQ(4U, stats.putRecordCount);
+    EXPECT_EQ(35U, stats.putByteCount);
+    EXPECT_EQ(4U, stats.getRecordCount);
+    EXPECT_EQ(35U, stats.getByteCount);
+    EXPECT_EQ(1U, stats.rejectedPutCount);
+    EXPECT_EQ(20U + 3U + 7U + 3 * PREFIX_SIZE, stats.maxUsedSize) << "Prefixes are part of the used bytes.\n";
+    EXPECT_EQ(20U, stats.largestRecordSize);
+}
+
+TEST_F(StreamBufferMultiProducerTest, Stats)
+{
+    constexpr uint32_t producerCount = 4;
+    constexpr uint32_t recordCount = 20000;
+    std::vector<std::thread> producers;
+    std::atomic<bool> isDone(false);
+    streamBufferStats_t stats;
+
+    for(uint32_t id = 0; id < producerCount; id++)
+    {
+        producers.emplace_back([this, id]()
+        {
+            const uint8_t record[8] = { 0 };
+
+            for(uint32_t i = 0; i < recordCount; i++)
+            {
+                while(!streamBuffer_put(streamBuffer, record, 1 + ((id + i) % 8)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // The counters may be read by any thread while the instance is in use
+    std::thread monitor([this, &isDone]()
+    {
+        streamBufferStats_t snapshot;
+        uint64_t previousCount = 0;
+
+        while(!isDone.load())
+        {
+            ASSERT_TRUE(streamBuffer_getStats(streamBuffer, &snapshot));
+            EXPECT_LE(previousCount, snapshot.getRecordCount);
+            EXPECT_LE(snapshot.maxUsedSize, BUFFER_SIZE);
+            previousCount = snapshot.getRecordCount;
+        }
+    });
+
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    uint64_t byteCount = 0;
+    for(uint32_t i = 0; i < producerCount * recordCount; i++)
+    {
+        while(!streamBuffer_get(streamBuffer, record, &size))
+        {
+            std::this_thread::yield();
+        }
+        byteCount += size;
+    }
+    for(std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    isDone.store(true);
+    monitor.join();
+
+    ASSERT_TRUE(streamBuffer_getStats(streamBuffer, &stats));
+    EXPECT_EQ(producerCount * recordCount, stats.putRecordCount);
+    EXPECT_EQ(stats.putRecordCount, stats.getRecordCount);
+    EXPECT_EQ(byteCount, stats.putByteCount);
+    EXPECT_EQ(byteCount, stats.getByteCount);
+    EXPECT_EQ(8U, stats.largestRecordSize);
+    EXPECT_LE(stats.maxUsedSize, BUFFER_SIZE);
+}
+
+TEST_F(StreamBufferTest, IterInvalidParameters)
+{
+    streamBufferIterator_t iterator;
+    streamBufferRecord_t record;
+    streamBufferConfig_t config = { };
+
+    EXPECT_FALSE(streamBuffer_iterBegin(NULL, &iterator));
+    EXPECT_FALSE(streamBuffer_iterBegin(streamBuffer, NULL));
+    ASSERT_TRUE(streamBuffer_iterBegin(streamBuffer, &iterator));
+    EXPECT_FALSE(streamBuffer_iterNext(NULL, &iterator, &record));
+    EXPECT_FALSE(streamBuffer_iterNext(streamBuffer, NULL, &record));
+    EXPECT_FALSE(streamBuffer_iterNext(streamBuffer, &iterator, NULL));
+    EXPECT_FALSE(streamBuffer_iterNext(streamBuffer, &iterator, &record)) << "The buffer is empty.\n";
+
+    config.format = STREAM_BUFFER_FORMAT_RAW;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBuffer_iterBegin(streamBuffer, &iterator));
+}
+
+TEST_F(StreamBufferTest, IterLeavesRecords)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    streamBufferIterator_t iterator;
+    streamBufferRecord_t record;
+    uint16_t size = 0;
+    size_t count = 0;
+
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) i;
+    }
+
+    // Move the indexes so that the second record is split at the end of the buffer
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 40));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 10));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, &data[10], 20));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, &data[30], 5));
+
+    for(size_t lap = 0; lap < 2; lap++)
+    {
+        const size_t sizes[] = { 10, 20, 5 };
+        const size_t offsets[] = { 0, 10, 30 };
+
+        count = 0;
+        ASSERT_TRUE(streamBuffer_iterBegin(streamBuffer, &iterator));
+        while(streamBuffer_iterNext(streamBuffer, &iterator, &record))
+        {
+            ASSERT_LT(count, 3U);
+            ASSERT_EQ(sizes[count], record.size);
+            ASSERT_EQ(record.size, record.spans[0].size + record.spans[1].size);
+            EXPECT_EQ(0, memcmp(&data[offsets[count]], record.spans[0].data, record.spans[0].size));
+            EXPECT_EQ(0, memcmp(&data[offsets[count] + record.spans[0].size], record.spans[1].data, record.spans[1].size));
+            count++;
+        }
+        EXPECT_EQ(3U, count);
+    }
+
+    // Only the records published before the start are visited
+    ASSERT_TRUE(streamBuffer_iterBegin(streamBuffer, &iterator));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_TRUE(streamBuffer_iterBegin(streamBuffer, &iterator));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 1));
+    count = 0;
+    while(streamBuffer_iterNext(streamBuffer, &iterator, &record))
+    {
+        count++;
+    }
+    EXPECT_EQ(2U, count);
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    EXPECT_EQ(20U, size);
+    EXPECT_EQ(0, memcmp(&data[10], readData, size));
+}
+
+TEST_F(StreamBufferMultiProducerTest, IterSkipsPadding)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    streamBufferIterator_t iterator;
+    streamBufferRecord_t record;
+    uint16_t size = 0;
+    size_t count = 0;
+
+    // The second record doesn't fit at the end of the buffer and is preceded by a padding
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 28));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 4));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 24));
+
+    ASSERT_TRUE(streamBuffer_iterBegin(streamBuffer, &iterator));
+    while(streamBuffer_iterNext(streamBuffer, &iterator, &record))
+    {
+        EXPECT_EQ((0 == count) ? 4U : 24U, record.size);
+        EXPECT_EQ(0U, record.spans[1].size) << "Multi-producer records are never split.\n";
+        count++;
+    }
+    EXPECT_EQ(2U, count);
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    EXPECT_EQ(4U, size);
+}
+
+static uint32_t currentTime = 0;
+
+static uint32_t getCurrentTime(void)
+{
+    return currentTime;
+}
+
+class StreamBufferTimeToLiveTest : public StreamBufferTest
+{
+protected:
+    static constexpr uint32_t TIME_TO_LIVE = 10;
+    static constexpr size_t TIMESTAMP_SIZE = 4;
+
+    void SetUp() override
+    {
+        streamBufferConfig_t config = { };
+
+        StreamBufferTest::SetUp();
+        currentTime = UINT32_MAX - 5;
+        config.timeToLive = TIME_TO_LIVE;
+        config.getTime = getCurrentTime;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    }
+};
+
+TEST_F(StreamBufferTest, ConfigureTimeToLiveInvalidParameters)
+{
+    streamBufferConfig_t config = { };
+    uint64_t count = 0;
+
+    config.timeToLive = 10;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config)) << "A clock is required.\n";
+    config.getTime = getCurrentTime;
+    config.isMultiProducer = true;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.isMultiProducer = false;
+    config.isCompressed = true;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.isCompressed = false;
+    config.recordAlignment = 8;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.recordAlignment = 0;
+    config.format = STREAM_BUFFER_FORMAT_FIXED;
+    config.fixedRecordSize = 4;
+    EXPECT_FALSE(streamBuffer_configure(streamBuffer, &config));
+    config.format = STREAM_BUFFER_FORMAT_VARINT;
+    EXPECT_TRUE(streamBuffer_configure(streamBuffer, &config));
+
+    EXPECT_FALSE(streamBuffer_getExpiredCount(NULL, &count));
+    EXPECT_FALSE(streamBuffer_getExpiredCount(streamBuffer, NULL));
+}
+
+TEST_F(StreamBufferTimeToLiveTest, ExpiredRecordsAreDropped)
+{
+    const uint8_t data[BUFFER_SIZE] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    const streamBufferSpan_t records[] = { { data, 3 }, { &data[3], 5 } };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    uint64_t expiredCount = 0;
+    size_t byteCount = 0;
+    uint16_t size = 0;
+
+    // The timestamp is part of the prefix, the time wraps around in between
+    EXPECT_FALSE(streamBuffer_put(streamBuffer, data, BUFFER_SIZE - PREFIX_SIZE - TIMESTAMP_SIZE + 1));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 8));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &byteCount));
+    EXPECT_EQ(PREFIX_SIZE + TIMESTAMP_SIZE + 8, byteCount);
+    ASSERT_TRUE(streamBuffer_putBatch(streamBuffer, records, 2));
+    currentTime += 4;
+    ASSERT_TRUE(streamBuffer_putv(streamBuffer, records, 2));
+
+    // A record as old as the time to live is still delivered
+    currentTime += TIME_TO_LIVE - 4;
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    EXPECT_EQ(8U, size);
+    ASSERT_TRUE(streamBuffer_getExpiredCount(streamBuffer, &expiredCount));
+    EXPECT_EQ(0U, expiredCount);
+
+    // The batch expires, the putv record is the next one
+    currentTime++;
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_EQ(8U, size);
+    EXPECT_EQ(0, memcmp(data, readData, size));
+    ASSERT_TRUE(streamBuffer_getExpiredCount(streamBuffer, &expiredCount));
+    EXPECT_EQ(2U, expiredCount);
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, readData, &size));
+}
+
+TEST_F(StreamBufferTimeToLiveTest, ConsumerFunctionsSkipExpiredRecords)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    size_t offsets[4] = { 0 };
+    size_t recordCount = 0;
+    uint64_t expiredCount = 0;
+    uint8_t *span = NULL;
+    streamBufferIterator_t iterator;
+    streamBufferRecord_t record;
+
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) i;
+    }
+
+    // Records stamped at commit time and split at the end of the buffer
+    for(size_t lap = 0; lap < 20; lap++)
+    {
+        ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 7 + (lap % 5)));
+        ASSERT_TRUE(streamBuffer_reserve(streamBuffer, 12, &span));
+        memcpy(span, &data[1], 6);
+        currentTime += TIME_TO_LIVE + 1;
+        ASSERT_TRUE(streamBuffer_commit(streamBuffer, 6));
+
+        switch(lap % 3)
+        {
+            case 0:
+                ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+                ASSERT_EQ(6U, record.size);
+                EXPECT_EQ(1U, record.spans[0].data[0]);
+                ASSERT_TRUE(streamBuffer_release(streamBuffer));
+                break;
+
+            case 1:
+                ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, readData, sizeof(readData), offsets, 3, &recordCount));
+                ASSERT_EQ(1U, recordCount);
+                EXPECT_EQ(0, memcmp(&data[1], readData, 6));
+                break;
+
+            default:
+                // The iteration passes over the expired record without dropping it
+                ASSERT_TRUE(streamBuffer_iterBegin(streamBuffer, &iterator));
+                ASSERT_TRUE(streamBuffer_iterNext(streamBuffer, &iterator, &record));
+                EXPECT_EQ(6U, record.size);
+                EXPECT_FALSE(streamBuffer_iterNext(streamBuffer, &iterator, &record));
+                ASSERT_TRUE(streamBuffer_getExpiredCount(streamBuffer, &expiredCount));
+                EXPECT_EQ(lap, expiredCount);
+                ASSERT_TRUE(streamBuffer_getBatch(streamBuffer, readData, sizeof(readData), offsets, 3, &recordCount));
+                ASSERT_EQ(1U, recordCount);
+                break;
+        }
+        currentTime++;
+    }
+
+    ASSERT_TRUE(streamBuffer_getExpiredCount(streamBuffer, &expiredCount));
+    EXPECT_EQ(20U, expiredCount);
+}
+
+TEST_F(StreamBufferTimeToLiveTest, PeekedRecordDoesntExpire)
+{
+    const uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    uint64_t expiredCount = 0;
+    size_t byteCount = 0;
+    uint16_t size = 0;
+    streamBufferIterator_t iterator;
+    streamBufferRecord_t record;
+
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 8));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 4));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+    ASSERT_EQ(8U, record.size);
+
+    // Both records expire while the first one is peeked
+    currentTime += TIME_TO_LIVE + 1;
+    ASSERT_TRUE(streamBuffer_iterBegin(streamBuffer, &iterator));
+    EXPECT_FALSE(streamBuffer_iterNext(streamBuffer, &iterator, &record));
+    ASSERT_TRUE(streamBuffer_peek(streamBuffer, &record));
+    EXPECT_EQ(8U, record.size);
+    EXPECT_EQ(1U, record.spans[0].data[0]);
+
+    // Only the peeked record is removed, the other one is dropped afterwards
+    ASSERT_TRUE(streamBuffer_release(streamBuffer));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &byteCount));
+    EXPECT_EQ(PREFIX_SIZE + TIMESTAMP_SIZE + 4, byteCount);
+    EXPECT_FALSE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &byteCount));
+    EXPECT_EQ(0U, byteCount);
+    ASSERT_TRUE(streamBuffer_getExpiredCount(streamBuffer, &expiredCount));
+    EXPECT_EQ(1U, expiredCount);
+}
+
+TEST_F(StreamBufferTest, PeekReleaseBytes)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    streamBufferRecord_t bytes;
+    streamBufferConfig_t config = { };
+    uint16_t size = 0;
+
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) i;
+    }
+
+    EXPECT_FALSE(streamBuffer_peekBytes(NULL, 0, &bytes));
+    EXPECT_FALSE(streamBuffer_peekBytes(streamBuffer, 0, NULL));
+    EXPECT_FALSE(streamBuffer_peekBytes(streamBuffer, 0, &bytes)) << "The buffer is empty.\n";
+    EXPECT_FALSE(streamBuffer_releaseBytes(NULL, 1));
+    EXPECT_FALSE(streamBuffer_releaseBytes(streamBuffer, 1));
+
+    // The records are given with their prefixes, across the end of the buffer
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 50));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 10));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, &data[10], 20));
+    ASSERT_TRUE(streamBuffer_peekBytes(streamBuffer, 0, &bytes));
+    EXPECT_EQ(2 * PREFIX_SIZE + 30, bytes.size);
+    EXPECT_EQ(BUFFER_SIZE - 52, bytes.spans[0].size);
+    EXPECT_EQ(bytes.size - bytes.spans[0].size, bytes.spans[1].size);
+    ASSERT_TRUE(streamBuffer_peekBytes(streamBuffer, PREFIX_SIZE + 10, &bytes));
+    EXPECT_EQ(PREFIX_SIZE + 20, bytes.size);
+    EXPECT_EQ(0U, bytes.spans[1].size);
+    EXPECT_EQ(0, memcmp(&data[10], &bytes.spans[0].data[PREFIX_SIZE], 20));
+    EXPECT_FALSE(streamBuffer_peekBytes(streamBuffer, 2 * PREFIX_SIZE + 30, &bytes));
+
+    EXPECT_FALSE(streamBuffer_releaseBytes(streamBuffer, 2 * PREFIX_SIZE + 31));
+    ASSERT_TRUE(streamBuffer_releaseBytes(streamBuffer, PREFIX_SIZE + 10));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_EQ(20U, size);
+    EXPECT_EQ(0, memcmp(&data[10], readData, size));
+
+    config.isMultiProducer = true;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 4));
+    EXPECT_FALSE(streamBuffer_peekBytes(streamBuffer, 0, &bytes));
+    EXPECT_FALSE(streamBuffer_releaseBytes(streamBuffer, 1));
+}
+
+TEST_F(StreamBufferTest, PeekBytesSkipsWrapPadding)
+{
+    uint8_t data[BUFFER_SIZE] = { 0 };
+    uint8_t readData[BUFFER_SIZE] = { 0 };
+    const uint8_t firstPrefix[PREFIX_SIZE] = { 0, 10 };
+    const uint8_t secondPrefix[PREFIX_SIZE] = { 0, 20 };
+    streamBufferRecord_t bytes;
+    uint8_t *reserved = NULL;
+    uint16_t size = 0;
+
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) (i + 1);
+    }
+
+    // The reserved record doesn't fit before the end of the buffer, which is padded
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 30));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, readData, &size));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, 10));
+    ASSERT_TRUE(streamBuffer_reserve(streamBuffer, 20, &reserved));
+    memcpy(reserved, &data[10], 20);
+    ASSERT_TRUE(streamBuffer_commit(streamBuffer, 20));
+
+    ASSERT_TRUE(streamBuffer_peekBytes(streamBuffer, 0, &bytes));
+    EXPECT_EQ(BUFFER_SIZE - 32 + PREFIX_SIZE + 20, bytes.size) << "The padding is released with the records.\n";
+    ASSERT_EQ(PREFIX_SIZE + 10, bytes.spans[0].size);
+    EXPECT_EQ(0, memcmp(firstPrefix, bytes.spans[0].data, PREFIX_SIZE));
+    EXPECT_EQ(0, memcmp(data, &bytes.spans[0].data[PREFIX_SIZE], 10));
+    ASSERT_EQ(PREFIX_SIZE + 20, bytes.spans[1].size);
+    EXPECT_EQ(0, memcmp(secondPrefix, bytes.spans[1].data, PREFIX_SIZE));
+    EXPECT_EQ(0, memcmp(&data[10], &bytes.spans[1].data[PREFIX_SIZE], 20));
+
+    // From the padding, only the record after it is given
+    ASSERT_TRUE(streamBuffer_peekBytes(streamBuffer, PREFIX_SIZE + 10, &bytes));
+    EXPECT_EQ(BUFFER_SIZE - 44 + PREFIX_SIZE + 20, bytes.size);
+    EXPECT_EQ(0U, bytes.spans[0].size);
+    EXPECT_EQ(PREFIX_SIZE + 20, bytes.spans[1].size);
+
+    ASSERT_TRUE(streamBuffer_peekBytes(streamBuffer, 0, &bytes));
+    ASSERT_TRUE(streamBuffer_releaseBytes(streamBuffer, bytes.size));
+    EXPECT_FALSE(streamBuffer_peekBytes(streamBuffer, 0, &bytes));
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include "streamBuffer.hpp"
+
+using cToolbox::PeekedRecord;
+using cToolbox::StreamBuffer;
+
+constexpr size_t BUFFER_SIZE = 64;
+
+static_assert(!std::is_copy_constructible_v<StreamBuffer> && std::is_nothrow_move_constructible_v<StreamBuffer>);
+static_assert(!std::is_copy_constructible_v<PeekedRecord> && std::is_nothrow_move_constructible_v<PeekedRecord>);
+
+TEST(StreamBufferCppTest, OwnerFreesTheInstance)
+{
+    alignas(8) uint8_t bufferArray[BUFFER_SIZE] = { 0 };
+    streamBufferHandle_t instances[STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT] = { NULL };
+
+    // The pool would run out if the instances weren't given back
+    for(size_t lap = 0; lap < 2 * STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT; lap++)
+    {
+        StreamBuffer streamBuffer = StreamBuffer::createStatic(bufferArray);
+        ASSERT_TRUE(streamBuffer);
+
+        StreamBuffer other = std::move(streamBuffer);
+        EXPECT_FALSE(streamBuffer);
+        EXPECT_TRUE(other);
+    }
+
+    for(size_t i = 0; i < STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT; i++)
+    {
+        instances[i] = streamBuffer_createStatic(bufferArray, BUFFER_SIZE);
+        EXPECT_TRUE(NULL != instances[i]);
+    }
+    for(size_t i = 0; i < STREAM_BUFFER_MAX_STATIC_INSTANCE_COUNT; i++)
+    {
+        EXPECT_TRUE(streamBuffer_freeStatic(&instances[i]));
+    }
+
+    EXPECT_FALSE(StreamBuffer::createStatic(std::span<uint8_t>(bufferArray, BUFFER_SIZE - 1)));
+    EXPECT_FALSE(StreamBuffer::create(BUFFER_SIZE - 1));
+    EXPECT_TRUE(StreamBuffer::create(BUFFER_SIZE, 2 * BUFFER_SIZE));
+}
+
+TEST(StreamBufferCppTest, PutGet)
+{
+    StreamBuffer streamBuffer = StreamBuffer::create(BUFFER_SIZE);
+    const std::array<uint16_t, 3> values = { 1, 2, 0x1234 };
+    std::array<std::byte, BUFFER_SIZE> data = { };
+    std::array<std::byte, 4> tooSmall = { };
+
+    ASSERT_TRUE(streamBuffer);
+    EXPECT_TRUE(streamBuffer.put(std::span<const uint16_t, 3>(values)));
+    EXPECT_FALSE(streamBuffer.put(std::span<const std::byte>(data.data(), BUFFER_SIZE)));
+    EXPECT_EQ(sizeof(values) + 2, streamBuffer.space());
+
+    EXPECT_FALSE(streamBuffer.get(tooSmall)) << "The record stays in the stream buffer.\n";
+    std::optional<std::span<std::byte>> record = streamBuffer.get(data);
+    ASSERT_TRUE(record);
+    ASSERT_EQ(sizeof(values), record->size());
+    EXPECT_EQ(0, memcmp(values.data(), record->data(), record->size()));
+    EXPECT_FALSE(streamBuffer.get(data));
+}
+
+TEST(StreamBufferCppTest, PeekedRecordIsReleasedByItsGuard)
+{
+    StreamBuffer streamBuffer = StreamBuffer::create(BUFFER_SIZE);
+    std::array<std::byte, 40> data = { };
+
+    for(size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = (std::byte) i;
+    }
+
+    ASSERT_TRUE(streamBuffer.put(data));
+    {
+        PeekedRecord record = streamBuffer.peek();
+        ASSERT_TRUE(record);
+        EXPECT_EQ(data.size(), record.size());
+    }
+    EXPECT_EQ(0U, streamBuffer.space());
+    EXPECT_FALSE(streamBuffer.peek());
+
+    // A record split at the end of the buffer
+    ASSERT_TRUE(streamBuffer.put(std::span<const std::byte>(data.data(), 30)));
+    PeekedRecord record = streamBuffer.peek();
+    ASSERT_TRUE(record);
+    ASSERT_NE(0U, record.spans()[1].size());
+    EXPECT_EQ(30U, record.spans()[0].size() + record.spans()[1].size());
+    EXPECT_EQ(0, memcmp(data.data(), record.spans()[0].data(), record.spans()[0].size()));
+    EXPECT_EQ(0, memcmp(&data[record.spans()[0].size()], record.spans()[1].data(), record.spans()[1].size()));
+
+    PeekedRecord moved = std::move(record);
+    EXPECT_FALSE(record);
+    moved.release();
+    EXPECT_FALSE(moved);
+    EXPECT_EQ(0U, streamBuffer.space());
+}
@@ -0,0 +1,312 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "streamBufferDrain.h"
+#include "miscUtils.h"
+
+constexpr size_t BUFFER_SIZE = 256;
+
+static uint32_t getTime(void)
+{
+    return 0;
+}
+
+class StreamBufferDrainTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char pattern[] = "/tmp/streamBufferDrainXXXXXX";
+        streamBufferConfig_t config = { };
+
+        streamBuffer = streamBuffer_initStatic(&storage, bufferArray, BUFFER_SIZE);
+        ASSERT_TRUE(NULL != streamBuffer);
+        config.format = STREAM_BUFFER_FORMAT_RAW;
+        ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+
+        fd = mkstemp(pattern);
+        ASSERT_LE(0, fd);
+        unlink(pattern);
+    }
+
+    void TearDown() override
+    {
+        close(fd);
+    }
+
+    std::vector<uint8_t> readFile()
+    {
+        std::vector<uint8_t> content(lseek(fd, 0, SEEK_END));
+
+        EXPECT_EQ((ssize_t) content.size(), pread(fd, content.data(), content.size(), 0));
+        return content;
+    }
+
+    void runUntilIdle(streamBufferDrain_t *drain)
+    {
+        size_t drainedSize = 0;
+        bool isIdle = false;
+
+        do
+        {
+            ASSERT_TRUE(streamBufferDrain_run(drain, true, &drainedSize, &isIdle));
+        } while(!isIdle);
+    }
+
+    void drainToSocket(size_t totalSize, bool isNonBlocking, bool isSlowReader)
+    {
+        std::vector<uint8_t> received;
+        streamBufferDrain_t drain;
+        int sockets[2] = { -1, -1 };
+        int sendBufferSize = 4096;
+        size_t drainedSize = 0;
+        size_t sentSize = 0;
+        bool isIdle = false;
+
+        // A small socket buffer and a late receiver keep the sends waiting for room
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        ASSERT_EQ(0, setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &sendBufferSize, sizeof(sendBufferSize)));
+        if(isNonBlocking)
+        {
+            ASSERT_EQ(0, fcntl(sockets[0], F_SETFL, fcntl(sockets[0], F_GETFL) | O_NONBLOCK));
+        }
+        ASSERT_TRUE(streamBufferDrain_init(&drain, streamBuffer, sockets[0], true, 0));
+
+        std::thread receiver([&received, &sockets, isSlowReader]()
+        {
+            uint8_t chunk[1000];
+            size_t readCount = 0;
+            ssize_t size = 0;
+
+            // Let the socket buffer fill up first
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            while(0 < (size = read(sockets[1], chunk, isSlowReader ? 97 : sizeof(chunk))))
+            {
+                received.insert(received.end(), chunk, chunk + size);
+                if(isSlowReader && (0 == (++readCount % 16)))
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+        });
+
+        std::thread producer([this, totalSize]()
+        {
+            uint8_t data[61];
+            size_t writtenSize = 0;
+            size_t position = 0;
+
+            while(position < totalSize)
+            {
+                for(size_t i = 0; i < sizeof(data); i++)
+                {
+                    data[i] = (uint8_t) ((position + i) * 13 + ((position + i) >> 8));
+                }
+                if(streamBuffer_write(streamBuffer, data, MISC_UTILS_MIN(sizeof(data), totalSize - position), &writtenSize))
+                {
+                    position += writtenSize;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        while(sentSize < totalSize)
+        {
+            ASSERT_TRUE(streamBufferDrain_run(&drain, true, &drainedSize, &isIdle));
+            sentSize += drainedSize;
+            if(isIdle || isNonBlocking)
+            {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        EXPECT_TRUE(streamBufferDrain_deinit(&drain));
+        close(sockets[0]);
+        receiver.join();
+        close(sockets[1]);
+
+        ASSERT_EQ(totalSize, received.size());
+        for(size_t i = 0; i < totalSize; i++)
+        {
+            ASSERT_EQ((uint8_t) (i * 13 + (i >> 8)), received[i]) << "At byte " << i << ".\n";
+        }
+    }
+
+    streamBufferStatic_t storage;
+    streamBufferStatic_t largeStorage;
+    std::vector<uint8_t> largeBuffer;
+    alignas(8) uint8_t bufferArray[BUFFER_SIZE] = { 0 };
+    streamBufferHandle_t streamBuffer = NULL;
+    int fd = -1;
+};
+
+TEST_F(StreamBufferDrainTest, InvalidParameters)
+{
+    streamBufferDrain_t drain;
+    size_t drainedSize = 0;
+    bool isIdle = false;
+
+    EXPECT_FALSE(streamBufferDrain_init(NULL, streamBuffer, fd, false, 0));
+    EXPECT_FALSE(streamBufferDrain_init(&drain, NULL, fd, false, 0));
+    EXPECT_FALSE(streamBufferDrain_init(&drain, streamBuffer, -1, false, 0));
+    ASSERT_TRUE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+    EXPECT_FALSE(streamBufferDrain_run(NULL, false, &drainedSize, &isIdle));
+    EXPECT_FALSE(streamBufferDrain_run(&drain, false, NULL, &isIdle));
+    EXPECT_FALSE(streamBufferDrain_run(&drain, false, &drainedSize, NULL));
+    EXPECT_TRUE(streamBufferDrain_deinit(&drain));
+    EXPECT_FALSE(streamBufferDrain_deinit(&drain));
+    EXPECT_FALSE(streamBufferDrain_deinit(NULL));
+}
+
+TEST_F(StreamBufferDrainTest, UnsupportedModes)
+{
+    streamBufferDrain_t drain;
+    streamBufferConfig_t config = { };
+
+    // The bytes of these modes aren't the records back to back
+    config.isMultiProducer = true;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+    config.isMultiProducer = false;
+    config.recordAlignment = 8;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+    config.recordAlignment = 0;
+    config.isCompressed = true;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+    config.isCompressed = false;
+    config.timeToLive = 10;
+    config.getTime = getTime;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    EXPECT_FALSE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+
+    config = { };
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    ASSERT_TRUE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+    EXPECT_TRUE(streamBufferDrain_deinit(&drain));
+}
+
+TEST_F(StreamBufferDrainTest, DrainToFile)
+{
+    std::vector<uint8_t> expected;
+    streamBufferDrain_t drain;
+    size_t drainedSize = 0;
+    size_t writtenSize = 0;
+    size_t totalSize = 0;
+    bool isIdle = false;
+    uint8_t data[100] = { 0 };
+
+    ASSERT_TRUE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 16));
+    EXPECT_TRUE(streamBufferDrain_run(&drain, true, &drainedSize, &isIdle)) << "Nothing to wait for.\n";
+    EXPECT_EQ(0U, drainedSize);
+    EXPECT_TRUE(isIdle);
+
+    // Several writes in flight, some of them split at the end of the buffer
+    expected.resize(16, 0);
+    for(size_t lap = 0; lap < 50; lap++)
+    {
+        for(size_t i = 0; i < sizeof(data); i++)
+        {
+            data[i] = (uint8_t) (lap * 7 + i);
+        }
+        while(streamBuffer_write(streamBuffer, data, 37 + (lap % 60), &writtenSize))
+        {
+            expected.insert(expected.end(), data, data + writtenSize);
+            ASSERT_TRUE(streamBufferDrain_run(&drain, false, &drainedSize, &isIdle));
+            totalSize += drainedSize;
+        }
+    }
+    do
+    {
+        ASSERT_TRUE(streamBufferDrain_run(&drain, true, &drainedSize, &isIdle));
+        totalSize += drainedSize;
+    } while(!isIdle);
+
+    EXPECT_EQ(expected.size() - 16, totalSize);
+    EXPECT_EQ(expected, readFile()) << "The bytes start at the given offset.\n";
+    ASSERT_TRUE(streamBuffer_space(streamBuffer, &writtenSize));
+    EXPECT_EQ(0U, writtenSize);
+    EXPECT_TRUE(streamBufferDrain_deinit(&drain));
+}
+
+TEST_F(StreamBufferDrainTest, DrainRecordsWithPrefixes)
+{
+    streamBufferConfig_t config = { };
+    streamBufferDrain_t drain;
+    const uint8_t expected[] = { 0, 3, 'a', 'b', 'c', 0, 1, 'd' };
+
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    ASSERT_TRUE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, (const uint8_t*) "abc", 3));
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, (const uint8_t*) "d", 1));
+    runUntilIdle(&drain);
+    EXPECT_EQ(std::vector<uint8_t>(expected, expected + sizeof(expected)), readFile());
+    EXPECT_TRUE(streamBufferDrain_deinit(&drain));
+}
+
+TEST_F(StreamBufferDrainTest, DrainRecordsAcrossWrapPadding)
+{
+    streamBufferConfig_t config = { };
+    streamBufferDrain_t drain;
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> content;
+    uint8_t *reserved = NULL;
+    size_t position = 0;
+    size_t length = 0;
+
+    // Reserved records leave the end of the buffer unused when they don't fit.
+    // The ring is filled with stale bytes first, which shall never be written.
+    memset(bufferArray, 0xEE, sizeof(bufferArray));
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    ASSERT_TRUE(streamBufferDrain_init(&drain, streamBuffer, fd, false, 0));
+    for(size_t i = 0; i < 40; i++)
+    {
+        length = 30 + (i * 17) % 70;
+        ASSERT_TRUE(streamBuffer_reserve(streamBuffer, length, &reserved));
+        memset(reserved, (int) i, length);
+        ASSERT_TRUE(streamBuffer_commit(streamBuffer, length));
+        expected.push_back((uint8_t) (length >> 8));
+        expected.push_back((uint8_t) length);
+        expected.insert(expected.end(), length, (uint8_t) i);
+        runUntilIdle(&drain);
+    }
+
+    // The file can be parsed as records
+    content = readFile();
+    EXPECT_EQ(expected, content);
+    while((position + 2) <= content.size())
+    {
+        position += 2 + ((size_t) content[position] << 8) + content[position + 1];
+    }
+    EXPECT_EQ(content.size(), position);
+    EXPECT_TRUE(streamBufferDrain_deinit(&drain));
+}
+
+TEST_F(StreamBufferDrainTest, DrainToSocketInOrder)
+{
+    drainToSocket(1 << 20, false, false);
+}
+
+TEST_F(StreamBufferDrainTest, DrainToSocketWithShortSends)
+{
+    streamBufferConfig_t config = { };
+
+    // Spans larger than the socket buffer, a non blocking socket and a slow
+    // reader make the sends stop short
+    largeBuffer.resize(1 << 16);
+    streamBuffer = streamBuffer_initStatic(&largeStorage, largeBuffer.data(), largeBuffer.size());
+    ASSERT_TRUE(NULL != streamBuffer);
+    config.format = STREAM_BUFFER_FORMAT_RAW;
+    ASSERT_TRUE(streamBuffer_configure(streamBuffer, &config));
+    drainToSocket(1 << 20, true, true);
+}
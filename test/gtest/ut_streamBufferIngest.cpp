@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "streamBufferIngest.h"
+
+constexpr size_t BUFFER_SIZE = 128;
+
+class StreamBufferIngestTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        streamBuffer = streamBuffer_createStatic(bufferArray, BUFFER_SIZE);
+        ASSERT_TRUE(NULL != streamBuffer);
+    }
+
+    void TearDown() override
+    {
+        streamBuffer_freeStatic(&streamBuffer);
+    }
+
+    // Push the bytes in chunks of chunkSize bytes
+    void pushAll(const std::vector<uint8_t> &bytes, size_t chunkSize)
+    {
+        size_t consumedSize = 0;
+
+        for(size_t offset = 0; offset < bytes.size(); offset += chunkSize)
+        {
+            size_t size = std::min(chunkSize, bytes.size() - offset);
+
+            ASSERT_TRUE(streamBufferIngest_push(&ingest, &bytes[offset], size, &consumedSize));
+            ASSERT_EQ(size, consumedSize);
+        }
+    }
+
+    std::vector<std::string> getAll()
+    {
+        std::vector<std::string> records;
+        uint8_t record[BUFFER_SIZE] = { 0 };
+        uint16_t size = 0;
+
+        while(streamBuffer_get(streamBuffer, record, &size))
+        {
+            records.emplace_back((const char*) record, size);
+        }
+        return records;
+    }
+
+    uint8_t bufferArray[BUFFER_SIZE] = { 0 };
+    streamBufferHandle_t streamBuffer = NULL;
+    streamBufferIngest_t ingest;
+};
+
+TEST_F(StreamBufferIngestTest, InvalidParameters)
+{
+    streamBufferIngestRule_t rule = { };
+    const uint8_t data[4] = { 0 };
+    size_t consumedSize = 0;
+
+    rule.prefixSize = 2;
+    rule.maxFrameSize = 16;
+    EXPECT_FALSE(streamBufferIngest_init(NULL, streamBuffer, &rule));
+    EXPECT_FALSE(streamBufferIngest_init(&ingest, NULL, &rule));
+    EXPECT_FALSE(streamBufferIngest_init(&ingest, streamBuffer, NULL));
+    rule.prefixSize = 3;
+    EXPECT_FALSE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    rule.prefixSize = 2;
+    rule.maxFrameSize = 0;
+    EXPECT_FALSE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    rule.maxFrameSize = 16;
+    rule.framing = (streamBufferIngestFraming_t) 0x42;
+    EXPECT_FALSE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+
+    rule.framing = STREAM_BUFFER_INGEST_FRAMING_PREFIX;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    EXPECT_FALSE(streamBufferIngest_push(NULL, data, sizeof(data), &consumedSize));
+    EXPECT_FALSE(streamBufferIngest_push(&ingest, NULL, sizeof(data), &consumedSize));
+    EXPECT_FALSE(streamBufferIngest_push(&ingest, data, sizeof(data), NULL));
+    EXPECT_FALSE(streamBufferIngest_reset(NULL));
+}
+
+TEST_F(StreamBufferIngestTest, FrameLargerThanReservation)
+{
+    std::vector<uint8_t> stream;
+    streamBufferIngestRule_t rule = { };
+    size_t maxSize = 0;
+
+    ASSERT_TRUE(streamBuffer_getMaxReserveSize(streamBuffer, &maxSize));
+    rule.prefixSize = 1;
+    rule.maxFrameSize = maxSize + 1;
+    EXPECT_FALSE(streamBufferIngest_init(&ingest, streamBuffer, &rule)) << "The parsing could stall forever.\n";
+
+    // The largest frame is accepted wherever the stream buffer is
+    rule.maxFrameSize = maxSize;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    for(size_t i = 0; i < BUFFER_SIZE; i++)
+    {
+        stream = { 1, (uint8_t) i };
+        stream.push_back((uint8_t) maxSize);
+        stream.insert(stream.end(), maxSize, (uint8_t) i);
+        pushAll(stream, stream.size());
+        EXPECT_EQ(std::vector<std::string>({ std::string(1, (char) i), std::string(maxSize, (char) i) }), getAll());
+    }
+}
+
+TEST_F(StreamBufferIngestTest, PrefixFramesSplitAnywhere)
+{
+    const std::vector<uint8_t> stream = { 0, 3, 'a', 'b', 'c', 0, 0, 0, 1, 'd', 0, 5, 'e', 'f', 'g', 'h', 'i' };
+    const std::vector<std::string> expected = { "abc", "d", "efghi" };
+    streamBufferIngestRule_t rule = { };
+
+    rule.prefixSize = 2;
+    rule.maxFrameSize = 16;
+    for(size_t chunkSize = 1; chunkSize <= stream.size(); chunkSize++)
+    {
+        ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+        pushAll(stream, chunkSize);
+        EXPECT_EQ(expected, getAll()) << "Chunks of " << chunkSize << " bytes.\n";
+    }
+}
+
+TEST_F(StreamBufferIngestTest, PrefixSizeAndEndianness)
+{
+    streamBufferIngestRule_t rule = { };
+
+    rule.maxFrameSize = 16;
+    rule.prefixSize = 1;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    pushAll({ 2, 'a', 'b' }, 2);
+    EXPECT_EQ(std::vector<std::string>({ "ab" }), getAll());
+
+    rule.prefixSize = 2;
+    rule.isLittleEndian = true;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    pushAll({ 2, 0, 'c', 'd' }, 3);
+    EXPECT_EQ(std::vector<std::string>({ "cd" }), getAll());
+
+    rule.prefixSize = 4;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    pushAll({ 1, 0, 0, 0, 'e' }, 5);
+    EXPECT_EQ(std::vector<std::string>({ "e" }), getAll());
+
+    rule.isLittleEndian = false;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    pushAll({ 0, 0, 0, 1, 'f' }, 1);
+    EXPECT_EQ(std::vector<std::string>({ "f" }), getAll());
+}
+
+TEST_F(StreamBufferIngestTest, DelimiterFrames)
+{
+    const std::string stream = "first\nsecond\n\nthird\nfour";
+    streamBufferIngestRule_t rule = { };
+
+    rule.framing = STREAM_BUFFER_INGEST_FRAMING_DELIMITER;
+    rule.delimiter = '\n';
+    rule.maxFrameSize = 16;
+    for(size_t chunkSize = 1; chunkSize <= stream.size(); chunkSize++)
+    {
+        ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+        pushAll(std::vector<uint8_t>(stream.begin(), stream.end()), chunkSize);
+        EXPECT_EQ(std::vector<std::string>({ "first", "second", "third" }), getAll()) << "Chunks of " << chunkSize << " bytes.\n";
+        EXPECT_TRUE(streamBufferIngest_reset(&ingest));
+    }
+}
+
+TEST_F(StreamBufferIngestTest, FrameTooLong)
+{
+    const uint8_t prefixed[] = { 0, 17 };
+    const uint8_t delimited[] = "0123456789abcdefg\nok\n";
+    streamBufferIngestRule_t rule = { };
+    size_t consumedSize = 0;
+
+    rule.prefixSize = 2;
+    rule.maxFrameSize = 16;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    EXPECT_FALSE(streamBufferIngest_push(&ingest, prefixed, sizeof(prefixed), &consumedSize));
+
+    rule.framing = STREAM_BUFFER_INGEST_FRAMING_DELIMITER;
+    rule.delimiter = '\n';
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    EXPECT_FALSE(streamBufferIngest_push(&ingest, delimited, sizeof(delimited) - 1, &consumedSize));
+    EXPECT_EQ(0U, consumedSize);
+    EXPECT_TRUE(getAll().empty());
+
+    // The stream buffer stays usable
+    ASSERT_TRUE(streamBufferIngest_reset(&ingest));
+    ASSERT_TRUE(streamBufferIngest_push(&ingest, &delimited[18], 3, &consumedSize));
+    EXPECT_EQ(std::vector<std::string>({ "ok" }), getAll());
+}
+
+TEST_F(StreamBufferIngestTest, StopsWhenFull)
+{
+    std::vector<uint8_t> stream;
+    streamBufferIngestRule_t rule = { };
+    size_t consumedSize = 0;
+    size_t offset = 0;
+    size_t recordCount = 0;
+
+    for(uint8_t i = 0; i < 20; i++)
+    {
+        stream.push_back(20);
+        stream.insert(stream.end(), 20, i);
+    }
+
+    rule.prefixSize = 1;
+    rule.maxFrameSize = 32;
+    ASSERT_TRUE(streamBufferIngest_init(&ingest, streamBuffer, &rule));
+    while(offset < stream.size())
+    {
+        ASSERT_TRUE(streamBufferIngest_push(&ingest, &stream[offset], stream.size() - offset, &consumedSize));
+        ASSERT_LT(0U, consumedSize) << "No progress.\n";
+        offset += consumedSize;
+
+        for(const std::string &record : getAll())
+        {
+            EXPECT_EQ(std::string(20, (char) recordCount), record);
+            recordCount++;
+        }
+    }
+    EXPECT_EQ(20U, recordCount);
+}
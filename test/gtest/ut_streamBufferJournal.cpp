@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <csignal>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "streamBufferJournal.h"
+
+constexpr size_t SEGMENT_SIZE = 64;
+constexpr const char *JOURNAL_NAME = "journal";
+
+class StreamBufferJournalTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char pattern[] = "/tmp/streamBufferJournalXXXXXX";
+
+        ASSERT_TRUE(NULL != mkdtemp(pattern));
+        directory = pattern;
+    }
+
+    void TearDown() override
+    {
+        uint32_t firstIndex = 0;
+        uint32_t lastIndex = 0;
+
+        if(streamBufferJournal_findSegments(directory.c_str(), JOURNAL_NAME, &firstIndex, &lastIndex))
+        {
+            for(uint32_t i = firstIndex; i <= lastIndex; i++)
+            {
+                unlink(getSegmentPath(i).c_str());
+            }
+        }
+        rmdir(directory.c_str());
+    }
+
+    std::string getSegmentPath(uint32_t segmentIndex)
+    {
+        char suffix[16] = { 0 };
+
+        snprintf(suffix, sizeof(suffix), ".%08u", segmentIndex);
+        return directory + "/" + JOURNAL_NAME + suffix;
+    }
+
+    std::vector<std::vector<uint8_t>> readAll()
+    {
+        std::vector<std::vector<uint8_t>> records;
+        streamBufferJournalReader_t reader;
+        streamBufferSpan_t record;
+        uint32_t firstIndex = 0;
+        uint32_t lastIndex = 0;
+
+        if(streamBufferJournal_findSegments(directory.c_str(), JOURNAL_NAME, &firstIndex, &lastIndex))
+        {
+            for(uint32_t i = firstIndex; i <= lastIndex; i++)
+            {
+                EXPECT_TRUE(streamBufferJournal_openReader(&reader, directory.c_str(), JOURNAL_NAME, i));
+                while(streamBufferJournal_readNext(&reader, &record))
+                {
+                    records.emplace_back(record.data, record.data + record.size);
+                }
+                EXPECT_TRUE(streamBufferJournal_closeReader(&reader));
+            }
+        }
+        return records;
+    }
+
+    void corruptSegment(uint32_t segmentIndex, long offset)
+    {
+        FILE *file = fopen(getSegmentPath(segmentIndex).c_str(), "r+b");
+        uint8_t byte = 0;
+
+        ASSERT_TRUE(NULL != file);
+        fseek(file, offset, SEEK_SET);
+        ASSERT_EQ(1U, fread(&byte, 1, 1, file));
+        byte ^= 0x5A;
+        fseek(file, offset, SEEK_SET);
+        ASSERT_EQ(1U, fwrite(&byte, 1, 1, file));
+        fclose(file);
+    }
+
+    std::string directory;
+    streamBufferJournal_t journal;
+};
+
+TEST_F(StreamBufferJournalTest, InvalidParameters)
+{
+    const uint8_t data[4] = { 0 };
+    streamBufferJournalReader_t reader;
+    streamBufferSpan_t record;
+    uint32_t firstIndex = 0;
+    uint32_t lastIndex = 0;
+    std::string longName(STREAM_BUFFER_JOURNAL_MAX_PATH_LENGTH, 'a');
+
+    EXPECT_FALSE(streamBufferJournal_open(NULL, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, false));
+    EXPECT_FALSE(streamBufferJournal_open(&journal, NULL, JOURNAL_NAME, SEGMENT_SIZE, false));
+    EXPECT_FALSE(streamBufferJournal_open(&journal, directory.c_str(), NULL, SEGMENT_SIZE, false));
+    EXPECT_FALSE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, STREAM_BUFFER_JOURNAL_HEADER_SIZE + 2, false));
+    EXPECT_FALSE(streamBufferJournal_open(&journal, directory.c_str(), longName.c_str(), SEGMENT_SIZE, false));
+    EXPECT_FALSE(streamBufferJournal_findSegments(directory.c_str(), JOURNAL_NAME, &firstIndex, &lastIndex));
+    EXPECT_FALSE(streamBufferJournal_openReader(&reader, directory.c_str(), JOURNAL_NAME, 0));
+
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, false));
+    EXPECT_FALSE(streamBufferJournal_append(NULL, data, sizeof(data)));
+    EXPECT_FALSE(streamBufferJournal_append(&journal, NULL, sizeof(data)));
+    EXPECT_FALSE(streamBufferJournal_append(&journal, data, 0));
+    EXPECT_FALSE(streamBufferJournal_append(&journal, data, SEGMENT_SIZE)) << "Larger than a segment.\n";
+    EXPECT_FALSE(streamBufferJournal_sync(NULL));
+    EXPECT_TRUE(streamBufferJournal_close(&journal));
+    EXPECT_FALSE(streamBufferJournal_close(&journal));
+    EXPECT_FALSE(streamBufferJournal_append(&journal, data, sizeof(data))) << "Closed journal.\n";
+
+    ASSERT_TRUE(streamBufferJournal_openReader(&reader, directory.c_str(), JOURNAL_NAME, 0));
+    EXPECT_FALSE(streamBufferJournal_readNext(&reader, NULL));
+    EXPECT_FALSE(streamBufferJournal_readNext(&reader, &record)) << "Empty segment.\n";
+    EXPECT_TRUE(streamBufferJournal_closeReader(&reader));
+    EXPECT_FALSE(streamBufferJournal_closeReader(&reader));
+}
+
+TEST_F(StreamBufferJournalTest, AppendRotateRead)
+{
+    std::vector<std::vector<uint8_t>> expected;
+    uint32_t firstIndex = 0;
+    uint32_t lastIndex = 0;
+
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, true));
+    for(uint8_t i = 0; i < 40; i++)
+    {
+        std::vector<uint8_t> record(1 + (i % 20), i);
+
+        ASSERT_TRUE(streamBufferJournal_append(&journal, record.data(), record.size()));
+        expected.push_back(record);
+    }
+    EXPECT_TRUE(streamBufferJournal_sync(&journal));
+    EXPECT_TRUE(streamBufferJournal_close(&journal));
+
+    ASSERT_TRUE(streamBufferJournal_findSegments(directory.c_str(), JOURNAL_NAME, &firstIndex, &lastIndex));
+    EXPECT_EQ(0U, firstIndex);
+    EXPECT_LT(1U, lastIndex) << "The records don't fit in a single segment.\n";
+    EXPECT_EQ(expected, readAll());
+}
+
+TEST_F(StreamBufferJournalTest, ReopenAppendsToLastSegment)
+{
+    const uint8_t first[3] = { 1, 2, 3 };
+    const uint8_t second[2] = { 4, 5 };
+    uint32_t firstIndex = 0;
+    uint32_t lastIndex = 0;
+
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, false));
+    ASSERT_TRUE(streamBufferJournal_append(&journal, first, sizeof(first)));
+    ASSERT_TRUE(streamBufferJournal_close(&journal));
+
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, false));
+    ASSERT_TRUE(streamBufferJournal_append(&journal, second, sizeof(second)));
+    ASSERT_TRUE(streamBufferJournal_close(&journal));
+
+    ASSERT_TRUE(streamBufferJournal_findSegments(directory.c_str(), JOURNAL_NAME, &firstIndex, &lastIndex));
+    EXPECT_EQ(0U, lastIndex);
+    std::vector<std::vector<uint8_t>> expected = { { 1, 2, 3 }, { 4, 5 } };
+    EXPECT_EQ(expected, readAll());
+
+    // Another checksum option starts a new segment
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, true));
+    ASSERT_TRUE(streamBufferJournal_close(&journal));
+    ASSERT_TRUE(streamBufferJournal_findSegments(directory.c_str(), JOURNAL_NAME, &firstIndex, &lastIndex));
+    EXPECT_EQ(1U, lastIndex);
+}
+
+TEST_F(StreamBufferJournalTest, RecoveryDropsCorruptedRecords)
+{
+    const uint8_t data[4] = { 1, 2, 3, 4 };
+    const uint8_t other[1] = { 9 };
+    const long recordSize = 2 + sizeof(data) + 1;
+
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, true));
+    for(int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(streamBufferJournal_append(&journal, data, sizeof(data)));
+    }
+    ASSERT_TRUE(streamBufferJournal_close(&journal));
+
+    // Corrupt the data of the second record: it's dropped with the third one
+    corruptSegment(0, STREAM_BUFFER_JOURNAL_HEADER_SIZE + recordSize + 3);
+    EXPECT_EQ(1U, readAll().size());
+
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, true));
+    ASSERT_TRUE(streamBufferJournal_append(&journal, other, sizeof(other)));
+    ASSERT_TRUE(streamBufferJournal_close(&journal));
+
+    std::vector<std::vector<uint8_t>> expected = { { 1, 2, 3, 4 }, { 9 } };
+    EXPECT_EQ(expected, readAll()) << "Nothing of the dropped records shall remain.\n";
+}
+
+TEST_F(StreamBufferJournalTest, SegmentWithoutStorage)
+{
+    const uint8_t data[20] = { 0 };
+    struct rlimit limit = { SEGMENT_SIZE / 2, SEGMENT_SIZE / 2 };
+    uint32_t firstIndex = 0;
+    uint32_t lastIndex = 0;
+    size_t recordCount = 0;
+
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, true));
+    while(streamBufferJournal_append(&journal, data, sizeof(data)))
+    {
+        recordCount++;
+        if(1 == recordCount)
+        {
+            // The blocks of the next segment can't be allocated anymore
+            signal(SIGXFSZ, SIG_IGN);
+            ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+        }
+    }
+    EXPECT_EQ(2U, recordCount) << "The rotation fails instead of mapping a segment without storage.\n";
+    EXPECT_FALSE(streamBufferJournal_append(&journal, data, sizeof(data)));
+
+    // The full segment is still recovered, only the next one is missing
+    ASSERT_TRUE(streamBufferJournal_open(&journal, directory.c_str(), JOURNAL_NAME, SEGMENT_SIZE, true));
+    EXPECT_FALSE(streamBufferJournal_append(&journal, data, sizeof(data)));
+
+    ASSERT_TRUE(streamBufferJournal_findSegments(directory.c_str(), JOURNAL_NAME, &firstIndex, &lastIndex));
+    EXPECT_EQ(0U, lastIndex);
+    EXPECT_EQ(2U, readAll().size());
+}
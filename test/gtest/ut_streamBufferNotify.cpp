@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <poll.h>
+#include "streamBufferNotify.h"
+
+constexpr size_t BUFFER_SIZE = 64;
+
+class StreamBufferNotifyTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        streamBuffer = streamBuffer_createStatic(bufferArray, BUFFER_SIZE);
+        ASSERT_TRUE(NULL != streamBuffer);
+        ASSERT_TRUE(streamBufferNotify_init(&notify, streamBuffer));
+    }
+
+    void TearDown() override
+    {
+        streamBufferNotify_deinit(&notify);
+        streamBuffer_freeStatic(&streamBuffer);
+    }
+
+    bool isReadable(int timeout)
+    {
+        struct pollfd pollFd = { streamBufferNotify_getFd(&notify), POLLIN, 0 };
+
+        return (1 == poll(&pollFd, 1, timeout)) && (0 != (pollFd.revents & POLLIN));
+    }
+
+    alignas(8) uint8_t bufferArray[BUFFER_SIZE] = { 0 };
+    streamBufferHandle_t streamBuffer = NULL;
+    streamBufferNotify_t notify;
+};
+
+TEST(StreamBufferNotifyInvalidTest, InvalidParameters)
+{
+    alignas(8) uint8_t bufferArray[BUFFER_SIZE] = { 0 };
+    streamBufferHandle_t streamBuffer = streamBuffer_createStatic(bufferArray, BUFFER_SIZE);
+    streamBufferNotify_t notify;
+
+    EXPECT_FALSE(streamBufferNotify_init(NULL, streamBuffer));
+    EXPECT_FALSE(streamBufferNotify_init(&notify, NULL));
+    EXPECT_FALSE(streamBufferNotify_deinit(NULL));
+    EXPECT_EQ(-1, streamBufferNotify_getFd(NULL));
+    EXPECT_FALSE(streamBufferNotify_arm(NULL));
+
+    ASSERT_TRUE(streamBufferNotify_init(&notify, streamBuffer));
+    EXPECT_TRUE(streamBufferNotify_deinit(&notify));
+    EXPECT_FALSE(streamBufferNotify_deinit(&notify));
+    EXPECT_FALSE(streamBufferNotify_arm(&notify));
+    EXPECT_TRUE(streamBuffer_freeStatic(&streamBuffer));
+}
+
+TEST_F(StreamBufferNotifyTest, ReadableAfterPut)
+{
+    const uint8_t data[4] = { 1, 2, 3, 4 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+
+    EXPECT_LE(0, streamBufferNotify_getFd(&notify));
+    ASSERT_TRUE(streamBufferNotify_arm(&notify));
+    EXPECT_FALSE(isReadable(0));
+
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_TRUE(isReadable(0));
+    EXPECT_FALSE(streamBufferNotify_arm(&notify)) << "A record is available.\n";
+    EXPECT_FALSE(isReadable(0)) << "Arming clears the notification.\n";
+
+    // No notification as long as the consumer doesn't wait
+    ASSERT_TRUE(streamBuffer_put(streamBuffer, data, sizeof(data)));
+    EXPECT_FALSE(isReadable(0));
+
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    ASSERT_TRUE(streamBuffer_get(streamBuffer, record, &size));
+    EXPECT_TRUE(streamBufferNotify_arm(&notify));
+}
+
+TEST_F(StreamBufferNotifyTest, BlockingConsumer)
+{
+    constexpr uint32_t recordCount = 20000;
+    bool isSequenceValid = true;
+
+    std::thread producer([this]()
+    {
+        for(uint32_t i = 0; i < recordCount; i++)
+        {
+            while(!streamBuffer_put(streamBuffer, (const uint8_t*) &i, sizeof(i)))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Sleep on the eventfd whenever the stream buffer is empty
+    uint32_t record = 0;
+    uint16_t size = 0;
+    for(uint32_t i = 0; i < recordCount; i++)
+    {
+        while(!streamBuffer_get(streamBuffer, (uint8_t*) &record, &size))
+        {
+            if(streamBufferNotify_arm(&notify))
+            {
+                ASSERT_TRUE(isReadable(5000)) << "Missed wakeup.\n";
+            }
+        }
+
+        if((sizeof(record) != size) || (i != record))
+        {
+            isSequenceValid = false;
+        }
+    }
+    producer.join();
+
+    EXPECT_TRUE(isSequenceValid);
+}
@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "streamBufferScheduler.h"
+
+constexpr size_t BUFFER_SIZE = 4096;
+constexpr size_t RECORD_SIZE = 100;
+
+enum
+{
+    LANE_CONTROL = 0,
+    LANE_TELEMETRY,
+    LANE_BULK,
+    LANE_COUNT
+};
+
+class StreamBufferSchedulerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        streamBufferLane_t lanes[LANE_COUNT] = { };
+
+        for(size_t i = 0; i < LANE_COUNT; i++)
+        {
+            streamBuffers[i] = streamBuffer_create(BUFFER_SIZE, 0);
+            ASSERT_TRUE(NULL != streamBuffers[i]);
+            lanes[i].streamBuffer = streamBuffers[i];
+        }
+        lanes[LANE_CONTROL].isPriority = true;
+        lanes[LANE_TELEMETRY].quantum = 3 * RECORD_SIZE;
+        lanes[LANE_BULK].quantum = RECORD_SIZE;
+        scheduler = streamBufferScheduler_init(&storage, lanes, LANE_COUNT, countWakeup, &wakeupCount);
+        ASSERT_TRUE(NULL != scheduler);
+    }
+
+    void TearDown() override
+    {
+        streamBufferScheduler_deinit(&scheduler);
+        for(auto &streamBuffer : streamBuffers)
+        {
+            streamBuffer_free(&streamBuffer);
+        }
+    }
+
+    void put(size_t laneIndex, size_t size)
+    {
+        std::vector<uint8_t> record(size, (uint8_t) laneIndex);
+
+        ASSERT_TRUE(streamBuffer_put(streamBuffers[laneIndex], record.data(), record.size()));
+    }
+
+    static void countWakeup(void *context)
+    {
+        (*(size_t*) context)++;
+    }
+
+    streamBufferHandle_t streamBuffers[LANE_COUNT] = { };
+    streamBufferSchedulerStatic_t storage;
+    streamBufferSchedulerHandle_t scheduler = NULL;
+    size_t wakeupCount = 0;
+    uint8_t data[BUFFER_SIZE] = { 0 };
+};
+
+TEST_F(StreamBufferSchedulerTest, InvalidParameters)
+{
+    streamBufferSchedulerStatic_t otherStorage;
+    streamBufferLane_t lanes[STREAM_BUFFER_SCHEDULER_MAX_LANE_COUNT + 1] = { };
+    size_t size = 0;
+    size_t laneIndex = 0;
+
+    lanes[0].streamBuffer = streamBuffers[0];
+    lanes[0].quantum = RECORD_SIZE;
+    EXPECT_TRUE(NULL == streamBufferScheduler_init(NULL, lanes, 1, NULL, NULL));
+    EXPECT_TRUE(NULL == streamBufferScheduler_init(&otherStorage, NULL, 1, NULL, NULL));
+    EXPECT_TRUE(NULL == streamBufferScheduler_init(&otherStorage, lanes, 0, NULL, NULL));
+    EXPECT_TRUE(NULL == streamBufferScheduler_init(&otherStorage, lanes, STREAM_BUFFER_SCHEDULER_MAX_LANE_COUNT + 1, NULL, NULL));
+    EXPECT_TRUE(NULL == streamBufferScheduler_init(&otherStorage, lanes, 2, NULL, NULL)) << "No stream buffer.\n";
+    lanes[0].quantum = 0;
+    EXPECT_TRUE(NULL == streamBufferScheduler_init(&otherStorage, lanes, 1, NULL, NULL)) << "A weighted lane needs a quantum.\n";
+
+    EXPECT_FALSE(streamBufferScheduler_get(NULL, data, sizeof(data), &size, &laneIndex));
+    EXPECT_FALSE(streamBufferScheduler_get(scheduler, NULL, sizeof(data), &size, &laneIndex));
+    EXPECT_FALSE(streamBufferScheduler_get(scheduler, data, sizeof(data), NULL, &laneIndex));
+    EXPECT_FALSE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, NULL));
+    EXPECT_FALSE(streamBufferScheduler_prepareWait(NULL));
+    EXPECT_FALSE(streamBufferScheduler_deinit(NULL));
+}
+
+TEST_F(StreamBufferSchedulerTest, PriorityLaneFirst)
+{
+    size_t size = 0;
+    size_t laneIndex = 0;
+
+    for(size_t i = 0; i < 5; i++)
+    {
+        put(LANE_BULK, RECORD_SIZE);
+        put(LANE_TELEMETRY, RECORD_SIZE);
+    }
+    ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_NE(LANE_CONTROL, laneIndex);
+
+    // A control record added under load is the next one out
+    put(LANE_CONTROL, 10);
+    ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_EQ(LANE_CONTROL, laneIndex);
+    EXPECT_EQ(10U, size);
+    EXPECT_EQ(LANE_CONTROL, data[0]);
+    ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_NE(LANE_CONTROL, laneIndex);
+}
+
+TEST_F(StreamBufferSchedulerTest, WeightedShare)
+{
+    size_t counts[LANE_COUNT] = { 0 };
+    size_t size = 0;
+    size_t laneIndex = 0;
+
+    for(size_t i = 0; i < 30; i++)
+    {
+        put(LANE_BULK, RECORD_SIZE);
+        put(LANE_TELEMETRY, RECORD_SIZE);
+    }
+
+    // 3 telemetry records for each bulk record while both have records
+    for(size_t i = 0; i < 40; i++)
+    {
+        ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+        ASSERT_EQ(RECORD_SIZE, size);
+        EXPECT_EQ(laneIndex, data[0]);
+        counts[laneIndex]++;
+    }
+    EXPECT_EQ(30U, counts[LANE_TELEMETRY]);
+    EXPECT_EQ(10U, counts[LANE_BULK]);
+
+    // The bulk lane gets everything once the telemetry lane is empty
+    for(size_t i = 0; i < 20; i++)
+    {
+        ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+        EXPECT_EQ(LANE_BULK, laneIndex);
+    }
+    EXPECT_FALSE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_EQ(0U, size);
+}
+
+TEST_F(StreamBufferSchedulerTest, LargeRecordWaitsForItsDeficit)
+{
+    size_t size = 0;
+    size_t laneIndex = 0;
+
+    // A bulk record of 4 quanta goes out in the fourth round, after 4 turns
+    // of the telemetry lane
+    put(LANE_BULK, 4 * RECORD_SIZE);
+    for(size_t i = 0; i < 30; i++)
+    {
+        put(LANE_TELEMETRY, RECORD_SIZE);
+    }
+    for(size_t i = 0; i < 12; i++)
+    {
+        ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+        EXPECT_EQ(LANE_TELEMETRY, laneIndex);
+    }
+    ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    ASSERT_EQ(LANE_BULK, laneIndex);
+    EXPECT_EQ(4 * RECORD_SIZE, size);
+
+    // The record stays in its lane if it doesn't fit
+    put(LANE_CONTROL, 20);
+    EXPECT_FALSE(streamBufferScheduler_get(scheduler, data, 10, &size, &laneIndex));
+    EXPECT_EQ(LANE_CONTROL, laneIndex);
+    EXPECT_EQ(20U, size);
+    EXPECT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_EQ(LANE_CONTROL, laneIndex);
+}
+
+TEST_F(StreamBufferSchedulerTest, IdleLanesWakeTheConsumer)
+{
+    size_t size = 0;
+    size_t laneIndex = 0;
+
+    EXPECT_FALSE(streamBufferScheduler_prepareWait(scheduler)) << "The lanes were never looked at.\n";
+    EXPECT_FALSE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_TRUE(streamBufferScheduler_prepareWait(scheduler));
+
+    // Only the first record of an idle lane calls the wakeup function
+    put(LANE_BULK, RECORD_SIZE);
+    put(LANE_BULK, RECORD_SIZE);
+    EXPECT_EQ(1U, wakeupCount);
+    EXPECT_FALSE(streamBufferScheduler_prepareWait(scheduler));
+    ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_EQ(LANE_BULK, laneIndex);
+    ASSERT_TRUE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_FALSE(streamBufferScheduler_get(scheduler, data, sizeof(data), &size, &laneIndex));
+    EXPECT_TRUE(streamBufferScheduler_prepareWait(scheduler));
+
+    put(LANE_CONTROL, 10);
+    EXPECT_EQ(2U, wakeupCount);
+
+    // Without the scheduler, the stream buffers don't call it anymore
+    ASSERT_TRUE(streamBufferScheduler_deinit(&scheduler));
+    EXPECT_TRUE(NULL == scheduler);
+    put(LANE_TELEMETRY, 10);
+    EXPECT_EQ(2U, wakeupCount);
+}
+
+TEST_F(StreamBufferSchedulerTest, ProducersAcrossThreads)
+{
+    constexpr uint32_t RECORD_COUNT = 20000;
+    std::atomic<size_t> pendingWakeups(0);
+    streamBufferLane_t lanes[2] = { };
+    streamBufferSchedulerStatic_t otherStorage;
+    streamBufferSchedulerHandle_t otherScheduler = NULL;
+    uint32_t nextValues[2] = { 0 };
+    size_t size = 0;
+    size_t laneIndex = 0;
+
+    ASSERT_TRUE(streamBufferScheduler_deinit(&scheduler));
+    for(size_t i = 0; i < 2; i++)
+    {
+        lanes[i].streamBuffer = streamBuffers[LANE_TELEMETRY + i];
+        lanes[i].quantum = sizeof(uint32_t);
+    }
+    otherScheduler = streamBufferScheduler_init(&otherStorage, lanes, 2, [](void *context) {
+        ((std::atomic<size_t>*) context)->fetch_add(1);
+    }, &pendingWakeups);
+    ASSERT_TRUE(NULL != otherScheduler);
+
+    auto producer = [&](streamBufferHandle_t streamBuffer) {
+        for(uint32_t value = 0; value < RECORD_COUNT; )
+        {
+            if(streamBuffer_put(streamBuffer, (const uint8_t*) &value, sizeof(value)))
+            {
+                value++;
+            }
+        }
+    };
+    std::thread firstProducer(producer, lanes[0].streamBuffer);
+    std::thread secondProducer(producer, lanes[1].streamBuffer);
+
+    // Each lane keeps its own order, and nothing is lost while the consumer
+    // only waits for a wakeup once all the lanes are idle
+    while((nextValues[0] < RECORD_COUNT) || (nextValues[1] < RECORD_COUNT))
+    {
+        uint32_t value = 0;
+
+        if(streamBufferScheduler_get(otherScheduler, (uint8_t*) &value, sizeof(value), &size, &laneIndex))
+        {
+            ASSERT_EQ(nextValues[laneIndex], value);
+            nextValues[laneIndex]++;
+        }
+        else if(streamBufferScheduler_prepareWait(otherScheduler))
+        {
+            while(0 == pendingWakeups.load())
+            {
+                std::this_thread::yield();
+            }
+            pendingWakeups.store(0);
+        }
+    }
+    firstProducer.join();
+    secondProducer.join();
+    EXPECT_TRUE(streamBufferScheduler_deinit(&otherScheduler));
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "streamBuffer.h"
+
+constexpr size_t BUFFER_SIZE = 256;
+constexpr size_t REGION_SIZE = STREAM_BUFFER_SHARED_REGION_SIZE(BUFFER_SIZE);
+
+class StreamBufferSharedTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        fd = memfd_create("streamBufferSharedTest", MFD_CLOEXEC);
+        ASSERT_LE(0, fd);
+        ASSERT_EQ(0, ftruncate(fd, REGION_SIZE));
+        region = mapRegion();
+        ASSERT_TRUE(NULL != region);
+    }
+
+    void TearDown() override
+    {
+        munmap(region, REGION_SIZE);
+        close(fd);
+    }
+
+    void* mapRegion()
+    {
+        void *mapping = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        return (MAP_FAILED == mapping) ? NULL : mapping;
+    }
+
+    int fd = -1;
+    void *region = NULL;
+};
+
+TEST_F(StreamBufferSharedTest, InvalidParameters)
+{
+    EXPECT_TRUE(NULL == streamBuffer_initShared(NULL, REGION_SIZE, BUFFER_SIZE));
+    EXPECT_TRUE(NULL == streamBuffer_initShared((uint8_t*) region + 8, REGION_SIZE - 8, BUFFER_SIZE / 2)) << "Misaligned region.\n";
+    EXPECT_TRUE(NULL == streamBuffer_initShared(region, REGION_SIZE - 1, BUFFER_SIZE));
+    EXPECT_TRUE(NULL == streamBuffer_initShared(region, REGION_SIZE, BUFFER_SIZE - 1));
+    EXPECT_TRUE(NULL == streamBuffer_attachShared(NULL, REGION_SIZE));
+    EXPECT_TRUE(NULL == streamBuffer_attachShared(region, REGION_SIZE)) << "Region not initialized.\n";
+
+    ASSERT_TRUE(NULL != streamBuffer_initShared(region, REGION_SIZE, BUFFER_SIZE));
+    EXPECT_TRUE(NULL == streamBuffer_attachShared(region, REGION_SIZE - 1));
+    EXPECT_TRUE(NULL != streamBuffer_attachShared(region, REGION_SIZE));
+
+    // Corrupt the magic number
+    memset(region, 0xFF, 4);
+    EXPECT_TRUE(NULL == streamBuffer_attachShared(region, REGION_SIZE));
+}
+
+TEST_F(StreamBufferSharedTest, PositionIndependent)
+{
+    const uint8_t data[5] = { 1, 2, 3, 4, 5 };
+    uint8_t record[BUFFER_SIZE] = { 0 };
+    uint16_t size = 0;
+    streamBufferHandle_t producer = streamBuffer_initShared(region, REGION_SIZE, BUFFER_SIZE);
+    void *otherRegion = mapRegion();
+
+    ASSERT_TRUE(NULL != producer);
+    ASSERT_TRUE(NULL != otherRegion);
+    ASSERT_NE(region, otherRegion);
+    streamBufferHandle_t consumer = streamBuffer_attachShared(otherRegion, REGION_SIZE);
+    ASSERT_TRUE(NULL != consumer);
+
+    EXPECT_FALSE(streamBuffer_setWakeup(consumer, NULL, NULL)) << "No wakeup function across processes.\n";
+    ASSERT_TRUE(streamBuffer_put(producer, data, sizeof(data)));
+    ASSERT_TRUE(streamBuffer_get(consumer, record, &size));
+    EXPECT_EQ(sizeof(data), size);
+    EXPECT_EQ(0, memcmp(data, record, size));
+
+    // Detaching a handle keeps the instance for the other process
+    EXPECT_TRUE(streamBuffer_freeStatic(&consumer));
+    EXPECT_TRUE(NULL != streamBuffer_attachShared(otherRegion, REGION_SIZE));
+    EXPECT_TRUE(streamBuffer_put(producer, data, sizeof(data)));
+    munmap(otherRegion, REGION_SIZE);
+}
+
+TEST_F(StreamBufferSharedTest, AcrossProcesses)
+{
+    constexpr uint32_t recordCount = 100000;
+    streamBufferConfig_t config = { };
+    streamBufferHandle_t consumer = streamBuffer_initShared(region, REGION_SIZE, BUFFER_SIZE);
+    bool isSequenceValid = true;
+
+    ASSERT_TRUE(NULL != consumer);
+    config.isMultiProducer = true;
+    ASSERT_TRUE(streamBuffer_configure(consumer, &config));
+
+    pid_t pid = fork();
+    ASSERT_LE(0, pid);
+    if(0 == pid)
+    {
+        streamBufferHandle_t producer = streamBuffer_attachShared(mapRegion(), REGION_SIZE);
+
+        for(uint32_t i = 0; (NULL != producer) && (i < recordCount); i++)
+        {
+            while(!streamBuffer_put(producer, (const uint8_t*) &i, 1 + (i % sizeof(i))))
+            {
+            }
+        }
+        _exit((NULL != producer) ? 0 : 1);
+    }
+
+    uint32_t record = 0;
+    uint16_t size = 0;
+    for(uint32_t i = 0; i < recordCount; i++)
+    {
+        uint32_t expected = i;
+
+        record = 0;
+        while(!streamBuffer_get(consumer, (uint8_t*) &record, &size))
+        {
+        }
+        if((size != 1 + (i % sizeof(i))) || (0 != memcmp(&expected, &record, size)))
+        {
+            isSequenceValid = false;
+        }
+    }
+
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+    EXPECT_TRUE(isSequenceValid);
+}
@@ -13,6 +13,9 @@ public:
 
 static timerHandle_t expiredTimer = NULL;
 static int timerExpiredCount = 0;
+static uint32_t elapsedTickCount = 0;
+static std::vector<std::pair<timerHandle_t, uint32_t>> expiryHistory;
+static std::vector<timerHandle_t> timersToStop;
 static std::vector<LockCallbackTestData> lockCallbackHistory;
 
 static void addLockCallBackData(bool isLockRequested, bool isInRunContext)
@@ -27,6 +30,22 @@ extern "C" {
         timerExpiredCount++;
     }
 
+    static void recordingTimerCallback(timerHandle_t t)
+    {
+        expiryHistory.push_back({ t, elapsedTickCount });
+        timerExpiredCount++;
+    }
+
+    static void stoppingTimerCallback(timerHandle_t t)
+    {
+        expiredTimer = t;
+        timerExpiredCount++;
+        for(timerHandle_t timer : timersToStop)
+        {
+            timerManager_stopTimer(timer);
+        }
+    }
+
     static void lockCallback(bool isLockRequested, bool isInRunContext)
     {
         addLockCallBackData(isLockRequested, isInRunContext);
@@ -40,6 +59,9 @@ public:
     {
         expiredTimer = NULL;
         timerExpiredCount = 0;
+        elapsedTickCount = 0;
+        expiryHistory.clear();
+        timersToStop.clear();
         lockCallbackHistory.clear();
     }
 
@@ -59,6 +81,22 @@ public:
     virtual ~TimerManagerTest()
     {
     }
+
+    static void advance(uint32_t tickCount, bool isRunEachTick)
+    {
+        for(uint32_t i = 0; i < tickCount; i++)
+        {
+            timerManager_incrementTimeBase();
+            elapsedTickCount++;
+            if(isRunEachTick)
+            {
+                timerManager_run();
+            }
+            lockCallbackHistory.clear();
+        }
+        timerManager_run();
+        lockCallbackHistory.clear();
+    }
 };
 
 TEST_F(TimerManagerNoInitTest, InitNullPointer)
@@ -93,11 +131,14 @@ TEST_F(TimerManagerNoInitTest, UninitTwice)
 TEST_F(TimerManagerNoInitTest, FunctionCallsNoInit)
 {
     timerHandle_t timer = NULL;
+    uint32_t tickCount = 0;
 
     timerManager_run();
     EXPECT_EQ(0, lockCallbackHistory.size());
     EXPECT_TRUE(NULL == timerManager_createTimer(timerCallback));
     EXPECT_FALSE(timerManager_incrementTimeBase());
+    EXPECT_FALSE(timerManager_advanceTimeBase(10));
+    EXPECT_FALSE(timerManager_getNextExpiry(&tickCount));
     EXPECT_FALSE(timerManager_uninit());
 
     // Call init to be able to create a timer and uninitialize the layer
@@ -311,4 +352,255 @@ TEST_F(TimerManagerTest, IncrementTimeBaseLockCallbackCalled)
     EXPECT_TRUE(lockCallbackHistory.at(0).m_isLockRequestedTest);
     EXPECT_FALSE(lockCallbackHistory.at(1).m_isInRunContextTest);
     EXPECT_FALSE(lockCallbackHistory.at(1).m_isLockRequestedTest);
-}
\ No newline at end of file
+}
+
+TEST_F(TimerManagerTest, StartTimerAcrossWheelLevels)
+{
+    const std::vector<uint32_t> tickCounts{ 1, 255, 256, 300, 65535, 65536, 70000 };
+    std::vector<timerHandle_t> timers;
+
+    for(uint32_t tickCount : tickCounts)
+    {
+        timers.push_back(timerManager_createTimer(recordingTimerCallback));
+        ASSERT_TRUE(NULL != timers.back());
+        ASSERT_TRUE(timerManager_startTimer(timers.back(), tickCount, false));
+    }
+
+    advance(70000, true);
+    ASSERT_EQ(tickCounts.size(), expiryHistory.size());
+    for(size_t i = 0; i < tickCounts.size(); i++)
+    {
+        EXPECT_TRUE(timers.at(i) == expiryHistory.at(i).first);
+        EXPECT_EQ(tickCounts.at(i), expiryHistory.at(i).second);
+    }
+}
+
+TEST_F(TimerManagerTest, RunAfterManyTicks)
+{
+    timerHandle_t shortTimer = timerManager_createTimer(recordingTimerCallback);
+    timerHandle_t longTimer = timerManager_createTimer(recordingTimerCallback);
+    timerHandle_t periodicTimer = timerManager_createTimer(recordingTimerCallback);
+
+    ASSERT_TRUE(timerManager_startTimer(shortTimer, 10, false));
+    ASSERT_TRUE(timerManager_startTimer(longTimer, 100000, false));
+    ASSERT_TRUE(timerManager_startTimer(periodicTimer, 1000, true));
+
+    // A single run catches up with all the elapsed ticks, a periodic timer expires once
+    advance(99999, false);
+    EXPECT_EQ(2, timerExpiredCount);
+    advance(1, false);
+    EXPECT_EQ(3, timerExpiredCount);
+    EXPECT_TRUE(longTimer == expiryHistory.back().first);
+
+    // The periodic timer restarted from the time of the first run
+    advance(998, true);
+    EXPECT_EQ(3, timerExpiredCount);
+    advance(1, true);
+    EXPECT_EQ(4, timerExpiredCount);
+    EXPECT_TRUE(periodicTimer == expiryHistory.back().first);
+}
+
+TEST_F(TimerManagerTest, RestartTimer)
+{
+    timerHandle_t timer = timerManager_createTimer(recordingTimerCallback);
+
+    ASSERT_TRUE(timerManager_startTimer(timer, 10, false));
+    advance(5, true);
+    ASSERT_TRUE(timerManager_startTimer(timer, 10, false));
+    advance(9, true);
+    EXPECT_EQ(0, timerExpiredCount);
+    advance(1, true);
+    ASSERT_EQ(1, timerExpiredCount);
+    EXPECT_EQ(15, expiryHistory.back().second);
+}
+
+TEST_F(TimerManagerTest, StartTimerZeroTickCount)
+{
+    timerHandle_t timer = timerManager_createTimer(timerCallback);
+
+    ASSERT_TRUE(timerManager_startTimer(timer, 0, true));
+    timerManager_run();
+    EXPECT_EQ(1, timerExpiredCount);
+    timerManager_run();
+    EXPECT_EQ(2, timerExpiredCount);
+    ASSERT_TRUE(timerManager_stopTimer(timer));
+    timerManager_run();
+    EXPECT_EQ(2, timerExpiredCount);
+}
+
+TEST_F(TimerManagerTest, StopTimerFromCallback)
+{
+    timerHandle_t timer1 = timerManager_createTimer(stoppingTimerCallback);
+    timerHandle_t timer2 = timerManager_createTimer(stoppingTimerCallback);
+
+    // Both timers expire on the same tick, the first one called stops the other one
+    ASSERT_TRUE(timerManager_startTimer(timer1, 300, false));
+    ASSERT_TRUE(timerManager_startTimer(timer2, 300, false));
+    timersToStop = { timer1, timer2 };
+
+    advance(300, true);
+    EXPECT_EQ(1, timerExpiredCount);
+    EXPECT_TRUE((timer1 == expiredTimer) || (timer2 == expiredTimer));
+}
+
+TEST_F(TimerManagerTest, DeleteStartedTimer)
+{
+    std::vector<timerHandle_t> timers{ MAX_TIMER_COUNT , NULL };
+    timerHandle_t deletedTimer = NULL;
+
+    for(size_t i = 0; i < MAX_TIMER_COUNT; i++)
+    {
+        timers.at(i) = timerManager_createTimer(timerCallback);
+        ASSERT_TRUE(NULL != timers.at(i));
+    }
+
+    // A deleted timer doesn't expire anymore and can be created again
+    ASSERT_TRUE(timerManager_startTimer(timers.at(0), 5, false));
+    deletedTimer = timers.at(0);
+    ASSERT_TRUE(timerManager_deleteTimer(&timers.at(0)));
+    EXPECT_FALSE(timerManager_deleteTimer(&deletedTimer));
+    EXPECT_FALSE(timerManager_startTimer(deletedTimer, 5, false));
+    advance(5, true);
+    EXPECT_EQ(0, timerExpiredCount);
+
+    timers.at(0) = timerManager_createTimer(timerCallback);
+    EXPECT_TRUE(deletedTimer == timers.at(0));
+    EXPECT_TRUE(NULL == timerManager_createTimer(timerCallback));
+}
+
+TEST_F(TimerManagerTest, AdvanceTimeBase)
+{
+    timerHandle_t timer = timerManager_createTimer(timerCallback);
+
+    ASSERT_TRUE(timerManager_startTimer(timer, 1000, false));
+    lockCallbackHistory.clear();
+    EXPECT_TRUE(timerManager_advanceTimeBase(999));
+    ASSERT_EQ(2, lockCallbackHistory.size());
+    EXPECT_FALSE(lockCallbackHistory.at(0).m_isInRunContextTest);
+    EXPECT_TRUE(lockCallbackHistory.at(0).m_isLockRequestedTest);
+    EXPECT_FALSE(lockCallbackHistory.at(1).m_isLockRequestedTest);
+
+    timerManager_run();
+    EXPECT_EQ(0, timerExpiredCount);
+    EXPECT_TRUE(timerManager_advanceTimeBase(1));
+    timerManager_run();
+    EXPECT_EQ(1, timerExpiredCount);
+}
+
+TEST_F(TimerManagerTest, GetNextExpiryInvalidParameters)
+{
+    uint32_t tickCount = 0;
+
+    EXPECT_FALSE(timerManager_getNextExpiry(NULL));
+
+    // No timer started
+    EXPECT_FALSE(timerManager_getNextExpiry(&tickCount));
+    timerHandle_t timer = timerManager_createTimer(timerCallback);
+    EXPECT_FALSE(timerManager_getNextExpiry(&tickCount));
+    ASSERT_TRUE(timerManager_startTimer(timer, 10, false));
+    ASSERT_TRUE(timerManager_stopTimer(timer));
+    EXPECT_FALSE(timerManager_getNextExpiry(&tickCount));
+}
+
+TEST_F(TimerManagerTest, GetNextExpiry)
+{
+    timerHandle_t timer1 = timerManager_createTimer(timerCallback);
+    timerHandle_t timer2 = timerManager_createTimer(timerCallback);
+    timerHandle_t timer3 = timerManager_createTimer(timerCallback);
+    uint32_t tickCount = 0;
+
+    // A timer placed in a higher level can be the earliest one
+    ASSERT_TRUE(timerManager_startTimer(timer1, 300, false));
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(300, tickCount);
+    advance(100, true);
+    ASSERT_TRUE(timerManager_startTimer(timer2, 250, false));
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(200, tickCount);
+
+    // An earlier timer replaces the cached deadline, stopping it brings the previous one back
+    ASSERT_TRUE(timerManager_startTimer(timer3, 20, false));
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(20, tickCount);
+    ASSERT_TRUE(timerManager_stopTimer(timer3));
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(200, tickCount);
+
+    // Pending ticks not run yet are accounted for
+    timerManager_advanceTimeBase(50);
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(150, tickCount);
+    timerManager_advanceTimeBase(150);
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(0, tickCount);
+    timerManager_run();
+    EXPECT_EQ(1, timerExpiredCount);
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(50, tickCount);
+
+    // A timer started with a tick count of 0 is due
+    ASSERT_TRUE(timerManager_startTimer(timer3, 0, false));
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(0, tickCount);
+}
+
+TEST_F(TimerManagerTest, TicklessLoop)
+{
+    const std::vector<uint32_t> tickCounts{ 5, 70000, 20000000, 3000000000u };
+    std::vector<timerHandle_t> timers;
+    uint32_t tickCount = 0;
+    size_t iterationCount = 0;
+
+    for(uint32_t count : tickCounts)
+    {
+        timers.push_back(timerManager_createTimer(recordingTimerCallback));
+        ASSERT_TRUE(timerManager_startTimer(timers.back(), count, false));
+    }
+
+    // Sleep until the next expiry and catch up in one step
+    while(timerManager_getNextExpiry(&tickCount))
+    {
+        ASSERT_TRUE(timerManager_advanceTimeBase(tickCount));
+        elapsedTickCount += tickCount;
+        timerManager_run();
+        iterationCount++;
+    }
+
+    EXPECT_EQ(tickCounts.size(), iterationCount);
+    ASSERT_EQ(tickCounts.size(), expiryHistory.size());
+    for(size_t i = 0; i < tickCounts.size(); i++)
+    {
+        EXPECT_TRUE(timers.at(i) == expiryHistory.at(i).first);
+        EXPECT_EQ(tickCounts.at(i), expiryHistory.at(i).second);
+    }
+}
+
+TEST_F(TimerManagerTest, UninitStopsTimers)
+{
+    timerHandle_t periodicTimer = timerManager_createTimer(recordingTimerCallback);
+    timerHandle_t dueTimer = timerManager_createTimer(recordingTimerCallback);
+    uint32_t tickCount = 0;
+
+    ASSERT_TRUE(NULL != periodicTimer);
+    ASSERT_TRUE(NULL != dueTimer);
+    ASSERT_TRUE(timerManager_startTimer(periodicTimer, 300, true));
+    advance(100, false);
+    ASSERT_TRUE(timerManager_startTimer(dueTimer, 0, false));
+
+    // The timers survive a new initialization but the wheel starts empty
+    ASSERT_TRUE(timerManager_uninit());
+    ASSERT_TRUE(timerManager_init(lockCallback));
+    EXPECT_FALSE(timerManager_getNextExpiry(&tickCount));
+    advance(1000, false);
+    EXPECT_TRUE(expiryHistory.empty());
+
+    ASSERT_TRUE(timerManager_startTimer(periodicTimer, 300, false));
+    ASSERT_TRUE(timerManager_getNextExpiry(&tickCount));
+    EXPECT_EQ(300U, tickCount);
+    advance(300, false);
+    ASSERT_EQ(1U, expiryHistory.size());
+    EXPECT_TRUE(periodicTimer == expiryHistory.at(0).first);
+    EXPECT_EQ(1400U, expiryHistory.at(0).second);
+    EXPECT_TRUE(timerManager_deleteTimer(&periodicTimer));
+    EXPECT_TRUE(timerManager_deleteTimer(&dueTimer));
+}